@@ -8,6 +8,7 @@
 
 #include <memory>
 #include <map>
+#include <random>
 #include "player_ai_helper.h"
 #include "player_state_handler/player_state_handler.h"
 #include "attack_rules.h"
@@ -185,9 +186,11 @@ public:
 	/**
 	 * Constructor for group.
 	 *
-	 * @param[in]  actid  The actid
+	 * @param[in]  actid             The actid
+	 * @param      random_generator  The AI's random number generator, the
+	 *                               group's id is drawn from
 	 */
-	Group(state::act_id_t actid);
+	Group(state::act_id_t actid, std::mt19937& random_generator);
 
 	/**
 	 * Updates the group every tick.
@@ -63,7 +63,7 @@ state::act_id_t AI::GetOptimalRespawnLocation (
 void AI::Update(std::shared_ptr<state::PlayerStateHandler> state) {
 	if (!init_groups){
 		for (auto actid : state -> GetPlayerUnitIds()) {
-			groups.push_back(new Group(actid));
+			groups.push_back(new Group(actid, random_generator));
 		}
 		init_groups = true;
 	}
@@ -77,12 +77,12 @@ void AI::Update(std::shared_ptr<state::PlayerStateHandler> state) {
 			auto locationId = GetOptimalRespawnLocation(state, to_respawn_id);
 			state->RespawnUnit(to_respawn_id, locationId, NULL);
 		}
-		if (rand() % 2 == 0) {
+		if (random_generator() % 2 == 0) {
 			state->RespawnUnit(to_respawn_id, state->GetBase().GetId(), NULL);
 		}
 		else {
 			auto towers = state->GetTowers();
-			int chosen = rand() % towers.size();
+			int chosen = random_generator() % towers.size();
 			state->RespawnUnit(to_respawn_id, towers[chosen].GetId(), NULL);
 		}
 	}
@@ -21,18 +21,9 @@ float GetEnemyAllyHpRatioByThreshold(
 		state::act_id_t id,
 		float threshold
 	) {
-	state::list_act_id_t allies = state->GetPlayerUnitIds(), enemies = state->GetPlayerEnemyIds();
-	float allySum = 0, enemySum = 0;
-	for (int i = 0; i < allies.size(); i++){
-		if (state->GetUnitFromId(allies[i], nullptr).GetPosition().distance(state->GetUnitFromId(id, nullptr).GetPosition()) <= threshold) {
-			allySum += state->GetUnitFromId(allies[i], nullptr).GetHp();
-		}
-	}
-	for (int i = 0; i < enemies.size(); i++){
-		if (state->GetUnitFromId(enemies[i], nullptr).GetPosition().distance(state->GetUnitFromId(id, nullptr).GetPosition()) <= threshold) {
-			enemySum += state->GetEnemyUnitFromId(enemies[i], nullptr).GetHp();
-		}
-	}
+	auto position = state->GetUnitFromId(id, nullptr).GetPosition();
+	float allySum = state->GetInfluenceNear(state::ALLY_HP, position, threshold);
+	float enemySum = state->GetInfluenceNear(state::ENEMY_HP, position, threshold);
 	if (allySum == 0) allySum = 1;
 	return enemySum/allySum;
 }
@@ -44,13 +35,13 @@ float GetEnemyAllyHpRatio (
 )	{
 		state::UnitView parentUnit = state->GetUnitFromId(id, nullptr);
 
-		std::vector<state::MagicianView> allyMagicians = state->GetMagicians();
-		std::vector<state::SwordsmanView> allySwordsmen = state->GetSwordsmen();
-		std::vector<state::TowerView> allyTowers = state->GetTowers();
+		state::MagicianRange allyMagicians = state->GetMagicianRange();
+		state::SwordsmanRange allySwordsmen = state->GetSwordsmanRange();
+		state::TowerRange allyTowers = state->GetTowerRange();
 
-		std::vector<state::EnemyMagicianView> enemyMagicians = state->GetEnemyMagicians();
-		std::vector<state::EnemySwordsmanView> enemySwordsmen = state->GetEnemySwordsmen();
-		std::vector<state::EnemyTowerView> enemyTowers = state->GetEnemyTowers();
+		state::EnemyMagicianRange enemyMagicians = state->GetEnemyMagicianRange();
+		state::EnemySwordsmanRange enemySwordsmen = state->GetEnemySwordsmanRange();
+		state::EnemyTowerRange enemyTowers = state->GetEnemyTowerRange();
 
 		std::vector<std::pair<int64_t, float>> allyPairs;
 		std::vector<std::pair<int64_t, float>> enemyPairs;
@@ -326,14 +317,12 @@ bool IsAttackingKing (
 }
 
 bool IsEnemyTowerDominating(std::shared_ptr<state::PlayerStateHandler> state) {
-	std::vector<state::TowerView> allyTowers = state->GetTowers();
-	std::vector<state::EnemyTowerView> foeTowers = state->GetEnemyTowers();
 	float allySum = 0, foeSum = 0;
-	for (int i = 0; i < allyTowers.size(); i++) {
-		allySum += allyTowers[i].GetHp();	
+	for (auto allyTower : state->GetTowerRange()) {
+		allySum += allyTower.GetHp();
 	}
-	for (int i = 0; i < foeTowers.size(); i++) {
-		foeSum += foeTowers[i].GetHp();	
+	for (auto foeTower : state->GetEnemyTowerRange()) {
+		foeSum += foeTower.GetHp();
 	}
 	if (foeSum > allySum) return true;
 	else return false;
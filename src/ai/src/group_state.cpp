@@ -5,9 +5,9 @@
 
 namespace ai {
 
-Group::Group(state::act_id_t actid) : state(new Guard()) {
+Group::Group(state::act_id_t actid, std::mt19937& random_generator) : state(new Guard()) {
 		unitId = actid;
-		group_id = rand() % mod;
+		group_id = random_generator() % mod;
 }
 
 void Group::update (
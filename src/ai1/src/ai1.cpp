@@ -50,25 +50,10 @@ state::act_id_t GetNearestEnemy(
 	int threshold = INT_MAX
 ) {
 	auto unit = state->GetUnitFromId(unit_id, NULL);
-	auto enemies = state->GetPlayerEnemyIds();
+	auto nearest = state->QueryKNearest(unit.GetPosition(), 1,
+		state::ENEMY_UNITS, std::vector<state::ActorType>(), threshold);
 
-	state::act_id_t nearest_enemy_id = -1;
-	float min_dist = 0;
-
-	for (auto en_id : enemies) {
-		auto enemy = state->GetEnemyUnitFromId(en_id, NULL);
-
-		auto cur_dist = enemy.GetPosition().distance(unit.GetPosition());
-
-		if (cur_dist <= threshold) {
-			if (nearest_enemy_id == -1 || cur_dist < min_dist) {
-				nearest_enemy_id = en_id;
-				min_dist = cur_dist;
-			}
-		}
-	}
-
-	return nearest_enemy_id;
+	return nearest.empty() ? -1 : nearest[0];
 }
 
 /**
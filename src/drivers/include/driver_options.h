@@ -0,0 +1,249 @@
+/**
+ * @file driver_options.h
+ * Definitions for the options the drivers are run with
+ */
+
+#ifndef DRIVERS_DRIVER_OPTIONS_H
+#define DRIVERS_DRIVER_OPTIONS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ipc.h"
+#include "replay.h"
+#include "shm_ring.h"
+#include "state_writer.h"
+
+namespace drivers {
+
+/**
+ * What is done to a player whose update took longer than the think budget
+ */
+enum THINK_BUDGET_POLICY {
+	/**
+	 * The commands the player gave in that update are discarded
+	 */
+	DROP_COMMANDS,
+	/**
+	 * The commands are applied, but the player sits out one tick for
+	 * every budget's worth of CPU time it used
+	 */
+	PENALISE
+};
+
+/**
+ * How the game and player threads of a match are placed on CPUs
+ */
+enum AFFINITY_POLICY {
+	/**
+	 * Threads are left to the OS scheduler
+	 */
+	AFFINITY_NONE,
+	/**
+	 * Each thread is pinned to a single CPU of its own, as far as the
+	 * available CPUs allow
+	 */
+	AFFINITY_PIN,
+	/**
+	 * All threads may run on any of the available CPUs
+	 */
+	AFFINITY_SET
+};
+
+/**
+ * Group of CPUs a match's threads are kept inside
+ */
+enum PLACEMENT_DOMAIN {
+	/**
+	 * Any of the available CPUs may be used
+	 */
+	DOMAIN_ANY,
+	/**
+	 * Only CPUs sharing an L3 cache with the first available CPU
+	 */
+	DOMAIN_L3,
+	/**
+	 * Only CPUs on the same NUMA node as the first available CPU
+	 */
+	DOMAIN_NUMA
+};
+
+/**
+ * Options the MainDriver and PlayerDriver classes are run with
+ */
+struct DriverOptions {
+	/**
+	 * Thread CPU time a player may spend in a single update, in
+	 * microseconds
+	 *
+	 * 0 disables the budget
+	 */
+	int64_t think_budget;
+	/**
+	 * What is done to a player that exceeds the think budget
+	 */
+	THINK_BUDGET_POLICY think_budget_policy;
+	/**
+	 * If true, per player CPU time statistics are printed to stderr when
+	 * the game ends
+	 */
+	bool print_stats;
+	/**
+	 * How the match's threads are placed on CPUs
+	 */
+	AFFINITY_POLICY affinity_policy;
+	/**
+	 * CPUs the match's threads may be placed on
+	 *
+	 * If empty, the CPUs the process is allowed to run on are used
+	 */
+	std::vector<int> cpus;
+	/**
+	 * Group of CPUs the match's threads are kept inside
+	 */
+	PLACEMENT_DOMAIN placement_domain;
+	/**
+	 * Number of threads the Actor updates of a tick are split between
+	 *
+	 * 1 updates them on the game thread, 0 uses one thread per
+	 * hardware thread
+	 */
+	int64_t worker_threads;
+	/**
+	 * Number of independent headless matches to run
+	 *
+	 * More than 1 runs them all on a MatchScheduler
+	 */
+	int64_t match_count;
+	/**
+	 * Number of threads the MatchScheduler runs the matches on
+	 *
+	 * 0 uses one thread per hardware thread
+	 */
+	int64_t scheduler_threads;
+	/**
+	 * If true, every tick waits for both players to finish an update and
+	 * advances the game by a fixed 1 / tick_rate seconds, so that a
+	 * match plays out the same way on any machine
+	 */
+	bool lockstep;
+	/**
+	 * Longest a lockstep tick waits for the players, in milliseconds
+	 *
+	 * A player that is still running when it passes misses the tick, and
+	 * its commands are applied on a later one. 0 waits indefinitely
+	 */
+	int64_t lockstep_timeout;
+	/**
+	 * Seed for the random number generator Player 1's AI draws from,
+	 * Player 2's is seeded with the next number
+	 */
+	unsigned int seed;
+	/**
+	 * If true, a match whose ticks keep overrunning their frames skips
+	 * renderer frames, then refreshes LOS less often, then caps dt
+	 *
+	 * Never applies in lockstep
+	 */
+	bool degrade_on_overload;
+	/**
+	 * Number of frames per keyframe when the renderer is sent a delta
+	 * stream
+	 *
+	 * 0 sends the full state every frame instead
+	 */
+	int64_t delta_keyframe_interval;
+	/**
+	 * How the LOS grids sent to the renderer are encoded
+	 */
+	ipc::LOS_FORMAT los_format;
+	/**
+	 * If true, frames for the renderer are encoded and written on a
+	 * thread of their own, so the game loop never waits on the renderer
+	 */
+	bool async_output;
+	/**
+	 * Most frames waiting to be written when writing asynchronously
+	 */
+	int64_t output_queue_capacity;
+	/**
+	 * What happens to a frame when the output queue is full
+	 */
+	ipc::WRITER_QUEUE_POLICY output_queue_policy;
+	/**
+	 * Number of ticks the game is simulated in per second of game time
+	 */
+	int64_t tick_rate;
+	/**
+	 * Number of frames sent to the renderer per second of game time
+	 *
+	 * 0 sends one every tick
+	 */
+	int64_t output_rate;
+	/**
+	 * Seconds of game time simulated per second of real time
+	 *
+	 * Never applies in headless lockstep, which runs as fast as it can
+	 */
+	double speed;
+	/**
+	 * File the match is recorded to for replaying, none if empty
+	 *
+	 * Headless matches are recorded too, at the output rate
+	 */
+	std::string replay_file;
+	/**
+	 * Number of frames per keyframe of the replay
+	 */
+	int64_t replay_keyframe_interval;
+	/**
+	 * Name of the shared memory ring the renderer reads frames from
+	 *
+	 * Empty writes the frames to stdout instead
+	 */
+	std::string shm_ring_name;
+	/**
+	 * Number of bytes in the shared memory ring
+	 */
+	int64_t shm_ring_capacity;
+	/**
+	 * Number of logs each player may send per frame, 0 for no limit
+	 */
+	int64_t log_records_per_frame;
+	/**
+	 * Bytes of logs each player may send per frame, 0 for no limit
+	 */
+	int64_t log_bytes_per_frame;
+
+	DriverOptions() :
+		think_budget(0),
+		think_budget_policy(DROP_COMMANDS),
+		print_stats(false),
+		affinity_policy(AFFINITY_NONE),
+		placement_domain(DOMAIN_ANY),
+		worker_threads(1),
+		match_count(1),
+		scheduler_threads(0),
+		lockstep(false),
+		lockstep_timeout(0),
+		seed(1),
+		degrade_on_overload(false),
+		delta_keyframe_interval(0),
+		los_format(ipc::LOS_ROWS),
+		async_output(false),
+		output_queue_capacity(4),
+		output_queue_policy(ipc::DROP_OLDEST),
+		tick_rate(30),
+		output_rate(0),
+		speed(1),
+		replay_file(),
+		replay_keyframe_interval(ipc::REPLAY_DEFAULT_KEYFRAME_INTERVAL),
+		shm_ring_name(),
+		shm_ring_capacity(ipc::SHM_RING_DEFAULT_CAPACITY),
+		log_records_per_frame(ipc::LOG_DEFAULT_RECORDS_PER_FRAME),
+		log_bytes_per_frame(ipc::LOG_DEFAULT_BYTES_PER_FRAME) {}
+};
+
+}
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file initial_state.h
+ * Declarations for setting up the state a match starts from
+ */
+
+#ifndef DRIVERS_INITIAL_STATE_H
+#define DRIVERS_INITIAL_STATE_H
+
+#include <cstdint>
+
+#include "state.h"
+#include "drivers_export.h"
+
+namespace drivers {
+
+/**
+ * Size of a TerrainElement, in the units positions are measured in
+ */
+const int64_t ELEMENT_SIZE = 200;
+
+/**
+ * Fewest rows a terrain needs for MakeState, the units are placed up to 29
+ * elements from the origin
+ */
+const int64_t MIN_TERRAIN_ROWS = 30;
+
+/**
+ * Makes the state a match starts from, with each player's units at
+ * their base on the given terrain
+ *
+ * The terrain needs at least MIN_TERRAIN_ROWS rows
+ *
+ * @param[in]  terrain  The terrain
+ *
+ * @return     The state object
+ */
+DRIVERS_EXPORT state::State MakeState(state::Terrain terrain);
+
+}
+
+#endif
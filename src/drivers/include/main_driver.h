@@ -8,11 +8,16 @@
 
 #include <memory>
 #include <atomic>
+#include <chrono>
 
 #include "state.h"
+#include "ipc.h"
 #include <vector>
 #include "player_state_handler/player_state_handler.h"
 #include "player_driver.h"
+#include "driver_options.h"
+#include "thread_placement.h"
+#include "overload_governor.h"
 #include "player_ai.h"
 #include "utilities.h"
 #include "drivers_export.h"
@@ -46,6 +51,10 @@ private:
 	 * Player 2's Buffer Handler for state object
 	 */
 	std::shared_ptr<state::PlayerStateHandler> p2_buffer;
+	/**
+	 * Collects the players' logs, kept apart from those of other matches
+	 */
+	std::unique_ptr<ipc::Logger> logger;
 	/**
 	 * Player 1's PlayerDriver object
 	 */
@@ -67,16 +76,193 @@ private:
 	 */
 	int64_t total_game_duration;
 	/**
-	 * FPS at which the simulation will try to run at
-	 *
-	 * FPS will not exceed this value, but it may be below it
+	 * Frame rate the delta times State::Update takes are scaled to
 	 */
 	int64_t fps;
+	/**
+	 * Game time a tick covers, 1 / tick_rate seconds
+	 */
+	std::chrono::nanoseconds frame_period;
+	/**
+	 * Real time between the starts of consecutive ticks, frame_period
+	 * divided by the speed
+	 *
+	 * The tick rate will not exceed this, but it may fall below it
+	 */
+	std::chrono::nanoseconds wall_frame_period;
+	/**
+	 * Game time between frames sent to the renderer, 0 to send one every
+	 * tick
+	 */
+	std::chrono::nanoseconds output_period;
+	/**
+	 * Number of ticks run so far
+	 */
+	int64_t ticks;
+	/**
+	 * Game time the next frame for the renderer is due at
+	 */
+	std::chrono::nanoseconds next_output;
 	/**
 	 * true if the simulation is running headless,
 	 * false if running with a renderer
 	 */
 	bool is_headless;
+	/**
+	 * Options the driver was run with
+	 */
+	DriverOptions options;
+	/**
+	 * CPUs the game and player threads run on
+	 */
+	ThreadPlacement placement;
+	/**
+	 * Number of ticks Player 1 still has to sit out for exceeding the
+	 * think budget
+	 */
+	int64_t p1_penalty_ticks;
+	/**
+	 * Number of ticks Player 2 still has to sit out for exceeding the
+	 * think budget
+	 */
+	int64_t p2_penalty_ticks;
+	/**
+	 * Game time simulated by Step so far
+	 */
+	std::chrono::nanoseconds stepped_game_duration;
+	/**
+	 * Time between the starts of consecutive ticks of the update loop
+	 */
+	state::LatencyHistogram frame_times;
+	/**
+	 * Degrades the match when its ticks overrun their frames
+	 */
+	OverloadGovernor overload;
+	/**
+	 * Where the frames sent to the renderer are written
+	 */
+	std::unique_ptr<ipc::FrameOutput> output;
+	/**
+	 * Encodes the frames sent to the renderer, if sending a delta stream
+	 */
+	std::unique_ptr<ipc::DeltaEncoder> delta_encoder;
+	/**
+	 * Records the match, if recording
+	 */
+	std::unique_ptr<ipc::ReplayWriter> replay;
+	/**
+	 * Writes the frames for the renderer, if writing asynchronously, and
+	 * records them on the same thread
+	 *
+	 * Headless matches being recorded have one that only records
+	 */
+	std::unique_ptr<ipc::StateWriter> state_writer;
+	/**
+	 * Snapshot reused by TransferState when writing synchronously
+	 */
+	std::unique_ptr<ipc::FrameData> snapshot;
+	/**
+	 * Sends the main State to the renderer and records it in the replay
+	 *
+	 * Headless, the State is only recorded. Each frame carries the tick and game time it was taken at, for the
+	 * renderer to interpolate between frames with
+	 *
+	 * @param[in]  exit_status  true if this is the last frame
+	 * @param[in]  game_time    Game time elapsed so far
+	 */
+	void TransferState(bool exit_status, std::chrono::nanoseconds game_time);
+	/**
+	 * Checks if a frame is due to be sent to the renderer, and moves the
+	 * deadline for the next one on if so
+	 *
+	 * @param[in]  game_time    Game time elapsed so far
+	 *
+	 * @return     true if a frame is due, false otherwise
+	 */
+	bool IsOutputDue(std::chrono::nanoseconds game_time);
+	/**
+	 * Converts real time into game time at the speed the game runs at
+	 *
+	 * @param[in]  wall_time  The real time
+	 *
+	 * @return     The game time
+	 */
+	std::chrono::nanoseconds ToGameTime(std::chrono::nanoseconds wall_time);
+	/**
+	 * Number of lockstep ticks Player 1 missed by running past the timeout
+	 */
+	int64_t p1_lockstep_timeouts;
+	/**
+	 * Number of lockstep ticks Player 2 missed by running past the timeout
+	 */
+	int64_t p2_lockstep_timeouts;
+	/**
+	 * Waits for both players to finish their updates before a lockstep
+	 * tick, for at most the lockstep timeout
+	 */
+	void WaitForPlayers();
+	/**
+	 * Converts the time elapsed since the last tick into the delta time
+	 * State::Update takes
+	 *
+	 * @param[in]  update_duration  The time elapsed
+	 *
+	 * @return     The delta time
+	 */
+	float GetDeltaTime(std::chrono::nanoseconds update_duration);
+	/**
+	 * Sleeps until the start of the next frame, and moves the deadline
+	 * on by a frame
+	 *
+	 * Deadlines are absolute, so time lost to one frame is made up in the
+	 * next instead of accumulating. If the loop has fallen more than a
+	 * frame behind, the deadlines restart from now
+	 *
+	 * @param      next_frame  Start time of the next frame
+	 */
+	void WaitForNextFrame(std::chrono::steady_clock::time_point& next_frame);
+	/**
+	 * Gets a player's PlayerDriver
+	 *
+	 * @param[in]  player_id  The player's id
+	 *
+	 * @return     The PlayerDriver
+	 */
+	std::shared_ptr<PlayerDriver> GetPlayerDriver(state::PlayerId player_id);
+	/**
+	 * Decides what to do with a player's finished update
+	 *
+	 * Merges the player's commands into the main State unless they are
+	 * dropped or have already been merged, and applies the think budget
+	 * policy
+	 *
+	 * @param      driver         The player's PlayerDriver
+	 * @param      penalty_ticks  The player's remaining penalty ticks
+	 * @param      buffer         The player's copy of the State
+	 * @param[in]  player_id      The player's id
+	 *
+	 * @return     true if the player's buffer should be refreshed and the
+	 *             player allowed to update again after this tick
+	 */
+	bool HandlePlayerUpdate(
+		PlayerDriver& driver,
+		int64_t& penalty_ticks,
+		state::State& buffer,
+		state::PlayerId player_id
+	);
+	/**
+	 * Merges in the players' commands, updates the main State and hands
+	 * the result back to the players
+	 *
+	 * @param[in]  delta_time  The time elapsed since the last update
+	 * @param[in]  substeps    Number of equal steps the State is updated
+	 *                         in to cover delta_time
+	 */
+	void UpdateGameState(float delta_time, int64_t substeps = 1);
+	/**
+	 * Prints CPU time statistics of both players to stderr
+	 */
+	void PrintStats();
 	/**
 	 * Infinite loop handling all the game Updates
 	 */
@@ -101,12 +287,59 @@ public:
 		std::shared_ptr<state::State> s2,
 		std::shared_ptr<state::State> s3,
 		int64_t total_game_duration,
-		bool is_headless
+		bool is_headless,
+		DriverOptions options = DriverOptions()
 	);
 	/**
 	 * Creates a thread whose Handler Function is the GlobalUpdateLoop
 	 */
 	void Run();
+	/**
+	 * Prepares the game for being driven by Step instead of Run
+	 *
+	 * No threads are created, the caller runs the ticks with Step and
+	 * the player updates with UpdatePlayer, and calls Stop at the end
+	 */
+	void Start();
+	/**
+	 * Runs a single headless tick, advancing the game by one frame
+	 *
+	 * The game time advances by a fixed frame_period no matter how long
+	 * the tick takes
+	 *
+	 * @return     true if the game is over, false otherwise
+	 */
+	bool Step();
+	/**
+	 * Checks if a player has been handed the latest State and can run
+	 * its next update
+	 *
+	 * @param[in]  player_id  The player's id
+	 *
+	 * @return     true if the player can update, false otherwise
+	 */
+	bool CanPlayerUpdate(state::PlayerId player_id);
+	/**
+	 * Runs one update of a player's code on the calling thread
+	 *
+	 * Must only be called while CanPlayerUpdate returns true, and never
+	 * concurrently with Step
+	 *
+	 * @param[in]  player_id  The player's id
+	 */
+	void UpdatePlayer(state::PlayerId player_id);
+	/**
+	 * Gets the main game State
+	 *
+	 * @return     The State
+	 */
+	std::shared_ptr<state::State> GetState();
+	/**
+	 * Gets what the overload handling has done so far
+	 *
+	 * @return     The counters
+	 */
+	const OverloadCounters& GetOverloadCounters();
 	/**
 	 * Calls join on the runner thread
 	 */
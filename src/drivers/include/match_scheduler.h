@@ -0,0 +1,110 @@
+/**
+ * @file match_scheduler.h
+ * Headers for the MatchScheduler class
+ */
+
+#ifndef DRIVERS_MATCH_SCHEDULER_H
+#define DRIVERS_MATCH_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "main_driver.h"
+#include "parallel/task_pool.h"
+#include "drivers_export.h"
+
+namespace drivers {
+
+/**
+ * Runs many headless matches on one shared TaskPool
+ *
+ * Instead of three threads per match, every tick and every player update
+ * is a task. A match's next tick is queued once its previous tick and
+ * the player updates it started have all finished, so idle threads pick
+ * up work from whichever match has some
+ */
+class DRIVERS_EXPORT MatchScheduler {
+private:
+	/**
+	 * A match and its progress
+	 */
+	struct ScheduledMatch {
+		/**
+		 * The match
+		 */
+		std::shared_ptr<MainDriver> driver;
+		/**
+		 * Tasks of the current tick still running
+		 */
+		std::atomic<int64_t> pending_tasks;
+	};
+	/**
+	 * The threads running the matches
+	 */
+	state::TaskPool pool;
+	/**
+	 * The matches added so far
+	 */
+	std::vector<std::unique_ptr<ScheduledMatch> > matches;
+	/**
+	 * Guards finished_matches
+	 */
+	std::mutex finished_mutex;
+	/**
+	 * Signalled when a match finishes
+	 */
+	std::condition_variable finished_cv;
+	/**
+	 * Number of matches that are over
+	 */
+	int64_t finished_matches;
+	/**
+	 * Runs one tick of a match, and starts the player updates it allows
+	 *
+	 * @param      match  The match
+	 */
+	void Tick(ScheduledMatch* match);
+	/**
+	 * Runs one player's update for a match
+	 *
+	 * @param      match      The match
+	 * @param[in]  player_id  The player
+	 */
+	void UpdatePlayer(ScheduledMatch* match, state::PlayerId player_id);
+	/**
+	 * Marks a task of the current tick as finished, queueing the next
+	 * tick if it was the last one
+	 *
+	 * @param      match  The match
+	 */
+	void FinishTask(ScheduledMatch* match);
+public:
+	/**
+	 * Constructor for MatchScheduler
+	 *
+	 * @param[in]  thread_count  Number of threads shared by the matches,
+	 *                           0 for one per hardware thread
+	 */
+	MatchScheduler(int64_t thread_count);
+	/**
+	 * Adds a match to be run
+	 *
+	 * The match must be headless, and must not be Run by anything else
+	 *
+	 * @param[in]  driver  The match
+	 */
+	void AddMatch(std::shared_ptr<MainDriver> driver);
+	/**
+	 * Runs all the matches added, returning when all of them are over
+	 *
+	 * Must be called only once
+	 */
+	void Run();
+};
+
+}
+
+#endif
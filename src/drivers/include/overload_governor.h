@@ -0,0 +1,211 @@
+/**
+ * @file overload_governor.h
+ * Declarations for degrading a match gracefully when its ticks overrun
+ */
+
+#ifndef DRIVERS_OVERLOAD_GOVERNOR_H
+#define DRIVERS_OVERLOAD_GOVERNOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include "drivers_export.h"
+
+namespace drivers {
+
+/**
+ * How far a match has been degraded to keep up with its frame rate
+ *
+ * Each level also applies the degradations of the levels below it
+ */
+enum OVERLOAD_LEVEL {
+	/**
+	 * Running normally
+	 */
+	OVERLOAD_NONE,
+	/**
+	 * Only every few ticks are sent to the renderer
+	 */
+	OVERLOAD_SKIP_FRAMES,
+	/**
+	 * LOS is refreshed only every few ticks
+	 */
+	OVERLOAD_REDUCE_LOS,
+	/**
+	 * dt is capped at one frame, late ticks are split into a few substeps
+	 * and any time beyond those is dropped
+	 */
+	OVERLOAD_SUBSTEP
+};
+
+/**
+ * What the overload handling has done so far
+ */
+struct OverloadCounters {
+	/**
+	 * Ticks that took longer than a frame
+	 */
+	int64_t overrun_ticks;
+	/**
+	 * Ticks not sent to the renderer
+	 */
+	int64_t skipped_frames;
+	/**
+	 * Ticks run with a reduced LOS refresh rate
+	 */
+	int64_t reduced_los_ticks;
+	/**
+	 * Extra substeps run to catch up
+	 */
+	int64_t catch_up_substeps;
+	/**
+	 * Game time dropped because it could not be caught up
+	 */
+	std::chrono::nanoseconds dropped_time;
+	/**
+	 * Highest level reached
+	 */
+	OVERLOAD_LEVEL max_level;
+
+	OverloadCounters() :
+		overrun_ticks(0),
+		skipped_frames(0),
+		reduced_los_ticks(0),
+		catch_up_substeps(0),
+		dropped_time(0),
+		max_level(OVERLOAD_NONE) {}
+};
+
+/**
+ * Watches how long the ticks of a match take, and picks the degradation
+ * that lets it keep up
+ *
+ * A tick overruns if its work takes longer than a frame. After
+ * OVERRUN_TICKS overruns in a row the level goes up by one, after
+ * RECOVER_TICKS ticks in a row comfortably inside the frame it goes back
+ * down by one
+ */
+class DRIVERS_EXPORT OverloadGovernor {
+private:
+	/**
+	 * Consecutive overruns that raise the level
+	 */
+	static const int64_t OVERRUN_TICKS = 5;
+	/**
+	 * Consecutive comfortable ticks that lower the level
+	 */
+	static const int64_t RECOVER_TICKS = 60;
+	/**
+	 * Percentage of a frame a tick must stay under to count as
+	 * comfortable
+	 */
+	static const int64_t RECOVER_PERCENT = 75;
+	/**
+	 * Ticks per frame sent to the renderer while skipping frames
+	 */
+	static const int64_t FRAME_SKIP = 2;
+	/**
+	 * Ticks per LOS refresh while LOS is reduced
+	 */
+	static const int64_t LOS_UPDATE_INTERVAL = 3;
+	/**
+	 * Most substeps a single tick is split into
+	 */
+	static const int64_t MAX_SUBSTEPS = 3;
+	/**
+	 * If false, the level never rises
+	 */
+	bool is_enabled;
+	/**
+	 * Time between the starts of consecutive ticks
+	 */
+	std::chrono::nanoseconds frame_period;
+	/**
+	 * The current level
+	 */
+	OVERLOAD_LEVEL level;
+	/**
+	 * Number of overruns in a row
+	 */
+	int64_t overrun_streak;
+	/**
+	 * Number of comfortable ticks in a row
+	 */
+	int64_t recover_streak;
+	/**
+	 * Number of ticks since one was sent to the renderer
+	 */
+	int64_t ticks_since_frame;
+	/**
+	 * What has been done so far
+	 */
+	OverloadCounters counters;
+public:
+	/**
+	 * Constructor for OverloadGovernor
+	 *
+	 * @param[in]  is_enabled    If false, the match is never degraded
+	 * @param[in]  frame_period  Time between the starts of consecutive
+	 *                           ticks
+	 */
+	OverloadGovernor(bool is_enabled, std::chrono::nanoseconds frame_period);
+	/**
+	 * Records how long the work of a tick took, and adjusts the level
+	 *
+	 * @param[in]  work_time  Time from the start of the tick to the end of
+	 *                        its work, not counting the sleep after it
+	 */
+	void RecordTick(std::chrono::nanoseconds work_time);
+	/**
+	 * Gets the current level
+	 *
+	 * @return     The level
+	 */
+	OVERLOAD_LEVEL GetLevel();
+	/**
+	 * Decides whether this tick is sent to the renderer
+	 *
+	 * Must be called once per tick
+	 *
+	 * @return     true if it should be sent, false if it is skipped
+	 */
+	bool ShouldSendFrame();
+	/**
+	 * Gets how often LOS should be refreshed at the current level
+	 *
+	 * Must be called once per tick
+	 *
+	 * @return     Number of ticks per LOS refresh
+	 */
+	int64_t GetLosUpdateInterval();
+	/**
+	 * Splits the time elapsed since the last tick into substeps
+	 *
+	 * Below OVERLOAD_SUBSTEP the time is a single step. Otherwise each
+	 * substep is at most a frame long, and time beyond MAX_SUBSTEPS
+	 * frames is dropped
+	 *
+	 * @param      update_duration  The time elapsed, reduced to the time
+	 *                              that is simulated
+	 *
+	 * @return     The number of substeps
+	 */
+	int64_t GetSubsteps(std::chrono::nanoseconds& update_duration);
+	/**
+	 * Gets what has been done so far
+	 *
+	 * @return     The counters
+	 */
+	const OverloadCounters& GetCounters();
+	/**
+	 * Prints the counters
+	 *
+	 * @param      out   The stream to print to
+	 */
+	void Print(std::ostream& out);
+};
+
+}
+
+#endif
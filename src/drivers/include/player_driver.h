@@ -9,11 +9,17 @@
 #include <memory>
 #include <atomic>
 #include <thread>
-#include <ctime>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <vector>
 
 #include "state.h"
 #include "player_state_handler/player_state_handler.h"
 #include "player_ai.h"
+#include "ipc.h"
+#include "profiler/latency_histogram.h"
 
 namespace drivers {
 
@@ -43,9 +49,40 @@ private:
 	 */
 	std::atomic<bool> is_paused;
 	/**
-	 * Time consumed by the PlayerDriver
+	 * Guards changes to is_modify_done, is_paused and game_over that
+	 * the UpdateLoop and WaitForModifyDone wait on
 	 */
-	float total_time;
+	std::mutex wait_mutex;
+	/**
+	 * Signalled whenever is_modify_done, is_paused or game_over change,
+	 * so that waiting threads can sleep instead of spinning
+	 */
+	std::condition_variable wait_cv;
+	/**
+	 * Thread CPU time consumed by the player's updates, in nanoseconds
+	 */
+	int64_t total_time;
+	/**
+	 * Thread CPU time taken by the most recent update, in nanoseconds
+	 *
+	 * Written before is_modify_done is set, so it is safe to read once
+	 * GetIsModifyDone returns true
+	 */
+	int64_t last_think_time;
+	/**
+	 * Thread CPU time allowed for a single update, in nanoseconds
+	 *
+	 * 0 if there is no budget
+	 */
+	int64_t think_budget;
+	/**
+	 * Number of updates that took longer than think_budget
+	 */
+	int64_t over_budget_count;
+	/**
+	 * Thread CPU time taken by each update, in nanoseconds
+	 */
+	state::LatencyHistogram think_times;
 	/**
 	 * Thread object in which UpdateLoop of PlayerDriver class runs
 	 */
@@ -58,12 +95,21 @@ private:
 	 * Player AI code
 	 */
 	player::PlayerAi code;
+	/**
+	 * The player whose code this runs, which its logs are counted against
+	 */
+	state::PlayerId player_id;
+	/**
+	 * The Logger of the match, which the player's logs go to
+	 */
+	ipc::Logger* logger;
 	/**
 	 * Runs PlayerDriver Updates in an Infinite Loop
 	 */
 	void UpdateLoop();
 public:
-	PlayerDriver(std::shared_ptr<state::PlayerStateHandler> player_buffer, player::PlayerAi player_code);
+	PlayerDriver(std::shared_ptr<state::PlayerStateHandler> player_buffer, player::PlayerAi player_code,
+		state::PlayerId player_id, ipc::Logger* logger, int64_t think_budget = 0);
 	/**
 	 * Gets the is_modify_done Boolean variable
 	 *
@@ -76,10 +122,41 @@ public:
 	 * @param[in]  val   The Value of is_modify_done Boolean variable to be set
 	 */
 	void SetIsModifyDone(bool val);
+	/**
+	 * Waits until the player has finished its update
+	 */
+	void WaitForModifyDone();
+	/**
+	 * Waits until the player has finished its update, or until the
+	 * deadline
+	 *
+	 * @param[in]  deadline  The deadline
+	 *
+	 * @return     true if the update finished, false if the deadline passed
+	 */
+	bool WaitForModifyDone(std::chrono::steady_clock::time_point deadline);
 	/**
 	 * Creates a Thread whose Handler Function is the UpdateLoop
 	 */
 	void Run();
+	/**
+	 * Runs one Update of the player's code on the calling thread
+	 *
+	 * Used instead of Run when the updates are scheduled as tasks.
+	 * Must only be called while GetIsModifyDone returns false, and sets
+	 * it to true when done
+	 */
+	void RunUpdate();
+	/**
+	 * Restricts the UpdateLoop thread to a set of CPUs
+	 *
+	 * Must be called after Run
+	 *
+	 * @param[in]  cpus  The CPUs
+	 *
+	 * @return     true if the affinity was set, false otherwise
+	 */
+	bool SetAffinity(const std::vector<int>& cpus);
 	/**
 	 * Sets is_paused to true
 	 */
@@ -95,9 +172,41 @@ public:
 	/**
 	 * Gives the Total Time consumed by the PlayerDriver
 	 *
-	 * @return     Time consumed
+	 * Only the CPU time of the PlayerDriver's own thread is counted
+	 *
+	 * @return     Time consumed in seconds
 	 */
 	float Time();
+	/**
+	 * Gets the thread CPU time taken by the most recent update
+	 *
+	 * Must only be called while GetIsModifyDone returns true
+	 *
+	 * @return     The time in nanoseconds
+	 */
+	int64_t GetLastThinkTime();
+	/**
+	 * Checks if the most recent update took longer than the think budget
+	 *
+	 * Must only be called while GetIsModifyDone returns true
+	 *
+	 * @return     true if over budget, false otherwise
+	 */
+	bool IsOverBudget();
+	/**
+	 * Gets the number of updates that took longer than the think budget
+	 *
+	 * @return     The count
+	 */
+	int64_t GetOverBudgetCount();
+	/**
+	 * Gets the histogram of thread CPU time taken by each update
+	 *
+	 * Must only be read after the PlayerDriver has been stopped
+	 *
+	 * @return     The histogram
+	 */
+	const state::LatencyHistogram& GetThinkTimes();
 };
 
 }
@@ -0,0 +1,132 @@
+/**
+ * @file thread_placement.h
+ * Declarations for placing the threads of a match on CPUs
+ */
+
+#ifndef DRIVERS_THREAD_PLACEMENT_H
+#define DRIVERS_THREAD_PLACEMENT_H
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "driver_options.h"
+#include "drivers_export.h"
+
+namespace drivers {
+
+/**
+ * The threads of a match that are placed
+ */
+enum THREAD_ROLE {
+	/**
+	 * The thread running the MainDriver's game loop
+	 */
+	GAME_THREAD,
+	/**
+	 * The thread running Player 1's PlayerDriver
+	 */
+	PLAYER1_THREAD,
+	/**
+	 * The thread running Player 2's PlayerDriver
+	 */
+	PLAYER2_THREAD,
+	/**
+	 * Number of roles, not a role
+	 */
+	THREAD_ROLE_COUNT
+};
+
+/**
+ * Parses a CPU list such as "0-3,8,10-11"
+ *
+ * @param[in]  list  The list
+ *
+ * @return     The CPUs in the list, in ascending order
+ */
+DRIVERS_EXPORT std::vector<int> ParseCpuList(const std::string& list);
+
+/**
+ * Formats CPUs as a CPU list, collapsing runs into ranges
+ *
+ * @param[in]  cpus  The CPUs, in ascending order
+ *
+ * @return     The CPU list
+ */
+DRIVERS_EXPORT std::string FormatCpuList(const std::vector<int>& cpus);
+
+/**
+ * Restricts a thread to a set of CPUs
+ *
+ * @param      thread  The thread
+ * @param[in]  cpus    The CPUs, if empty the thread is left alone
+ *
+ * @return     true if the affinity was set, false otherwise
+ */
+DRIVERS_EXPORT bool SetThreadAffinity(std::thread& thread, const std::vector<int>& cpus);
+
+/**
+ * Decides which CPUs each thread of a match runs on
+ */
+class DRIVERS_EXPORT ThreadPlacement {
+private:
+	/**
+	 * The policy the placement was made with
+	 *
+	 * AFFINITY_NONE if the threads couldn't be placed as asked
+	 */
+	AFFINITY_POLICY policy;
+	/**
+	 * The CPUs left after restricting to the placement domain
+	 */
+	std::vector<int> available_cpus;
+	/**
+	 * The CPUs each thread may run on, indexed by THREAD_ROLE
+	 *
+	 * Empty if the thread is not placed
+	 */
+	std::vector<std::vector<int> > thread_cpus;
+public:
+	/**
+	 * Decides a placement
+	 *
+	 * @param[in]  options  The options holding the affinity policy,
+	 *                      the CPUs and the placement domain
+	 */
+	ThreadPlacement(const DriverOptions& options);
+	/**
+	 * Gets the policy the placement was made with
+	 *
+	 * @return     The policy, AFFINITY_NONE if the threads are left to the
+	 *             scheduler
+	 */
+	AFFINITY_POLICY GetPolicy() const;
+	/**
+	 * Gets the CPUs a thread may run on
+	 *
+	 * @param[in]  role  The thread's role
+	 *
+	 * @return     The CPUs, empty if the thread is not placed
+	 */
+	const std::vector<int>& GetCpus(THREAD_ROLE role) const;
+	/**
+	 * Applies the placement to a thread
+	 *
+	 * @param      thread  The thread
+	 * @param[in]  role    The thread's role
+	 *
+	 * @return     true if the thread was placed, false otherwise
+	 */
+	bool Apply(std::thread& thread, THREAD_ROLE role) const;
+	/**
+	 * Prints the placement that was chosen
+	 *
+	 * @param      out   The stream to print to
+	 */
+	void Print(std::ostream& out) const;
+};
+
+}
+
+#endif
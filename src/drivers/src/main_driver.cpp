@@ -1,12 +1,27 @@
 #ifndef DRIVERS_MAIN_DRIVER
 #define DRIVERS_MAIN_DRIVER
 
+#include <algorithm>
 #include <chrono>
+#include <iostream>
+#include <csignal>
 #include "main_driver.h"
 #include "ipc.h"
+#include "profiler/tick_profiler.h"
 
 namespace drivers {
 
+#ifdef ENABLE_TICK_PROFILER
+/**
+ * Asks the TickProfiler to print its histograms at the end of the next tick
+ *
+ * Takes the signal number, as a signal handler must
+ */
+static void RequestProfilerDump(int) {
+	state::TickProfiler::Instance().RequestDump();
+}
+#endif
+
 MainDriver::MainDriver(
 	player::PlayerAi p1_code,
 	player::PlayerAi p2_code,
@@ -14,94 +29,328 @@ MainDriver::MainDriver(
 	std::shared_ptr<state::State> s2,
 	std::shared_ptr<state::State> s3,
 	int64_t total_game_duration,
-	bool is_headless) :
+	bool is_headless,
+	DriverOptions options) :
 	game_state(s1),
 	p1_state_buffer(s2),
 	p2_state_buffer(s3),
 	p1_buffer(new state::PlayerStateHandler(p1_state_buffer.get(), state::PLAYER1)),
 	p2_buffer(new state::PlayerStateHandler(p2_state_buffer.get(), state::PLAYER2)),
-	p1_driver(new PlayerDriver(p1_buffer, p1_code)),
-	p2_driver(new PlayerDriver(p2_buffer, p2_code)),
+	logger(new ipc::Logger),
+	p1_driver(new PlayerDriver(p1_buffer, p1_code, state::PLAYER1, logger.get(),
+		options.think_budget * 1000)),
+	p2_driver(new PlayerDriver(p2_buffer, p2_code, state::PLAYER2, logger.get(),
+		options.think_budget * 1000)),
 	game_over(false),
 	total_game_duration(total_game_duration),
 	fps(30),
-	is_headless(is_headless) {}
+	frame_period(std::chrono::nanoseconds(1000000000) / std::max((int64_t) 1, options.tick_rate)),
+	wall_frame_period(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		frame_period / std::max(0.01, options.speed))),
+	output_period(options.output_rate > 0
+		? std::chrono::nanoseconds(1000000000) / options.output_rate
+		: std::chrono::nanoseconds(0)),
+	ticks(0),
+	next_output(0),
+	is_headless(is_headless),
+	options(options),
+	placement(options),
+	p1_penalty_ticks(0),
+	p2_penalty_ticks(0),
+	stepped_game_duration(0),
+	frame_times(),
+	overload(options.degrade_on_overload && !options.lockstep, frame_period),
+	output(),
+	delta_encoder(),
+	replay(),
+	state_writer(),
+	snapshot(new ipc::FrameData),
+	p1_lockstep_timeouts(0),
+	p2_lockstep_timeouts(0) {
+	// Each player draws from its own generator, so neither changes what
+	// the other draws
+	p1_code.Seed(options.seed);
+	p2_code.Seed(options.seed + 1);
+	logger->SetLimits(options.log_records_per_frame, options.log_bytes_per_frame);
+	if (options.worker_threads != 1) {
+		game_state->SetWorkerPool(std::shared_ptr<state::WorkerPool>(
+			new state::WorkerPool(options.worker_threads)));
+	}
+	if (!options.shm_ring_name.empty() && !is_headless) {
+		std::unique_ptr<ipc::ShmRingWriter> ring(
+			new ipc::ShmRingWriter(options.shm_ring_name, options.shm_ring_capacity));
+		if (ring->IsOpen()) {
+			output = std::move(ring);
+		}
+		else {
+			std::cerr << "Could not make the shared memory ring "
+				<< options.shm_ring_name << ", writing to stdout" << std::endl;
+		}
+	}
+	if (!output) {
+		output.reset(new ipc::StreamOutput(std::cout));
+	}
+	if (!options.replay_file.empty()) {
+		replay.reset(new ipc::ReplayWriter(options.replay_file, options.replay_keyframe_interval));
+		if (!replay->IsOpen()) {
+			std::cerr << "Could not make the replay file " << options.replay_file << std::endl;
+			replay.reset();
+		}
+	}
+	if (options.async_output && !is_headless) {
+		state_writer.reset(new ipc::StateWriter(output.get(), options.output_queue_capacity,
+			options.output_queue_policy, options.los_format, options.delta_keyframe_interval,
+			replay.get()));
+	}
+	else if (replay && is_headless) {
+		state_writer.reset(new ipc::StateWriter(nullptr, options.output_queue_capacity,
+			options.output_queue_policy, options.los_format, 0, replay.get()));
+	}
+	else if (options.delta_keyframe_interval > 0) {
+		delta_encoder.reset(new ipc::DeltaEncoder(options.delta_keyframe_interval,
+			options.los_format));
+	}
+}
 
-void MainDriver::GlobalUpdateLoop() {
+bool MainDriver::HandlePlayerUpdate(
+	PlayerDriver& driver,
+	int64_t& penalty_ticks,
+	state::State& buffer,
+	state::PlayerId player_id) {
+
+	if (penalty_ticks > 0) {
+		// The commands were merged when the penalty was given
+		penalty_ticks--;
+		return penalty_ticks == 0;
+	}
+	if (!driver.IsOverBudget()) {
+		game_state->MergeWithBuffer(buffer, player_id);
+		return true;
+	}
+	switch (options.think_budget_policy) {
+	case DROP_COMMANDS:
+		// Refreshing the buffer from the main State discards the commands
+		return true;
+	case PENALISE:
+		game_state->MergeWithBuffer(buffer, player_id);
+		penalty_ticks = driver.GetLastThinkTime() / (options.think_budget * 1000);
+		return false;
+	}
+	return true;
+}
+
+void MainDriver::UpdateGameState(float delta_time, int64_t substeps) {
 	bool modified1, modified2;
 
+	modified1 = modified2 = false;
+	{
+		PROFILE_TICK_PHASE(MERGE_WITH_BUFFER);
+		if (p1_driver->GetIsModifyDone()) {
+			modified1 = HandlePlayerUpdate(*p1_driver, p1_penalty_ticks,
+				*p1_state_buffer, state::PLAYER1);
+		}
+		if (p2_driver->GetIsModifyDone()) {
+			modified2 = HandlePlayerUpdate(*p2_driver, p2_penalty_ticks,
+				*p2_state_buffer, state::PLAYER2);
+		}
+	}
+	for (int64_t i = 0; i < substeps; ++i) {
+		game_state->Update(delta_time / substeps);
+	}
+	ticks++;
+	{
+		PROFILE_TICK_PHASE(MERGE_WITH_MAIN);
+		if (modified1) {
+			p1_state_buffer->MergeWithMain(*game_state);
+		}
+		if (modified2) {
+			p2_state_buffer->MergeWithMain(*game_state);
+		}
+	}
+	if (modified1) {
+		p1_driver->SetIsModifyDone(false);
+	}
+	if (modified2) {
+		p2_driver->SetIsModifyDone(false);
+	}
+}
+
+void MainDriver::WaitForPlayers() {
+	if (options.lockstep_timeout <= 0) {
+		p1_driver->WaitForModifyDone();
+		p2_driver->WaitForModifyDone();
+		return;
+	}
+	// Both players share one deadline, they run at the same time
+	auto deadline = std::chrono::steady_clock::now()
+		+ std::chrono::milliseconds(options.lockstep_timeout);
+	if (!p1_driver->WaitForModifyDone(deadline)) {
+		p1_lockstep_timeouts++;
+	}
+	if (!p2_driver->WaitForModifyDone(deadline)) {
+		p2_lockstep_timeouts++;
+	}
+}
+
+void MainDriver::PrintStats() {
+	std::cerr << "Player 1 CPU time: " << p1_driver->Time() << "s, "
+		<< p1_driver->GetOverBudgetCount() << " updates over budget" << std::endl;
+	p1_driver->GetThinkTimes().Print(std::cerr, "Player 1 think time");
+	std::cerr << "Player 2 CPU time: " << p2_driver->Time() << "s, "
+		<< p2_driver->GetOverBudgetCount() << " updates over budget" << std::endl;
+	p2_driver->GetThinkTimes().Print(std::cerr, "Player 2 think time");
+	std::cerr << "CPU time ratio (Player 1 / Player 2): " << LogTimeRatio() << std::endl;
+	frame_times.Print(std::cerr, "Frame time");
+	overload.Print(std::cerr);
+	auto ring = dynamic_cast<ipc::ShmRingWriter*>(output.get());
+	if (ring) {
+		std::cerr << "Shared memory ring: " << ring->GetDroppedFrames()
+			<< " frames dropped" << std::endl;
+	}
+	if (state_writer) {
+		std::cerr << "Output: " << state_writer->GetDroppedFrames() << " frames dropped, "
+			<< state_writer->GetCoalescedFrames() << " coalesced, "
+			<< state_writer->GetBlockedPushes() << " pushes blocked" << std::endl;
+	}
+	std::cerr << "Logs dropped: Player 1 " << logger->GetDroppedLogs(state::PLAYER1)
+		<< ", Player 2 " << logger->GetDroppedLogs(state::PLAYER2)
+		<< "; truncated: Player 1 " << logger->GetTruncatedLogs(state::PLAYER1)
+		<< ", Player 2 " << logger->GetTruncatedLogs(state::PLAYER2) << std::endl;
+	if (options.lockstep) {
+		std::cerr << "Lockstep ticks missed: Player 1 " << p1_lockstep_timeouts
+			<< ", Player 2 " << p2_lockstep_timeouts << std::endl;
+	}
+}
+
+void MainDriver::TransferState(bool exit_status, std::chrono::nanoseconds game_time) {
+	std::unique_ptr<ipc::FrameData> frame = state_writer
+		? state_writer->GetFrame() : std::move(snapshot);
+
+	ipc::SnapshotState(game_state, exit_status, frame.get());
+	frame->state.set_tick(ticks);
+	frame->state.set_game_time_us(
+		std::chrono::duration_cast<std::chrono::microseconds>(game_time).count());
+
+	if (state_writer) {
+		state_writer->Push(std::move(frame));
+		return;
+	}
+	// Writing synchronously already waits on the output, so recording does too
+	if (replay) {
+		replay->Record(*frame);
+	}
+	if (!is_headless) {
+		if (delta_encoder) {
+			delta_encoder->WriteFrame(*frame, *output);
+		}
+		else {
+			ipc::WriteState(*frame, options.los_format, *output);
+		}
+	}
+	snapshot = std::move(frame);
+}
+
+bool MainDriver::IsOutputDue(std::chrono::nanoseconds game_time) {
+	if (game_time < next_output) {
+		return false;
+	}
+	next_output += output_period;
+	if (next_output <= game_time) {
+		// Over a frame behind, so the next one is due a period from now
+		next_output = game_time + output_period;
+	}
+	return true;
+}
+
+std::chrono::nanoseconds MainDriver::ToGameTime(std::chrono::nanoseconds wall_time) {
+	if (options.speed == 1) {
+		return wall_time;
+	}
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(wall_time * options.speed);
+}
+
+float MainDriver::GetDeltaTime(std::chrono::nanoseconds update_duration) {
+	return std::chrono::duration<float, std::milli>(update_duration).count() / fps;
+}
+
+void MainDriver::WaitForNextFrame(std::chrono::steady_clock::time_point& next_frame) {
+	auto now = std::chrono::steady_clock::now();
+	if (now - next_frame > wall_frame_period) {
+		// Over a frame behind, so start afresh instead of rushing through
+		// the missed frames
+		next_frame = now;
+	}
+	else {
+		std::this_thread::sleep_until(next_frame);
+	}
+	next_frame += wall_frame_period;
+}
+
+void MainDriver::GlobalUpdateLoop() {
+	// The frames sent from this thread take the match's logs
+	ipc::Logger::SetThreadLogger(logger.get(), ipc::LOG_NO_PLAYER);
+
 	ipc::Interrupts* InterruptVar(new ipc::Interrupts);
 	std::thread RendererInput(ipc::IncomingInterrupts, InterruptVar);
+	placement.Apply(RendererInput, GAME_THREAD);
 
-	std::chrono::milliseconds game_duration(0);
+	std::chrono::nanoseconds game_duration(0);
 
-	auto prev_time = std::chrono::high_resolution_clock::now();
+	auto prev_time = std::chrono::steady_clock::now();
+	auto next_frame = prev_time + wall_frame_period;
 
 	while(1) {
 		if (game_over) {
 			break;
 		}
 
-		auto start_time = std::chrono::high_resolution_clock::now();
-		auto update_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-			start_time - prev_time
-		);
+		if (options.lockstep) {
+			WaitForPlayers();
+		}
+
+		auto start_time = std::chrono::steady_clock::now();
+		std::chrono::nanoseconds update_duration = start_time - prev_time;
+		if (game_duration.count() > 0) {
+			frame_times.Record(update_duration.count());
+		}
+		update_duration = options.lockstep ? frame_period : ToGameTime(update_duration);
+		int64_t substeps = overload.GetSubsteps(update_duration);
 		game_duration += update_duration;
 		prev_time = start_time;
 
-		modified1 = modified2 = false;
-		if(p1_driver->GetIsModifyDone()) {
-			game_state->MergeWithBuffer(*p1_state_buffer, state::PLAYER1);
-			modified1 = true;
-		}
-		if (p2_driver->GetIsModifyDone()) {
-			game_state->MergeWithBuffer(*p2_state_buffer, state::PLAYER2);
-			modified2 = true;
-		}
-		game_state->Update((float) update_duration.count() / fps);
-		if (modified1) {
-			p1_state_buffer->MergeWithMain(*game_state);
-		}
-		if (modified2) {
-			p2_state_buffer->MergeWithMain(*game_state);
-		}
-		if (modified1) {
-			p1_driver->SetIsModifyDone(false);
-		}
-		if (modified2) {
-			p2_driver->SetIsModifyDone(false);
-		}
+		game_state->SetLosUpdateInterval(overload.GetLosUpdateInterval());
+		UpdateGameState(GetDeltaTime(update_duration), substeps);
 
-		if (game_duration.count() >= total_game_duration) {
-			ipc::StateTransfer(game_state, true);
+		if (game_duration >= std::chrono::milliseconds(total_game_duration)) {
+			PROFILE_TICK_PHASE(STATE_TRANSFER);
+			TransferState(true, game_duration);
 			break;
 		}
-		else {
-			ipc::StateTransfer(game_state, false);
+		// The governor counts every tick, due or not
+		bool is_frame_sent = overload.ShouldSendFrame();
+		if (IsOutputDue(game_duration) && is_frame_sent) {
+			PROFILE_TICK_PHASE(STATE_TRANSFER);
+			TransferState(false, game_duration);
 		}
 
-		auto end_time = std::chrono::high_resolution_clock::now();
-		auto calculcation_duration =
-			std::chrono::duration_cast<std::chrono::milliseconds>(
-				end_time - start_time
-			);
-		std::this_thread::sleep_for(std::chrono::milliseconds(
-			std::max<long>((long)0, 1000 / fps - calculcation_duration.count()))
-		);
+		auto work_time = std::chrono::steady_clock::now() - start_time;
+		overload.RecordTick(ToGameTime(work_time));
+		PROFILE_TICK_RECORD(TICK, work_time);
+#ifdef ENABLE_TICK_PROFILER
+		state::TickProfiler::Instance().DumpIfRequested(std::cerr);
+#endif
+		WaitForNextFrame(next_frame);
 
 		if (!InterruptVar->GetPlayStatus()) {
-			auto pause_start_time = std::chrono::high_resolution_clock::now();
+			auto pause_start_time = std::chrono::steady_clock::now();
 			p1_driver->Pause();
 			p2_driver->Pause();
-			while (!InterruptVar->GetPlayStatus());
+			InterruptVar->WaitForPlay();
 			p1_driver->Resume();
 			p2_driver->Resume();
-			auto pause_end_time = std::chrono::high_resolution_clock::now();
-			auto pause_duration =
-				std::chrono::duration_cast<std::chrono::milliseconds>(
-					pause_end_time - pause_start_time
-				);
+			auto pause_duration = std::chrono::steady_clock::now() - pause_start_time;
 			prev_time += pause_duration;
+			next_frame += pause_duration;
 		}
 	}
 	RendererInput.join();
@@ -109,67 +358,107 @@ void MainDriver::GlobalUpdateLoop() {
 }
 
 void MainDriver::GlobalUpdateLoopHeadless() {
-	bool modified1, modified2;
+	// The frames sent from this thread take the match's logs
+	ipc::Logger::SetThreadLogger(logger.get(), ipc::LOG_NO_PLAYER);
 
-	std::chrono::milliseconds game_duration(0);
+	std::chrono::nanoseconds game_duration(0);
 
-	auto prev_time = std::chrono::high_resolution_clock::now();
+	auto prev_time = std::chrono::steady_clock::now();
+	auto next_frame = prev_time + wall_frame_period;
 
 	while(1) {
 		if (game_over) {
 			break;
 		}
 
-		auto start_time = std::chrono::high_resolution_clock::now();
-		auto update_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-			start_time - prev_time
-		);
+		if (options.lockstep) {
+			WaitForPlayers();
+		}
+
+		auto start_time = std::chrono::steady_clock::now();
+		std::chrono::nanoseconds update_duration = start_time - prev_time;
+		if (game_duration.count() > 0) {
+			frame_times.Record(update_duration.count());
+		}
+		update_duration = options.lockstep ? frame_period : ToGameTime(update_duration);
+		int64_t substeps = overload.GetSubsteps(update_duration);
 		game_duration += update_duration;
 		prev_time = start_time;
 
-		modified1 = modified2 = false;
-		if(p1_driver->GetIsModifyDone()) {
-			game_state->MergeWithBuffer(*p1_state_buffer, state::PLAYER1);
-			modified1 = true;
-		}
-		if (p2_driver->GetIsModifyDone()) {
-			game_state->MergeWithBuffer(*p2_state_buffer, state::PLAYER2);
-			modified2 = true;
-		}
-		game_state->Update((float) update_duration.count() / fps);
-		if (modified1) {
-			p1_state_buffer->MergeWithMain(*game_state);
-		}
-		if (modified2) {
-			p2_state_buffer->MergeWithMain(*game_state);
-		}
-		if (modified1) {
-			p1_driver->SetIsModifyDone(false);
-		}
-		if (modified2) {
-			p2_driver->SetIsModifyDone(false);
-		}
+		game_state->SetLosUpdateInterval(overload.GetLosUpdateInterval());
+		UpdateGameState(GetDeltaTime(update_duration), substeps);
 
-		if (game_duration.count() >= total_game_duration) {
+		if (game_duration >= std::chrono::milliseconds(total_game_duration)) {
+			if (replay) {
+				TransferState(true, game_duration);
+			}
 			break;
 		}
+		else if (replay && IsOutputDue(game_duration)) {
+			TransferState(false, game_duration);
+		}
 
-		auto end_time = std::chrono::high_resolution_clock::now();
-		auto calculcation_duration =
-			std::chrono::duration_cast<std::chrono::milliseconds>(
-				end_time - start_time
-			);
-		std::this_thread::sleep_for(std::chrono::milliseconds(
-			std::max<long>((long)0, 1000 / fps - calculcation_duration.count()))
-		);
+		auto work_time = std::chrono::steady_clock::now() - start_time;
+		overload.RecordTick(ToGameTime(work_time));
+		PROFILE_TICK_RECORD(TICK, work_time);
+#ifdef ENABLE_TICK_PROFILER
+		state::TickProfiler::Instance().DumpIfRequested(std::cerr);
+#endif
+		// Without a renderer to keep up with, lockstep runs flat out
+		if (!options.lockstep) {
+			WaitForNextFrame(next_frame);
+		}
 	}
 	Stop();
 }
 
-void MainDriver::Run() {
+std::shared_ptr<PlayerDriver> MainDriver::GetPlayerDriver(state::PlayerId player_id) {
+	return player_id == state::PLAYER1 ? p1_driver : p2_driver;
+}
+
+void MainDriver::Start() {
 	game_state->Update(1);
 	p1_state_buffer->MergeWithMain(*game_state);
 	p2_state_buffer->MergeWithMain(*game_state);
+}
+
+bool MainDriver::Step() {
+	PROFILE_TICK_PHASE(TICK);
+
+	UpdateGameState(GetDeltaTime(frame_period));
+	stepped_game_duration += frame_period;
+
+	bool is_over = stepped_game_duration >= std::chrono::milliseconds(total_game_duration);
+	if (replay && (is_over || IsOutputDue(stepped_game_duration))) {
+		TransferState(is_over, stepped_game_duration);
+	}
+
+	return is_over;
+}
+
+bool MainDriver::CanPlayerUpdate(state::PlayerId player_id) {
+	return !GetPlayerDriver(player_id)->GetIsModifyDone();
+}
+
+void MainDriver::UpdatePlayer(state::PlayerId player_id) {
+	GetPlayerDriver(player_id)->RunUpdate();
+}
+
+std::shared_ptr<state::State> MainDriver::GetState() {
+	return game_state;
+}
+
+const OverloadCounters& MainDriver::GetOverloadCounters() {
+	return overload.GetCounters();
+}
+
+void MainDriver::Run() {
+	Start();
+
+#ifdef ENABLE_TICK_PROFILER
+	// kill -USR1 <pid> prints the histograms collected so far
+	std::signal(SIGUSR1, RequestProfilerDump);
+#endif
 
 	p1_driver->Run();
 	p2_driver->Run();
@@ -179,6 +468,16 @@ void MainDriver::Run() {
 	else {
 		runner = std::thread(&MainDriver::GlobalUpdateLoopHeadless, this);
 	}
+
+	if (placement.GetPolicy() != AFFINITY_NONE) {
+		bool placed = placement.Apply(runner, GAME_THREAD);
+		placed = p1_driver->SetAffinity(placement.GetCpus(PLAYER1_THREAD)) && placed;
+		placed = p2_driver->SetAffinity(placement.GetCpus(PLAYER2_THREAD)) && placed;
+		placement.Print(std::cerr);
+		if (!placed) {
+			std::cerr << "Could not apply the thread placement" << std::endl;
+		}
+	}
 }
 
 void MainDriver::Join() {
@@ -189,6 +488,18 @@ void MainDriver::Stop() {
 	StopP1();
 	StopP2();
 	game_over = true;
+	if (state_writer) {
+		state_writer->Stop();
+	}
+	if (replay) {
+		replay->Close();
+	}
+	if (options.print_stats) {
+		PrintStats();
+	}
+#ifdef ENABLE_TICK_PROFILER
+	state::TickProfiler::Instance().Print(std::cerr);
+#endif
 }
 
 void MainDriver::StopP1() {
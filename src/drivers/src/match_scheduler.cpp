@@ -0,0 +1,79 @@
+/**
+ * @file match_scheduler.cpp
+ * Defines the MatchScheduler class
+ */
+
+#include "match_scheduler.h"
+
+namespace drivers {
+
+MatchScheduler::MatchScheduler(int64_t thread_count):
+	pool(thread_count),
+	matches(),
+	finished_mutex(),
+	finished_cv(),
+	finished_matches(0) {}
+
+void MatchScheduler::AddMatch(std::shared_ptr<MainDriver> driver) {
+	std::unique_ptr<ScheduledMatch> match(new ScheduledMatch());
+	match->driver = driver;
+	match->pending_tasks = 0;
+	matches.push_back(std::move(match));
+}
+
+void MatchScheduler::Tick(ScheduledMatch* match) {
+	if (match->driver->Step()) {
+		match->driver->Stop();
+		std::lock_guard<std::mutex> lock(finished_mutex);
+		finished_matches++;
+		finished_cv.notify_all();
+		return;
+	}
+
+	std::vector<state::PlayerId> players;
+	for (auto player_id : {state::PLAYER1, state::PLAYER2}) {
+		if (match->driver->CanPlayerUpdate(player_id)) {
+			players.push_back(player_id);
+		}
+	}
+
+	// The tick itself counts as a task, so a player update finishing
+	// early can't queue the next tick before the others are submitted
+	match->pending_tasks = players.size() + 1;
+	for (auto player_id : players) {
+		pool.Submit([this, match, player_id] {
+			UpdatePlayer(match, player_id);
+		});
+	}
+	FinishTask(match);
+}
+
+void MatchScheduler::UpdatePlayer(ScheduledMatch* match, state::PlayerId player_id) {
+	match->driver->UpdatePlayer(player_id);
+	FinishTask(match);
+}
+
+void MatchScheduler::FinishTask(ScheduledMatch* match) {
+	if (--match->pending_tasks == 0) {
+		pool.Submit([this, match] {
+			Tick(match);
+		});
+	}
+}
+
+void MatchScheduler::Run() {
+	for (auto& match : matches) {
+		match->driver->Start();
+		ScheduledMatch* scheduled = match.get();
+		pool.Submit([this, scheduled] {
+			Tick(scheduled);
+		});
+	}
+
+	std::unique_lock<std::mutex> lock(finished_mutex);
+	finished_cv.wait(lock, [this] {
+		return finished_matches == (int64_t) matches.size();
+	});
+}
+
+}
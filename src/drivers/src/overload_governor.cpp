@@ -0,0 +1,105 @@
+/**
+ * @file overload_governor.cpp
+ * Defines the OverloadGovernor class
+ */
+
+#include <algorithm>
+
+#include "overload_governor.h"
+
+namespace drivers {
+
+const int64_t OverloadGovernor::OVERRUN_TICKS;
+const int64_t OverloadGovernor::RECOVER_TICKS;
+const int64_t OverloadGovernor::RECOVER_PERCENT;
+const int64_t OverloadGovernor::FRAME_SKIP;
+const int64_t OverloadGovernor::LOS_UPDATE_INTERVAL;
+const int64_t OverloadGovernor::MAX_SUBSTEPS;
+
+OverloadGovernor::OverloadGovernor(bool is_enabled, std::chrono::nanoseconds frame_period) :
+	is_enabled(is_enabled),
+	frame_period(frame_period),
+	level(OVERLOAD_NONE),
+	overrun_streak(0),
+	recover_streak(0),
+	ticks_since_frame(0),
+	counters() {}
+
+void OverloadGovernor::RecordTick(std::chrono::nanoseconds work_time) {
+	if (work_time > frame_period) {
+		counters.overrun_ticks++;
+		overrun_streak++;
+		recover_streak = 0;
+	}
+	else if (work_time * 100 < frame_period * RECOVER_PERCENT) {
+		recover_streak++;
+		overrun_streak = 0;
+	}
+	else {
+		overrun_streak = recover_streak = 0;
+	}
+
+	if (!is_enabled) {
+		return;
+	}
+	if (overrun_streak >= OVERRUN_TICKS && level < OVERLOAD_SUBSTEP) {
+		level = static_cast<OVERLOAD_LEVEL>(level + 1);
+		counters.max_level = std::max(counters.max_level, level);
+		overrun_streak = 0;
+	}
+	else if (recover_streak >= RECOVER_TICKS && level > OVERLOAD_NONE) {
+		level = static_cast<OVERLOAD_LEVEL>(level - 1);
+		recover_streak = 0;
+	}
+}
+
+OVERLOAD_LEVEL OverloadGovernor::GetLevel() {
+	return level;
+}
+
+bool OverloadGovernor::ShouldSendFrame() {
+	ticks_since_frame++;
+	if (level >= OVERLOAD_SKIP_FRAMES && ticks_since_frame < FRAME_SKIP) {
+		counters.skipped_frames++;
+		return false;
+	}
+	ticks_since_frame = 0;
+	return true;
+}
+
+int64_t OverloadGovernor::GetLosUpdateInterval() {
+	if (level >= OVERLOAD_REDUCE_LOS) {
+		counters.reduced_los_ticks++;
+		return LOS_UPDATE_INTERVAL;
+	}
+	return 1;
+}
+
+int64_t OverloadGovernor::GetSubsteps(std::chrono::nanoseconds& update_duration) {
+	if (level < OVERLOAD_SUBSTEP || update_duration <= frame_period) {
+		return 1;
+	}
+	auto max_duration = frame_period * MAX_SUBSTEPS;
+	if (update_duration > max_duration) {
+		counters.dropped_time += update_duration - max_duration;
+		update_duration = max_duration;
+	}
+	int64_t substeps = (update_duration + frame_period - std::chrono::nanoseconds(1)) / frame_period;
+	counters.catch_up_substeps += substeps - 1;
+	return substeps;
+}
+
+const OverloadCounters& OverloadGovernor::GetCounters() {
+	return counters;
+}
+
+void OverloadGovernor::Print(std::ostream& out) {
+	out << "Overload: " << counters.overrun_ticks << " ticks overran, "
+		<< counters.skipped_frames << " frames skipped, "
+		<< counters.reduced_los_ticks << " ticks with reduced LOS, "
+		<< counters.catch_up_substeps << " catch up substeps, "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(counters.dropped_time).count()
+		<< "ms dropped, highest level " << counters.max_level << std::endl;
+}
+
+}
@@ -1,15 +1,37 @@
 #ifndef DRIVERS_PLAYER_DRIVER
 #define DRIVERS_PLAYER_DRIVER
 
+#include <time.h>
+#include "ipc.h"
 #include "player_driver.h"
+#include "thread_placement.h"
 
 namespace drivers {
 
-PlayerDriver::PlayerDriver(std::shared_ptr<state::PlayerStateHandler> player_buffer, player::PlayerAi player_code) :
+/**
+ * Gets the CPU time consumed so far by the calling thread
+ *
+ * Unlike clock(), this does not count time spent by other threads
+ *
+ * @return     The time in nanoseconds
+ */
+static int64_t ThreadCpuTime() {
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+PlayerDriver::PlayerDriver(std::shared_ptr<state::PlayerStateHandler> player_buffer, player::PlayerAi player_code,
+	state::PlayerId player_id, ipc::Logger* logger, int64_t think_budget) :
 	is_modify_done(false),
 	game_over(false),
 	is_paused(false),
-	code(player_code)
+	last_think_time(0),
+	think_budget(think_budget),
+	over_budget_count(0),
+	code(player_code),
+	player_id(player_id),
+	logger(logger)
 {
 	total_time = 0;
 	buffer = player_buffer;
@@ -21,44 +43,112 @@ bool PlayerDriver::GetIsModifyDone() {
 }
 
 void PlayerDriver::SetIsModifyDone(bool val) {
-	std::atomic_store(&is_modify_done, val);
+	{
+		std::lock_guard<std::mutex> lock(wait_mutex);
+		std::atomic_store(&is_modify_done, val);
+	}
+	wait_cv.notify_all();
+}
+
+void PlayerDriver::WaitForModifyDone() {
+	std::unique_lock<std::mutex> lock(wait_mutex);
+	wait_cv.wait(lock, [this] {
+		return game_over || is_modify_done;
+	});
+}
+
+bool PlayerDriver::WaitForModifyDone(std::chrono::steady_clock::time_point deadline) {
+	std::unique_lock<std::mutex> lock(wait_mutex);
+	return wait_cv.wait_until(lock, deadline, [this] {
+		return game_over || is_modify_done;
+	}) && is_modify_done;
 }
 
 void PlayerDriver::UpdateLoop() {
 	while(1) {
-		if (game_over) {
-			break;
+		{
+			std::unique_lock<std::mutex> lock(wait_mutex);
+			wait_cv.wait(lock, [this] {
+				return game_over || (!is_paused && !is_modify_done);
+			});
+			if (game_over) {
+				break;
+			}
 		}
-		if (is_paused) {
-			while (is_paused);
-		}
-		if(is_modify_done) continue;
-		clock_t clocker = clock();
-		code.Update(buffer);
-		total_time += clock() - clocker;
+		RunUpdate();
+	}
+}
+
+void PlayerDriver::RunUpdate() {
+	// Updates of any match may share pool threads, so the Logger is set
+	// every time, and the thread's ring given back after
+	ipc::Logger::SetThreadLogger(logger, player_id);
+	int64_t clocker = ThreadCpuTime();
+	code.Update(buffer);
+	last_think_time = ThreadCpuTime() - clocker;
+	ipc::Logger::SetThreadLogger(nullptr, ipc::LOG_NO_PLAYER);
+	total_time += last_think_time;
+	think_times.Record(last_think_time);
+	if (IsOverBudget()) {
+		over_budget_count++;
+	}
+	{
+		std::lock_guard<std::mutex> lock(wait_mutex);
 		is_modify_done = true;
 	}
+	wait_cv.notify_all();
 }
 
 void PlayerDriver::Run() {
 	runner = std::thread(&PlayerDriver::UpdateLoop, this);
 }
 
+bool PlayerDriver::SetAffinity(const std::vector<int>& cpus) {
+	return SetThreadAffinity(runner, cpus);
+}
+
 void PlayerDriver::Pause() {
+	std::lock_guard<std::mutex> lock(wait_mutex);
 	is_paused = true;
 }
 
 void PlayerDriver::Resume() {
-	is_paused = false;
+	{
+		std::lock_guard<std::mutex> lock(wait_mutex);
+		is_paused = false;
+	}
+	wait_cv.notify_all();
 }
 
 void PlayerDriver::Stop() {
-	game_over = true;
-	runner.join();
+	{
+		std::lock_guard<std::mutex> lock(wait_mutex);
+		game_over = true;
+	}
+	wait_cv.notify_all();
+	if (runner.joinable()) {
+		runner.join();
+	}
 }
 
 float PlayerDriver::Time() {
-	return total_time;
+	return total_time / 1e9;
+}
+
+int64_t PlayerDriver::GetLastThinkTime() {
+	return last_think_time;
+}
+
+bool PlayerDriver::IsOverBudget() {
+	return think_budget > 0 && last_think_time > think_budget;
+}
+
+int64_t PlayerDriver::GetOverBudgetCount() {
+	return over_budget_count;
+}
+
+const state::LatencyHistogram& PlayerDriver::GetThinkTimes() {
+	return think_times;
 }
 
 }
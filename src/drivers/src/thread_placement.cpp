@@ -0,0 +1,216 @@
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include "thread_placement.h"
+
+namespace drivers {
+
+/**
+ * Names printed for each role, in THREAD_ROLE order
+ */
+static const char * ROLE_NAMES[THREAD_ROLE_COUNT] = {
+	"Game thread",
+	"Player 1 thread",
+	"Player 2 thread"
+};
+
+/**
+ * Reads the first line of a file
+ *
+ * @param[in]  file_name  The file name
+ *
+ * @return     The line, empty if the file could not be read
+ */
+static std::string ReadLine(const std::string& file_name) {
+	std::ifstream file(file_name);
+	std::string line;
+	std::getline(file, line);
+	return line;
+}
+
+/**
+ * Gets the CPUs the process is allowed to run on
+ *
+ * @return     The CPUs
+ */
+static std::vector<int> GetProcessCpus() {
+	std::vector<int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if (CPU_ISSET(cpu, &set)) {
+				cpus.push_back(cpu);
+			}
+		}
+	}
+	return cpus;
+}
+
+/**
+ * Gets the CPUs in the same placement domain as a CPU
+ *
+ * @param[in]  cpu     The CPU
+ * @param[in]  domain  The placement domain
+ *
+ * @return     The CPUs, empty if the domain could not be found
+ */
+static std::vector<int> GetDomainCpus(int cpu, PLACEMENT_DOMAIN domain) {
+	if (domain == DOMAIN_L3) {
+		std::string cache_dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+		for (int index = 0; ; ++index) {
+			std::string level = ReadLine(cache_dir + std::to_string(index) + "/level");
+			if (level.empty()) {
+				break;
+			}
+			if (level == "3") {
+				return ParseCpuList(ReadLine(cache_dir + std::to_string(index) + "/shared_cpu_list"));
+			}
+		}
+	}
+	else if (domain == DOMAIN_NUMA) {
+		std::string node_dir = "/sys/devices/system/node/node";
+		for (auto node : ParseCpuList(ReadLine("/sys/devices/system/node/possible"))) {
+			auto cpus = ParseCpuList(ReadLine(node_dir + std::to_string(node) + "/cpulist"));
+			if (std::binary_search(cpus.begin(), cpus.end(), cpu)) {
+				return cpus;
+			}
+		}
+	}
+	return std::vector<int>();
+}
+
+std::vector<int> ParseCpuList(const std::string& list) {
+	std::vector<int> cpus;
+	std::stringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ',')) {
+		int first, last;
+		int count = sscanf(range.c_str(), "%d-%d", &first, &last);
+		if (count < 1 || first < 0) {
+			continue;
+		}
+		if (count == 1) {
+			last = first;
+		}
+		for (int cpu = first; cpu <= last; ++cpu) {
+			cpus.push_back(cpu);
+		}
+	}
+	std::sort(cpus.begin(), cpus.end());
+	cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+	return cpus;
+}
+
+std::string FormatCpuList(const std::vector<int>& cpus) {
+	std::string list;
+	for (int64_t i = 0; i < static_cast<int64_t>(cpus.size()); ) {
+		int64_t j = i;
+		while (j + 1 < static_cast<int64_t>(cpus.size()) && cpus[j + 1] == cpus[j] + 1) {
+			j++;
+		}
+		if (!list.empty()) {
+			list += ',';
+		}
+		list += std::to_string(cpus[i]);
+		if (j > i) {
+			list += '-' + std::to_string(cpus[j]);
+		}
+		i = j + 1;
+	}
+	return list;
+}
+
+bool SetThreadAffinity(std::thread& thread, const std::vector<int>& cpus) {
+	if (cpus.empty()) {
+		return false;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (auto cpu : cpus) {
+		if (cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &set);
+		}
+	}
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+}
+
+ThreadPlacement::ThreadPlacement(const DriverOptions& options) :
+	policy(options.affinity_policy),
+	available_cpus(options.cpus.empty() ? GetProcessCpus() : options.cpus),
+	thread_cpus(THREAD_ROLE_COUNT) {
+
+	if (policy == AFFINITY_NONE || available_cpus.empty()) {
+		return;
+	}
+
+	/**
+	 * Without CPUs of its own, every match would pick the same first
+	 * CPUs and domain, piling concurrent matches onto the same cores
+	 */
+	if (options.cpus.empty()
+		&& (policy == AFFINITY_PIN || options.placement_domain != DOMAIN_ANY)) {
+		std::cerr << "Pinning threads or keeping them on a cache or node needs --cpus, "
+			<< "leaving them to the scheduler" << std::endl;
+		policy = AFFINITY_NONE;
+		return;
+	}
+
+	if (options.placement_domain != DOMAIN_ANY) {
+		auto domain_cpus = GetDomainCpus(available_cpus[0], options.placement_domain);
+		if (domain_cpus.empty()) {
+			std::cerr << "Could not find the placement domain of CPU "
+				<< available_cpus[0] << ", ignoring it" << std::endl;
+		}
+		else {
+			std::vector<int> cpus;
+			std::set_intersection(
+				available_cpus.begin(), available_cpus.end(),
+				domain_cpus.begin(), domain_cpus.end(),
+				std::back_inserter(cpus)
+			);
+			available_cpus = cpus;
+		}
+	}
+
+	for (int64_t role = 0; role < THREAD_ROLE_COUNT; ++role) {
+		if (policy == AFFINITY_PIN) {
+			// With fewer CPUs than threads, the threads share CPUs
+			thread_cpus[role].push_back(available_cpus[role % available_cpus.size()]);
+		}
+		else {
+			thread_cpus[role] = available_cpus;
+		}
+	}
+}
+
+AFFINITY_POLICY ThreadPlacement::GetPolicy() const {
+	return policy;
+}
+
+const std::vector<int>& ThreadPlacement::GetCpus(THREAD_ROLE role) const {
+	return thread_cpus[role];
+}
+
+bool ThreadPlacement::Apply(std::thread& thread, THREAD_ROLE role) const {
+	return SetThreadAffinity(thread, thread_cpus[role]);
+}
+
+void ThreadPlacement::Print(std::ostream& out) const {
+	if (policy == AFFINITY_NONE) {
+		out << "Thread placement: left to the scheduler" << std::endl;
+		return;
+	}
+	out << "Thread placement: " << (policy == AFFINITY_PIN ? "pinned" : "shared")
+		<< " on CPUs " << FormatCpuList(available_cpus) << std::endl;
+	for (int64_t role = 0; role < THREAD_ROLE_COUNT; ++role) {
+		out << "  " << ROLE_NAMES[role] << ": CPUs "
+			<< FormatCpuList(thread_cpus[role]) << std::endl;
+	}
+}
+
+}
@@ -8,11 +8,96 @@
 
 #include "state.h"
 #include "ipc_export.h"
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace IPC {
+	class State;
+	class StateDelta;
+	class Frame;
+}
+
+namespace google {
+namespace protobuf {
+	class MessageLite;
+}
+}
 
 namespace ipc {
 
+struct FrameData;
+
+/**
+ * Where the frames sent to the renderer are written
+ */
+class IPC_EXPORT FrameOutput {
+
+public:
+	virtual ~FrameOutput() {}
+
+	/**
+	 * Writes one frame
+	 *
+	 * @param[in]  Message  The frame's message
+	 */
+	virtual void Write(const google::protobuf::MessageLite& Message) = 0;
+};
+
+/**
+ * Writes frames back to back to a stream, such as the stdout pipe
+ */
+class IPC_EXPORT StreamOutput : public FrameOutput {
+
+private:
+	/**
+	 * The stream the frames are written to
+	 */
+	std::ostream& out;
+
+	/**
+	 * The bytes of the frame being written
+	 */
+	std::string buffer;
+
+public:
+	/**
+	 * Constructor for StreamOutput
+	 *
+	 * @param      out   The stream to write to
+	 */
+	StreamOutput(std::ostream& out);
+
+	void Write(const google::protobuf::MessageLite& Message) override;
+};
+
+/**
+ * How the LOS grids are encoded in the state sent to the renderer
+ *
+ * Renderers that don't know the los_format field only understand
+ * LOS_ROWS
+ */
+enum LOS_FORMAT {
+	/**
+	 * A message per row holding one enum per cell
+	 */
+	LOS_ROWS,
+	/**
+	 * Bytes holding 2 bits per cell, see PackLOS
+	 */
+	LOS_PACKED,
+	/**
+	 * Bytes holding runs of equal cells, see RunLengthEncodeLOS
+	 */
+	LOS_RUN_LENGTH
+};
+
 /**
  * Interrupts from the renderer to handle user interaction
  */
@@ -41,6 +126,16 @@ private:
 		 */
 		std::atomic<bool> restart;
 
+		/**
+		 * Guards play status changes that WaitForPlay waits on
+		 */
+		std::mutex play_mutex;
+
+		/**
+		 * Signalled when the play status changes
+		 */
+		std::condition_variable play_cv;
+
 public:
 		/**
 		 * Constructor for Interrupts
@@ -82,6 +177,14 @@ public:
 		 */
 		void SetPlayStatus(bool play_status);
 
+		/**
+		 * Blocks the calling thread until the play status is set to play
+		 *
+		 * Used instead of polling GetPlayStatus while the simulation
+		 * is paused
+		 */
+		void WaitForPlay();
+
 		/**
 		 * Sets the level number
 		 *
@@ -105,36 +208,212 @@ public:
 
 };
 
+/**
+ * Longest log kept, longer ones are cut short
+ */
+const uint64_t LOG_RECORD_LENGTH = 252;
+
+/**
+ * Number of logs each thread can have waiting to be sent
+ */
+const uint64_t LOG_RING_CAPACITY = 512;
+
+/**
+ * Number of threads that can log into one Logger at once
+ */
+const uint64_t LOG_MAX_THREADS = 16;
+
+/**
+ * Logs each player may send per frame when no limit is given
+ */
+const int64_t LOG_DEFAULT_RECORDS_PER_FRAME = 64;
+
+/**
+ * Bytes of logs each player may send per frame when no limit is given
+ */
+const int64_t LOG_DEFAULT_BYTES_PER_FRAME = 8192;
+
+/**
+ * Logs are counted against this instead of a player when they come from a
+ * thread that isn't running a player's update
+ */
+const int64_t LOG_NO_PLAYER = state::LAST_PLAYER + 1;
+
+/**
+ * A log, held in place so that logging never allocates
+ */
+struct LogRecord {
+	uint32_t length;
+	char text[LOG_RECORD_LENGTH];
+};
+
+/**
+ * Logs written by one thread, waiting to be sent
+ *
+ * Only the thread that claimed the ring writes to it, and only the thread
+ * draining the Logger reads from it, so neither takes a lock
+ */
+struct LogRing {
+	/**
+	 * True while a thread owns the ring
+	 */
+	std::atomic<bool> is_claimed;
+
+	/**
+	 * Number of logs written and read, kept on cache lines of their own
+	 */
+	alignas(64) std::atomic<uint64_t> write_position;
+	alignas(64) std::atomic<uint64_t> read_position;
+
+	std::array<LogRecord, LOG_RING_CAPACITY> records;
+};
+
+/**
+ * How much a player has logged
+ */
+struct LogCounters {
+	/**
+	 * Logs and bytes sent since the last drain, checked against the limits
+	 */
+	std::atomic<int64_t> records;
+	std::atomic<int64_t> bytes;
+
+	/**
+	 * Logs thrown away for going over a limit or finding the ring full
+	 */
+	std::atomic<int64_t> dropped;
+
+	/**
+	 * Logs cut short to LOG_RECORD_LENGTH
+	 */
+	std::atomic<int64_t> truncated;
+};
+
+/**
+ * Collects the logs of the players and sends them to the renderer
+ *
+ * Each thread logs into a ring of its own, and every frame the game thread
+ * drains the rings into the state. A player is only allowed so many logs
+ * and bytes per frame, and what goes over is dropped and counted, so a
+ * chatty player can never hold up the game thread
+ *
+ * Each match has a Logger of its own, so matches played side by side keep
+ * their logs and limits apart. A thread logs into the Logger it was set
+ * to, and gives its ring back whenever it's set again
+ */
 class IPC_EXPORT Logger {
 
-	std::vector<std::string> logs;
-	std::mutex logmutex;
+	std::array<LogRing, LOG_MAX_THREADS> rings;
+
+	std::array<LogCounters, LOG_NO_PLAYER + 1> counters;
+
+	/**
+	 * Logs and bytes a player may send per frame
+	 */
+	std::atomic<int64_t> records_per_frame;
+	std::atomic<int64_t> bytes_per_frame;
+
+	/**
+	 * True while a thread is draining, as only one may read the rings
+	 */
+	std::atomic<bool> is_draining;
+
+	/**
+	 * Gets the calling thread's ring, claiming a free one the first time
+	 *
+	 * @return     The ring, nullptr if every ring is taken
+	 */
+	LogRing* GetThreadRing();
 
 	public:
 
 		/**
-		 * Gets the logs
+		 * Constructor for Logger, with the default limits
+		 */
+		Logger();
+
+		Logger(const Logger&) = delete;
+		Logger& operator=(const Logger&) = delete;
+
+		/**
+		 * Allocates a Logger aligned as its rings are, which plain new
+		 * doesn't do before C++17
+		 *
+		 * @param[in]  size  Number of bytes
+		 *
+		 * @return     The memory
+		 */
+		static void* operator new(size_t size);
+
+		/**
+		 * Frees a Logger allocated with new
 		 *
-		 * @return     The logs
+		 * @param      pointer  The memory
 		 */
-		std::vector<std::string> GetLogs();
+		static void operator delete(void* pointer);
 
 		/**
-		 * Sets the logs
+		 * Logs a message from the calling thread
+		 *
+		 * Never blocks. The log is dropped if the player is over its
+		 * limits or the thread's ring is full
 		 *
 		 * @param[in]  log   The log
 		 */
-		void SetLogs(std::string log);
+		void SetLogs(const std::string& log);
 
 		/**
-		 * Empties the logger
+		 * Moves the waiting logs into a state message and starts the next
+		 * frame's limits
+		 *
+		 * Does nothing if another thread is already draining
+		 *
+		 * @param      StateMessage  The state message
 		 */
-		void EmptyLogs();
+		void DrainLogs(IPC::State* StateMessage);
 
 		/**
-		 * Creates a singleton of the logger
+		 * Sets how much each player may log per frame
+		 *
+		 * @param[in]  records  Number of logs, 0 for no limit
+		 * @param[in]  bytes    Number of bytes, 0 for no limit
+		 */
+		void SetLimits(int64_t records, int64_t bytes);
+
+		/**
+		 * Gets the number of logs of a player that were dropped
+		 *
+		 * @param[in]  player  The player, or LOG_NO_PLAYER
+		 *
+		 * @return     The count
+		 */
+		int64_t GetDroppedLogs(int64_t player) const;
+
+		/**
+		 * Gets the number of logs of a player that were cut short
+		 *
+		 * @param[in]  player  The player, or LOG_NO_PLAYER
 		 *
-		 * @return     returns a logger instance
+		 * @return     The count
+		 */
+		int64_t GetTruncatedLogs(int64_t player) const;
+
+		/**
+		 * Sets the Logger the calling thread logs into and the player its
+		 * logs are counted against
+		 *
+		 * Gives back the ring the thread had, so a pool thread doesn't
+		 * hold on to a ring of every match it has run an update for
+		 *
+		 * @param      logger  The Logger, nullptr for the process-wide one
+		 * @param[in]  player  The player, or LOG_NO_PLAYER
+		 */
+		static void SetThreadLogger(Logger* logger, int64_t player);
+
+		/**
+		 * Gets the Logger the calling thread was set to log into
+		 *
+		 * @return     The Logger, the process-wide one if none was set
 		 */
 		static Logger& Instance();
 };
@@ -148,8 +427,261 @@ class IPC_EXPORT Logger {
 	 *
 	 * @param[in]  StateVar    The state variable
 	 * @param[in]  ExitStatus  The exit status
+	 * @param[in]  Format      How the LOS is encoded
 	 */
-	IPC_EXPORT void StateTransfer (std::shared_ptr<state::State> StateVar, bool ExitStatus);
+	IPC_EXPORT void StateTransfer (std::shared_ptr<state::State> StateVar, bool ExitStatus,
+		LOS_FORMAT Format = LOS_ROWS);
+
+	/**
+	 * Passes the state to renderer every update through an output
+	 *
+	 * @param[in]  StateVar    The state variable
+	 * @param[in]  ExitStatus  The exit status
+	 * @param[in]  Format      How the LOS is encoded
+	 * @param      Out         The output to write to
+	 */
+	IPC_EXPORT void StateTransfer (std::shared_ptr<state::State> StateVar, bool ExitStatus,
+		LOS_FORMAT Format, FrameOutput& Out);
+
+	/**
+	 * Copies what is sent to the renderer out of the state
+	 *
+	 * @param[in]  StateVar    The state variable
+	 * @param[in]  ExitStatus  The exit status
+	 * @param      Frame       The snapshot to fill in
+	 */
+	IPC_EXPORT void SnapshotState(std::shared_ptr<state::State> StateVar, bool ExitStatus, FrameData* Frame);
+
+	/**
+	 * Writes a snapshot to the renderer as a full state
+	 *
+	 * @param      Frame   The snapshot, its LOS is encoded into its state
+	 * @param[in]  Format  How the LOS is encoded
+	 * @param      Out     The output to write to
+	 */
+	IPC_EXPORT void WriteState(FrameData& Frame, LOS_FORMAT Format, FrameOutput& Out);
+
+	/**
+	 * Packs LOS values 2 bits per cell
+	 *
+	 * Each byte holds 4 cells, the first cell in the lowest 2 bits
+	 *
+	 * @param[in]  Cells  The LOS values, each an IPC::State::LOS::LOS_TYPE
+	 *
+	 * @return     The packed bytes
+	 */
+	IPC_EXPORT std::string PackLOS(const std::vector<uint8_t>& Cells);
+
+	/**
+	 * Packs LOS values 2 bits per cell into an existing string
+	 *
+	 * @param[in]  Cells   The LOS values
+	 * @param      Packed  The packed bytes
+	 */
+	IPC_EXPORT void PackLOS(const std::vector<uint8_t>& Cells, std::string* Packed);
+
+	/**
+	 * Unpacks LOS values packed by PackLOS
+	 *
+	 * @param[in]  Packed     The packed bytes
+	 * @param[in]  CellCount  Number of cells packed
+	 *
+	 * @return     The LOS values
+	 */
+	IPC_EXPORT std::vector<uint8_t> UnpackLOS(const std::string& Packed, int64_t CellCount);
+
+	/**
+	 * Run length encodes LOS values
+	 *
+	 * Each run of equal values is a varint holding the run's length
+	 * shifted left by 2, with the value in the lowest 2 bits
+	 *
+	 * @param[in]  Cells  The LOS values, each an IPC::State::LOS::LOS_TYPE
+	 *
+	 * @return     The encoded bytes
+	 */
+	IPC_EXPORT std::string RunLengthEncodeLOS(const std::vector<uint8_t>& Cells);
+
+	/**
+	 * Run length encodes LOS values into an existing string
+	 *
+	 * @param[in]  Cells    The LOS values
+	 * @param      Encoded  The encoded bytes
+	 */
+	IPC_EXPORT void RunLengthEncodeLOS(const std::vector<uint8_t>& Cells, std::string* Encoded);
+
+	/**
+	 * Decodes LOS values encoded by RunLengthEncodeLOS
+	 *
+	 * @param[in]  Encoded  The encoded bytes
+	 *
+	 * @return     The LOS values
+	 */
+	IPC_EXPORT std::vector<uint8_t> RunLengthDecodeLOS(const std::string& Encoded);
+
+	/**
+	 * Encodes the LOS of both players into a state message
+	 *
+	 * With LOS_ROWS they are stored as embedded LOS messages of rows of
+	 * LOS_TYPE enums, the other formats store them as bytes
+	 *
+	 * @param[in]  Cells         LOS of each player in row major order
+	 * @param      StateMessage  The IPC::State message object, with
+	 *                           no_of_rows set and no LOS
+	 * @param[in]  Format        How the LOS is encoded
+	 */
+	IPC_EXPORT void PopulateLOS(const std::vector<uint8_t> (&Cells)[2], IPC::State* StateMessage,
+		LOS_FORMAT Format);
+
+	/**
+	 * Decodes the LOS of both players from a state message, in any format
+	 *
+	 * @param[in]  StateMessage  The IPC::State message object
+	 * @param      Cells         LOS of each player in row major order
+	 */
+	IPC_EXPORT void DecodeLOS(const IPC::State& StateMessage, std::vector<uint8_t> (&Cells)[2]);
+
+	/**
+	 * Applies a delta to the frame before it
+	 *
+	 * Actors keep their places, new ones are added at the end
+	 *
+	 * @param[in]  DeltaMessage  The IPC::StateDelta message object
+	 * @param      Frame         The frame before the delta, with the LOS
+	 *                           fields of its state left empty
+	 */
+	IPC_EXPORT void ApplyDelta(const IPC::StateDelta& DeltaMessage, FrameData* Frame);
+
+	/**
+	 * Passes the state to renderer every update as a stream of keyframes
+	 * and deltas
+	 *
+	 * Every keyframe_interval frames the full state is sent as a
+	 * keyframe, the frames in between only carry what changed since the
+	 * frame before
+	 */
+	class IPC_EXPORT DeltaEncoder {
+
+	private:
+		/**
+		 * Number of frames per keyframe
+		 */
+		int64_t keyframe_interval;
+
+		/**
+		 * Number of frames sent so far
+		 */
+		int64_t frame_number;
+
+		/**
+		 * How the LOS of keyframes is encoded
+		 */
+		LOS_FORMAT los_format;
+
+		/**
+		 * The state sent in the previous frame
+		 *
+		 * Only its actors are kept up to date
+		 */
+		std::unique_ptr<IPC::State> previous;
+
+		/**
+		 * LOS of each player sent in the previous frame, in row major
+		 * order
+		 */
+		std::vector<uint8_t> previous_los[2];
+
+		/**
+		 * Maps actor IDs to their position in the previous frame
+		 */
+		std::vector<int64_t> actor_index;
+
+		/**
+		 * The snapshot the state is copied into by StateTransfer
+		 */
+		std::unique_ptr<FrameData> snapshot;
+
+		/**
+		 * The messages WriteFrame encodes keyframes and deltas into
+		 */
+		std::unique_ptr<IPC::Frame> keyframe_message;
+		std::unique_ptr<IPC::Frame> delta_message;
+
+		/**
+		 * Fills in a delta between the previous frame and a snapshot
+		 *
+		 * Actors are matched by ID, and sent in full if any of their
+		 * fields changed
+		 *
+		 * @param[in]  Frame         The snapshot
+		 * @param      DeltaMessage  The IPC::StateDelta message object
+		 */
+		void EncodeDelta(const FrameData& Frame, IPC::StateDelta* DeltaMessage);
+
+	public:
+		/**
+		 * Constructor for DeltaEncoder
+		 *
+		 * @param[in]  keyframe_interval  Number of frames per keyframe
+		 * @param[in]  los_format         How the LOS of keyframes is
+		 *                                encoded
+		 */
+		DeltaEncoder(int64_t keyframe_interval, LOS_FORMAT los_format = LOS_ROWS);
+
+		~DeltaEncoder();
+
+		/**
+		 * Makes the next frame of the stream
+		 *
+		 * @param[in]  StateVar    The state variable
+		 * @param[in]  ExitStatus  The exit status
+		 * @param      FrameVar    The frame to fill in
+		 */
+		void Encode(std::shared_ptr<state::State> StateVar, bool ExitStatus, IPC::Frame* FrameVar);
+
+		/**
+		 * Makes the next frame of the stream from a snapshot
+		 *
+		 * @param      Frame     The snapshot, its contents are swapped
+		 *                       with those of an older one to reuse
+		 * @param      FrameVar  The frame to fill in
+		 */
+		void Encode(FrameData& Frame, IPC::Frame* FrameVar);
+
+		/**
+		 * Checks if the next frame of the stream is a keyframe
+		 *
+		 * @return     true if it is, false if it's a delta
+		 */
+		bool IsNextKeyframe() const;
+
+		/**
+		 * Writes the next frame of the stream, made from a snapshot
+		 *
+		 * @param      Frame  The snapshot, its contents are swapped with
+		 *                    those of an older one to reuse
+		 * @param      Out    The output to write to
+		 */
+		void WriteFrame(FrameData& Frame, FrameOutput& Out);
+
+		/**
+		 * Sends the next frame of the stream to the renderer
+		 *
+		 * @param[in]  StateVar    The state variable
+		 * @param[in]  ExitStatus  The exit status
+		 */
+		void StateTransfer(std::shared_ptr<state::State> StateVar, bool ExitStatus);
+
+		/**
+		 * Sends the next frame of the stream to the renderer through an
+		 * output
+		 *
+		 * @param[in]  StateVar    The state variable
+		 * @param[in]  ExitStatus  The exit status
+		 * @param      Out         The output to write to
+		 */
+		void StateTransfer(std::shared_ptr<state::State> StateVar, bool ExitStatus, FrameOutput& Out);
+	};
 
 	/**
 	 * Stores a terrain
@@ -162,12 +694,84 @@ class IPC_EXPORT Logger {
 	/**
 	 * Loads a terrain
 	 *
+	 * Binary terrain files are recognised by their magic and mapped,
+	 * anything else is parsed as an IPC::Terrain
+	 *
 	 * @param[in]  filename  The filename
 	 *
 	 * @return     Returns a state::Terrain
 	 */
 	IPC_EXPORT state::Terrain LoadTerrain(std::string filename);
 
+	/**
+	 * Identifies a binary terrain file, "SIMTERRN"
+	 */
+	const char TERRAIN_MAGIC[8] = {'S', 'I', 'M', 'T', 'E', 'R', 'R', 'N'};
+
+	/**
+	 * Layout of the binary terrain file, changed whenever the layout
+	 * changes
+	 */
+	const uint32_t TERRAIN_VERSION = 1;
+
+	/**
+	 * Stores a terrain as a binary terrain file
+	 *
+	 * The file is TERRAIN_MAGIC, the 4 byte TERRAIN_VERSION, the 4 byte
+	 * size of the header, the 8 byte number of rows and the 8 byte side
+	 * length of an element, followed by the state::TERRAIN_TYPE of every
+	 * element, one byte each in row major order. Numbers are little
+	 * endian
+	 *
+	 * @param      TerrainVar  The terrain variable
+	 * @param[in]  filename    The filename
+	 *
+	 * @return     true if the file was written, false otherwise
+	 */
+	IPC_EXPORT bool StoreBinaryTerrain(state::Terrain& TerrainVar, const std::string& filename);
+
+	/**
+	 * Loads a binary terrain file by mapping it into memory
+	 *
+	 * A file with no rows, an element size under 1 or an element that
+	 * isn't a known state::TERRAIN_TYPE isn't valid
+	 *
+	 * @param[in]  filename  The filename
+	 * @param      TerrainVar  The loaded terrain
+	 *
+	 * @return     true if the file was a valid binary terrain file, false
+	 *             otherwise
+	 */
+	IPC_EXPORT bool LoadBinaryTerrain(const std::string& filename, state::Terrain* TerrainVar);
+
+	/**
+	 * Loads a terrain from a plaintext file
+	 *
+	 * The elements are stored in one line, 'P' for plain, 'F' for forest
+	 * and 'M' for mountain, and the terrain is assumed to be a square
+	 *
+	 * @param[in]  filename     The filename
+	 * @param[in]  ElementSize  Side length of each element
+	 *
+	 * @return     Returns a state::Terrain
+	 */
+	IPC_EXPORT state::Terrain LoadTextTerrain(const std::string& filename, int64_t ElementSize);
+
+	/**
+	 * Converts a terrain file of any format into a binary terrain file
+	 *
+	 * The input may be a binary, IPC::Terrain or plaintext terrain file
+	 *
+	 * @param[in]  input        The file to convert
+	 * @param[in]  output       The binary terrain file to write
+	 * @param[in]  ElementSize  Side length of each element of a
+	 *                          plaintext terrain
+	 *
+	 * @return     true if the file was converted, false otherwise
+	 */
+	IPC_EXPORT bool ConvertTerrain(const std::string& input, const std::string& output,
+		int64_t ElementSize);
+
 	/**
 	 * Listen to the renderer for an interrupt
 	 *
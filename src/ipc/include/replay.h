@@ -0,0 +1,287 @@
+/**
+ * @file replay.h
+ * Declarations for recording matches to replay files and seeking in them
+ */
+#ifndef IPC_REPLAY_H
+#define IPC_REPLAY_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "ipc.h"
+#include "ipc_export.h"
+#include "state_writer.h"
+
+namespace IPC {
+	class ReplayIndex;
+}
+
+namespace ipc {
+
+/**
+ * Layout of a replay file
+ *
+ * - 8 bytes of REPLAY_MAGIC, a 4 byte REPLAY_VERSION and the 4 byte
+ *   keyframe interval
+ * - The frames, each a 4 byte size followed by an IPC::Frame, a keyframe
+ *   every keyframe interval frames and deltas in between
+ * - An IPC::ReplayIndex, the 8 byte offset of the index and REPLAY_MAGIC
+ *   again
+ *
+ * Numbers are little endian. A file missing its index, because the match
+ * never finished, can still be read by scanning the frames
+ */
+const char REPLAY_MAGIC[8] = {'S', 'I', 'M', 'R', 'E', 'P', 'L', 'Y'};
+
+/**
+ * Layout of the replay file, changed whenever the layout changes
+ */
+const uint32_t REPLAY_VERSION = 1;
+
+/**
+ * Frames per keyframe of a replay when none is given
+ */
+const int64_t REPLAY_DEFAULT_KEYFRAME_INTERVAL = 30;
+
+/**
+ * Records the frames sent to the renderer into a replay file
+ *
+ * Keyframes store their LOS run length encoded
+ */
+class IPC_EXPORT ReplayWriter {
+
+private:
+	/**
+	 * The replay file
+	 */
+	std::ofstream file;
+
+	/**
+	 * Number of bytes written to the file
+	 */
+	uint64_t offset;
+
+	/**
+	 * Encodes the recorded frames into keyframes and deltas
+	 */
+	DeltaEncoder encoder;
+
+	/**
+	 * Copy of the frame being recorded, handed to the encoder
+	 */
+	FrameData frame;
+
+	/**
+	 * The messages keyframes and deltas are encoded into
+	 */
+	std::unique_ptr<IPC::Frame> keyframe_message;
+	std::unique_ptr<IPC::Frame> delta_message;
+
+	/**
+	 * Where each frame written is
+	 */
+	std::unique_ptr<IPC::ReplayIndex> index;
+
+	/**
+	 * The bytes of the frame being written
+	 */
+	std::string buffer;
+
+	/**
+	 * Writes bytes to the file
+	 *
+	 * @param[in]  data  The bytes
+	 * @param[in]  size  Number of bytes
+	 */
+	void WriteBytes(const char* data, uint64_t size);
+
+public:
+	/**
+	 * Constructor for ReplayWriter, makes the file
+	 *
+	 * @param[in]  filename           The file
+	 * @param[in]  keyframe_interval  Frames per keyframe
+	 */
+	ReplayWriter(const std::string& filename,
+		int64_t keyframe_interval = REPLAY_DEFAULT_KEYFRAME_INTERVAL);
+
+	/**
+	 * Closes the file if it hasn't been closed yet
+	 */
+	~ReplayWriter();
+
+	ReplayWriter(const ReplayWriter&) = delete;
+	ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+	/**
+	 * Checks if the file could be made
+	 *
+	 * @return     true if it could, false otherwise
+	 */
+	bool IsOpen() const;
+
+	/**
+	 * Records a frame
+	 *
+	 * @param[in]  Frame  The frame, with its tick and game time set
+	 */
+	void Record(const FrameData& Frame);
+
+	/**
+	 * Writes the index and closes the file
+	 */
+	void Close();
+};
+
+/**
+ * Reads a replay file, mapped into memory
+ *
+ * The reader is at one frame of the replay at a time, whose full state is
+ * rebuilt from the keyframe before it and the deltas in between
+ */
+class IPC_EXPORT ReplayReader {
+
+private:
+	/**
+	 * The mapped file, nullptr if it couldn't be read
+	 */
+	const char* data;
+
+	/**
+	 * Number of bytes in the file
+	 */
+	uint64_t size;
+
+	/**
+	 * Where each frame is
+	 */
+	std::unique_ptr<IPC::ReplayIndex> index;
+
+	/**
+	 * The frame being read
+	 */
+	std::unique_ptr<IPC::Frame> frame_message;
+
+	/**
+	 * State at the frame the reader is at, with the LOS fields left empty
+	 */
+	FrameData current;
+
+	/**
+	 * Index of the frame the reader is at, -1 before the first
+	 */
+	int64_t position;
+
+	/**
+	 * Reads the index at the end of the file
+	 *
+	 * @return     true if there was a valid index, false otherwise
+	 */
+	bool ReadIndex();
+
+	/**
+	 * Builds the index by going through every frame in the file
+	 */
+	void ScanFrames();
+
+	/**
+	 * Parses the frame at an offset
+	 *
+	 * @param[in]  offset  Offset of the frame's size
+	 *
+	 * @return     true if it parsed, false otherwise
+	 */
+	bool ParseFrame(uint64_t offset);
+
+	/**
+	 * Applies the frame at an index onto the current state
+	 *
+	 * @param[in]  frame  The index
+	 *
+	 * @return     true if it was applied, false otherwise
+	 */
+	bool ApplyFrame(int64_t frame);
+
+public:
+	/**
+	 * Constructor for ReplayReader, maps the file
+	 *
+	 * @param[in]  filename  The file
+	 */
+	ReplayReader(const std::string& filename);
+
+	~ReplayReader();
+
+	ReplayReader(const ReplayReader&) = delete;
+	ReplayReader& operator=(const ReplayReader&) = delete;
+
+	/**
+	 * Checks if the file was read
+	 *
+	 * @return     true if it was, false otherwise
+	 */
+	bool IsOpen() const;
+
+	/**
+	 * Gets the number of frames in the replay
+	 *
+	 * @return     The count
+	 */
+	int64_t GetFrameCount() const;
+
+	/**
+	 * Gets the tick a frame was taken at
+	 *
+	 * @param[in]  frame  The frame's index
+	 *
+	 * @return     The tick
+	 */
+	int64_t GetTick(int64_t frame) const;
+
+	/**
+	 * Gets the index of the frame the reader is at
+	 *
+	 * @return     The index, -1 before the first frame
+	 */
+	int64_t GetPosition() const;
+
+	/**
+	 * Moves to the last frame taken at or before a tick
+	 *
+	 * Only the deltas after the nearest keyframe are applied, or the ones
+	 * after the current frame if that's nearer
+	 *
+	 * @param[in]  tick  The tick
+	 *
+	 * @return     true if there is such a frame, false otherwise
+	 */
+	bool Seek(int64_t tick);
+
+	/**
+	 * Moves on to the next frame
+	 *
+	 * @return     true if there was one, false at the end
+	 */
+	bool Next();
+
+	/**
+	 * Gets the frame the reader is at
+	 *
+	 * @return     The state, and the LOS of both players in row major
+	 *             order
+	 */
+	const FrameData& GetFrame() const;
+
+	/**
+	 * Gets the frame the reader is at as the renderer is sent it
+	 *
+	 * @param      State   The state message to fill in
+	 * @param[in]  Format  How the LOS is encoded
+	 */
+	void GetState(IPC::State* State, LOS_FORMAT Format = LOS_ROWS) const;
+};
+
+}
+
+#endif // IPC_REPLAY_H
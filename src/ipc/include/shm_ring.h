@@ -0,0 +1,303 @@
+/**
+ * @file shm_ring.h
+ * Declarations for the shared memory ring buffer frames can be sent to the
+ * renderer through
+ */
+#ifndef IPC_SHM_RING_H
+#define IPC_SHM_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "ipc.h"
+#include "ipc_export.h"
+
+namespace ipc {
+
+/**
+ * Start of the shared memory object, followed by the ring's bytes
+ *
+ * Positions count bytes written since the ring was made and never wrap,
+ * a position's offset in the ring is the position modulo the capacity.
+ * Each frame is a 4 byte size, 4 bytes of padding and the frame's bytes,
+ * padded to a multiple of 8 bytes. Frames never wrap, a size of
+ * SHM_RING_WRAP marks that the rest of the ring is skipped
+ */
+struct ShmRingHeader {
+	/**
+	 * SHM_RING_MAGIC once the ring is set up
+	 */
+	std::atomic<uint32_t> magic;
+
+	/**
+	 * SHM_RING_VERSION of the writer
+	 */
+	uint32_t version;
+
+	/**
+	 * Number of bytes in the ring
+	 */
+	uint64_t capacity;
+
+	/**
+	 * Position after the last frame written
+	 */
+	alignas(64) std::atomic<uint64_t> write_position;
+
+	/**
+	 * Bumped on every frame written, the futex readers wait on
+	 */
+	std::atomic<uint32_t> doorbell;
+
+	/**
+	 * 1 once the writer won't write any more frames
+	 */
+	std::atomic<uint32_t> closed;
+
+	/**
+	 * Number of frames the writer dropped because the ring was full
+	 */
+	std::atomic<uint64_t> dropped_frames;
+
+	/**
+	 * Position after the last frame the reader is done with
+	 */
+	alignas(64) std::atomic<uint64_t> read_position;
+
+	/**
+	 * Number of readers waiting on the doorbell
+	 */
+	std::atomic<uint32_t> waiters;
+};
+
+/**
+ * Identifies a ring, "SIMR"
+ */
+const uint32_t SHM_RING_MAGIC = 0x524d4953;
+
+/**
+ * Layout of the ring, changed whenever ShmRingHeader changes
+ */
+const uint32_t SHM_RING_VERSION = 1;
+
+/**
+ * Size of a frame that marks the rest of the ring as skipped
+ */
+const uint32_t SHM_RING_WRAP = 0xffffffff;
+
+/**
+ * Capacity of a ring when none is given, in bytes
+ */
+const uint64_t SHM_RING_DEFAULT_CAPACITY = 16 << 20;
+
+/**
+ * Writes frames into a POSIX shared memory ring buffer
+ *
+ * Frames are serialised straight into the ring, and a reader mapping the
+ * same object gets them without going through the kernel. The writer
+ * never waits: a frame that doesn't fit because the reader is behind is
+ * dropped and counted. Readers sleeping on an empty ring are woken
+ * through a futex on the doorbell
+ */
+class IPC_EXPORT ShmRingWriter : public FrameOutput {
+
+private:
+	/**
+	 * Name of the shared memory object
+	 */
+	std::string name;
+
+	/**
+	 * The mapped object, nullptr if it couldn't be made
+	 */
+	ShmRingHeader* header;
+
+	/**
+	 * The ring's bytes, following the header
+	 */
+	char* ring;
+
+	/**
+	 * Number of bytes mapped
+	 */
+	uint64_t mapped_size;
+
+	/**
+	 * Position the reserved frame starts at
+	 */
+	uint64_t reserved_position;
+
+	/**
+	 * Number of bytes the reserved frame takes up in the ring
+	 */
+	uint64_t reserved_size;
+
+public:
+	/**
+	 * Constructor for ShmRingWriter, makes the shared memory object
+	 *
+	 * An object of the same name is replaced
+	 *
+	 * @param[in]  name      Name of the object, starting with a /
+	 * @param[in]  capacity  Number of bytes in the ring, rounded up to a
+	 *                       multiple of 8
+	 */
+	ShmRingWriter(const std::string& name, uint64_t capacity = SHM_RING_DEFAULT_CAPACITY);
+
+	/**
+	 * Closes the ring and removes its name, readers that have it mapped
+	 * can still read what's left
+	 */
+	~ShmRingWriter();
+
+	ShmRingWriter(const ShmRingWriter&) = delete;
+	ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+	/**
+	 * Checks if the shared memory object was made
+	 *
+	 * @return     true if it was, false otherwise
+	 */
+	bool IsOpen() const;
+
+	/**
+	 * Reserves room for a frame in the ring
+	 *
+	 * The frame is not seen by readers until Commit is called
+	 *
+	 * @param[in]  size  The frame's size in bytes
+	 *
+	 * @return     Where to write the frame, nullptr if the ring is full
+	 */
+	char* Reserve(uint32_t size);
+
+	/**
+	 * Hands the reserved frame to the reader
+	 */
+	void Commit();
+
+	/**
+	 * Serialises a frame straight into the ring
+	 *
+	 * @param[in]  Message  The frame's message
+	 */
+	void Write(const google::protobuf::MessageLite& Message) override;
+
+	/**
+	 * Tells readers no more frames will be written
+	 */
+	void Close();
+
+	/**
+	 * Gets the number of frames dropped because the ring was full
+	 *
+	 * @return     The count
+	 */
+	int64_t GetDroppedFrames() const;
+};
+
+/**
+ * Reads frames from a ring made by ShmRingWriter
+ *
+ * Only one reader may read a ring at a time. Frames are read in place in
+ * the shared memory, each one stays valid until it is released
+ */
+class IPC_EXPORT ShmRingReader {
+
+private:
+	/**
+	 * The mapped object, nullptr if it couldn't be opened
+	 */
+	ShmRingHeader* header;
+
+	/**
+	 * The ring's bytes, following the header
+	 */
+	const char* ring;
+
+	/**
+	 * Number of bytes mapped
+	 */
+	uint64_t mapped_size;
+
+	/**
+	 * Position after the frame last returned by Next
+	 */
+	uint64_t next_position;
+
+	/**
+	 * Sleeps until the doorbell rings or the timeout passes
+	 *
+	 * @param[in]  timeout  Longest to wait
+	 */
+	void WaitForDoorbell(std::chrono::nanoseconds timeout);
+
+public:
+	/**
+	 * Constructor for ShmRingReader, maps an existing ring
+	 *
+	 * @param[in]  name  Name of the object, starting with a /
+	 */
+	ShmRingReader(const std::string& name);
+
+	~ShmRingReader();
+
+	ShmRingReader(const ShmRingReader&) = delete;
+	ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+	/**
+	 * Checks if the ring was mapped
+	 *
+	 * @return     true if it was, false otherwise
+	 */
+	bool IsOpen() const;
+
+	/**
+	 * Gets the next frame, waiting for one to be written if there is none
+	 *
+	 * The previous frame is released
+	 *
+	 * @param[out] data     Where the frame starts in the ring
+	 * @param[out] size     The frame's size in bytes
+	 * @param[in]  timeout  Longest to wait
+	 *
+	 * @return     true if there was a frame, false if the timeout passed
+	 *             or the writer closed the ring and it's empty
+	 */
+	bool Next(const char** data, uint32_t* size, std::chrono::nanoseconds timeout);
+
+	/**
+	 * Gets the next frame and parses it into a message
+	 *
+	 * @param      message  The message to parse into
+	 * @param[in]  timeout  Longest to wait
+	 *
+	 * @return     true if a frame was parsed, false otherwise
+	 */
+	bool Next(google::protobuf::MessageLite* message, std::chrono::nanoseconds timeout);
+
+	/**
+	 * Hands the room taken by the frame last returned back to the writer
+	 */
+	void Release();
+
+	/**
+	 * Checks if the writer closed the ring and every frame was read
+	 *
+	 * @return     true if it did, false otherwise
+	 */
+	bool IsFinished() const;
+
+	/**
+	 * Gets the number of frames the writer dropped because the ring was
+	 * full
+	 *
+	 * @return     The count
+	 */
+	int64_t GetDroppedFrames() const;
+};
+
+}
+
+#endif // IPC_SHM_RING_H
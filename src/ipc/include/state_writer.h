@@ -0,0 +1,277 @@
+/**
+ * @file state_writer.h
+ * Declarations for writing the state to the renderer on its own thread
+ */
+#ifndef IPC_STATE_WRITER_H
+#define IPC_STATE_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ipc.h"
+#include "ipc_export.h"
+#include "state.pb.h"
+
+namespace ipc {
+
+class ReplayWriter;
+
+/**
+ * Everything sent to the renderer for one frame, copied out of the state
+ *
+ * Holds no references into the state, so it can be encoded and written
+ * while the simulation goes on
+ */
+struct FrameData {
+	/**
+	 * Actors, scores and logs, with the LOS fields left empty
+	 */
+	IPC::State state;
+
+	/**
+	 * LOS of each player in row major order, as
+	 * IPC::State::LOS::LOS_TYPE values
+	 */
+	std::vector<uint8_t> los[2];
+};
+
+/**
+ * What StateWriter::Push does when the queue is full
+ */
+enum WRITER_QUEUE_POLICY {
+	/**
+	 * The oldest queued frame is dropped
+	 */
+	DROP_OLDEST,
+	/**
+	 * The caller waits for the writer to make room
+	 */
+	BLOCK,
+	/**
+	 * The newest queued frame is replaced by the new one
+	 */
+	COALESCE
+};
+
+/**
+ * Encodes and writes frames to the renderer on a dedicated thread
+ *
+ * Frames wait in a bounded queue. A frame that is dropped or replaced
+ * hands its user logs on to the next frame, so no logs are lost. With a
+ * delta stream, deltas are made against the previous frame written, so
+ * dropping frames never breaks the stream
+ *
+ * If the match is being recorded, every frame is recorded on the same
+ * thread before it is written, dropped and replaced frames included. At
+ * most capacity frames wait only to be recorded, past that Push waits for
+ * the writer whatever the policy
+ */
+class IPC_EXPORT StateWriter {
+
+private:
+	/**
+	 * A frame waiting in the queue
+	 */
+	struct QueuedFrame {
+		std::unique_ptr<FrameData> frame;
+		/**
+		 * False if the frame was dropped or replaced, or there's no output,
+		 * and it only waits to be recorded
+		 */
+		bool is_sent;
+	};
+
+	/**
+	 * The output the frames are written to, nullptr if they're only
+	 * recorded
+	 */
+	FrameOutput* out;
+
+	/**
+	 * Records the frames, nullptr if not recording
+	 */
+	ReplayWriter* replay;
+
+	/**
+	 * Most frames that may wait in the queue
+	 */
+	int64_t capacity;
+
+	/**
+	 * What happens when the queue is full
+	 */
+	WRITER_QUEUE_POLICY policy;
+
+	/**
+	 * How the LOS is encoded
+	 */
+	LOS_FORMAT los_format;
+
+	/**
+	 * Encodes the delta stream, nullptr to write full states
+	 */
+	std::unique_ptr<DeltaEncoder> delta_encoder;
+
+	/**
+	 * Frames waiting to be written or recorded
+	 */
+	std::deque<QueuedFrame> queue;
+
+	/**
+	 * Number of frames in the queue that are to be written, the rest only
+	 * wait to be recorded
+	 */
+	int64_t sent_frames;
+
+	/**
+	 * Frames already written, kept to be filled again
+	 */
+	std::vector<std::unique_ptr<FrameData> > free_frames;
+
+	/**
+	 * Guards queue, sent_frames, free_frames and is_stopped
+	 */
+	std::mutex queue_mutex;
+
+	/**
+	 * Signalled when a frame is queued or the writer is stopped
+	 */
+	std::condition_variable not_empty_cv;
+
+	/**
+	 * Signalled when a frame is taken off the queue
+	 */
+	std::condition_variable not_full_cv;
+
+	/**
+	 * True once Stop has been called
+	 */
+	bool is_stopped;
+
+	/**
+	 * Number of frames dropped
+	 */
+	std::atomic<int64_t> dropped_frames;
+
+	/**
+	 * Number of frames replaced by a newer one
+	 */
+	std::atomic<int64_t> coalesced_frames;
+
+	/**
+	 * Number of times Push had to wait for room
+	 */
+	std::atomic<int64_t> blocked_pushes;
+
+	/**
+	 * The writer thread
+	 */
+	std::thread writer;
+
+	/**
+	 * Writes frames until stopped and the queue is empty
+	 */
+	void WriterLoop();
+
+	/**
+	 * Keeps a frame that won't be written again to be filled again
+	 *
+	 * Must be called with queue_mutex held
+	 *
+	 * @param[in]  frame  The frame
+	 */
+	void Recycle(std::unique_ptr<FrameData> frame);
+
+	/**
+	 * Drops a queued frame, keeping it in its place if it's still to be
+	 * recorded
+	 *
+	 * Must be called with queue_mutex held
+	 *
+	 * @param[in]  index  Position of the frame in the queue
+	 */
+	void Drop(int64_t index);
+
+public:
+	/**
+	 * Constructor for StateWriter, starts the writer thread
+	 *
+	 * @param      out                The output to write to, nullptr to only
+	 *                                record the frames
+	 * @param[in]  capacity           Most frames that may wait to be
+	 *                                written
+	 * @param[in]  policy             What happens when the queue is full
+	 * @param[in]  los_format         How the LOS is encoded
+	 * @param[in]  keyframe_interval  Frames per keyframe of a delta stream,
+	 *                                0 to write full states
+	 * @param      replay             Records the frames, nullptr if not
+	 *                                recording. Must outlive the writer
+	 *                                thread
+	 */
+	StateWriter(FrameOutput* out, int64_t capacity, WRITER_QUEUE_POLICY policy,
+		LOS_FORMAT los_format, int64_t keyframe_interval, ReplayWriter* replay = nullptr);
+
+	/**
+	 * Writes the frames still queued, then stops the writer thread
+	 */
+	~StateWriter();
+
+	StateWriter(const StateWriter&) = delete;
+	StateWriter& operator=(const StateWriter&) = delete;
+
+	/**
+	 * Gets a frame to fill and push
+	 *
+	 * Frames are reused once written, so the messages in them keep their
+	 * memory and a steady stream makes no allocations
+	 *
+	 * @return     The frame
+	 */
+	std::unique_ptr<FrameData> GetFrame();
+
+	/**
+	 * Queues a frame to be written
+	 *
+	 * Never waits unless the policy is BLOCK, or the match is being
+	 * recorded and capacity frames already wait only to be recorded
+	 *
+	 * @param[in]  frame  The frame
+	 */
+	void Push(std::unique_ptr<FrameData> frame);
+
+	/**
+	 * Writes the frames still queued, then stops the writer thread
+	 */
+	void Stop();
+
+	/**
+	 * Gets the number of frames dropped
+	 *
+	 * @return     The count
+	 */
+	int64_t GetDroppedFrames();
+
+	/**
+	 * Gets the number of frames replaced by a newer one
+	 *
+	 * @return     The count
+	 */
+	int64_t GetCoalescedFrames();
+
+	/**
+	 * Gets the number of times Push had to wait for room
+	 *
+	 * @return     The count
+	 */
+	int64_t GetBlockedPushes();
+};
+
+}
+
+#endif // IPC_STATE_WRITER_H
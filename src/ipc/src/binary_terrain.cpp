@@ -0,0 +1,183 @@
+/**
+ * @file binary_terrain.cpp
+ * Function definitions for the binary and plaintext terrain formats
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ipc.h"
+#include "terrain/terrain.h"
+#include "terrain/terrain_element.h"
+
+/**
+ * Size of the header of a binary terrain file
+ */
+const uint64_t TERRAIN_HEADER_SIZE = 32;
+
+/**
+ * Writes a number as little endian bytes
+ *
+ * @param[in]  value  The number
+ * @param[in]  size   Number of bytes
+ * @param      out    Where to write the bytes
+ */
+static void EncodeLittleEndian(uint64_t value, int size, char* out) {
+	for (int i = 0; i < size; ++i) {
+		out[i] = static_cast<char>(value >> (8 * i));
+	}
+}
+
+/**
+ * Reads a number from little endian bytes
+ *
+ * @param[in]  in    The bytes
+ * @param[in]  size  Number of bytes
+ *
+ * @return     The number
+ */
+static uint64_t DecodeLittleEndian(const char* in, int size) {
+	uint64_t value = 0;
+	for (int i = 0; i < size; ++i) {
+		value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+	}
+	return value;
+}
+
+namespace ipc {
+
+	bool StoreBinaryTerrain(state::Terrain& TerrainVar, const std::string& filename) {
+
+		int64_t NoOfRows = TerrainVar.GetRows();
+		int64_t ElementSize = NoOfRows > 0
+			? TerrainVar.OffsetToTerrainElement(physics::Vector2D(0, 0)).GetSize() : 0;
+
+		char Header[TERRAIN_HEADER_SIZE];
+		std::memcpy(Header, TERRAIN_MAGIC, sizeof(TERRAIN_MAGIC));
+		EncodeLittleEndian(TERRAIN_VERSION, 4, Header + 8);
+		EncodeLittleEndian(TERRAIN_HEADER_SIZE, 4, Header + 12);
+		EncodeLittleEndian(NoOfRows, 8, Header + 16);
+		EncodeLittleEndian(ElementSize, 8, Header + 24);
+
+		std::vector<char> Types(NoOfRows * NoOfRows);
+		for (int64_t row = 0; row < NoOfRows; ++row) {
+			for (int64_t col = 0; col < NoOfRows; ++col) {
+				Types[row * NoOfRows + col] = TerrainVar.OffsetToTerrainElement(
+					physics::Vector2D(row, col)).GetTerrainType();
+			}
+		}
+
+		std::ofstream output(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+		output.write(Header, TERRAIN_HEADER_SIZE);
+		output.write(Types.data(), Types.size());
+
+		return output.good();
+	}
+
+	bool LoadBinaryTerrain(const std::string& filename, state::Terrain* TerrainVar) {
+
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) < 0 || info.st_size < (off_t) TERRAIN_HEADER_SIZE) {
+			close(fd);
+			return false;
+		}
+		void* Mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (Mapping == MAP_FAILED) {
+			return false;
+		}
+		const char* Data = static_cast<const char*>(Mapping);
+
+		bool IsValid = std::memcmp(Data, TERRAIN_MAGIC, sizeof(TERRAIN_MAGIC)) == 0
+			&& DecodeLittleEndian(Data + 8, 4) == TERRAIN_VERSION;
+
+		uint64_t HeaderSize = DecodeLittleEndian(Data + 12, 4);
+		uint64_t NoOfRows = DecodeLittleEndian(Data + 16, 8);
+		uint64_t ElementSize = DecodeLittleEndian(Data + 24, 8);
+
+		IsValid = IsValid && HeaderSize >= TERRAIN_HEADER_SIZE
+			&& NoOfRows >= 1 && NoOfRows <= (1 << 16)
+			&& static_cast<int64_t>(ElementSize) >= 1
+			&& HeaderSize + NoOfRows * NoOfRows <= (uint64_t) info.st_size;
+
+		if (IsValid) {
+			/**
+			 * The types are read straight out of the mapping, nothing is
+			 * parsed
+			 */
+			madvise(Mapping, info.st_size, MADV_SEQUENTIAL);
+			const uint8_t* Types = reinterpret_cast<const uint8_t*>(Data + HeaderSize);
+			IsValid = std::all_of(Types, Types + NoOfRows * NoOfRows, [](uint8_t Type) {
+				return Type <= state::MOUNTAIN;
+			});
+			if (IsValid) {
+				*TerrainVar = state::Terrain(NoOfRows, Types, ElementSize);
+			}
+		}
+
+		munmap(Mapping, info.st_size);
+
+		return IsValid;
+	}
+
+	state::Terrain LoadTextTerrain(const std::string& filename, int64_t ElementSize) {
+
+		std::string Line;
+		std::ifstream File(filename);
+		std::getline(File, Line);
+
+		int64_t NoOfRows = (int64_t) std::sqrt(Line.size());
+
+		std::vector<uint8_t> Types(NoOfRows * NoOfRows);
+		for (int64_t cell = 0; cell < static_cast<int64_t>(Types.size()); ++cell) {
+			switch (Line[cell]) {
+				case 'F':
+					Types[cell] = state::FOREST;
+					break;
+				case 'M':
+					Types[cell] = state::MOUNTAIN;
+					break;
+				default:
+					Types[cell] = state::PLAIN;
+			}
+		}
+
+		return state::Terrain(NoOfRows, Types.data(), ElementSize);
+	}
+
+	bool ConvertTerrain(const std::string& input, const std::string& output,
+		int64_t ElementSize) {
+
+		char Magic[sizeof(TERRAIN_MAGIC)] = {};
+		std::ifstream File(input, std::ios::in | std::ios::binary);
+		if (!File) {
+			return false;
+		}
+		File.read(Magic, sizeof(Magic));
+
+		/**
+		 * Plaintext terrain only holds the letters P, F and M, which
+		 * never start an IPC::Terrain
+		 */
+		bool IsText = File.gcount() > 0 && std::strchr("PFM", Magic[0]) != nullptr;
+
+		state::Terrain TerrainVar = IsText
+			? LoadTextTerrain(input, ElementSize) : LoadTerrain(input);
+
+		if (TerrainVar.GetRows() == 0) {
+			return false;
+		}
+
+		return StoreBinaryTerrain(TerrainVar, output);
+	}
+}
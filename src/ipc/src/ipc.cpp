@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <ipc.h>
 #include <mutex>
+#include <new>
+#include "state.pb.h"
 
 namespace ipc {
 
@@ -26,7 +31,16 @@ bool Interrupts::GetRestartStatus() {
 }
 
 void Interrupts::SetPlayStatus(bool play_status) {
-	play = play_status;
+	{
+		std::lock_guard<std::mutex> lock(play_mutex);
+		play = play_status;
+	}
+	play_cv.notify_all();
+}
+
+void Interrupts::WaitForPlay() {
+	std::unique_lock<std::mutex> lock(play_mutex);
+	play_cv.wait(lock, [this] { return play.load(); });
 }
 
 void Interrupts::SetLevelNumber(int current_level) {
@@ -41,25 +55,175 @@ void Interrupts::SetRestartStatus(bool restart_status) {
 	restart = restart_status;
 }
 
-std::vector<std::string> Logger::GetLogs() {
-	std::lock_guard<std::mutex> lock(logmutex);
-	return logs;
+/**
+ * Logger the calling thread logs into, nullptr for the process-wide one
+ */
+static thread_local Logger* thread_logger = nullptr;
+
+/**
+ * Player the calling thread's logs are counted against
+ */
+static thread_local int64_t thread_player = LOG_NO_PLAYER;
+
+/**
+ * The ring the calling thread claimed, given back when the thread exits or
+ * moves on to another Logger, so that another thread can claim it
+ */
+struct ThreadRing {
+	LogRing* ring = nullptr;
+	const Logger* logger = nullptr;
+
+	void Release() {
+		if (ring) {
+			ring->is_claimed.store(false, std::memory_order_release);
+			ring = nullptr;
+			logger = nullptr;
+		}
+	}
+
+	~ThreadRing() {
+		Release();
+	}
+};
+
+static thread_local ThreadRing thread_ring;
+
+Logger::Logger() :
+	records_per_frame(LOG_DEFAULT_RECORDS_PER_FRAME),
+	bytes_per_frame(LOG_DEFAULT_BYTES_PER_FRAME),
+	is_draining(false) {
+
+	for (auto& Ring : rings) {
+		Ring.is_claimed = false;
+		Ring.write_position = 0;
+		Ring.read_position = 0;
+	}
+	for (auto& Counters : counters) {
+		Counters.records = 0;
+		Counters.bytes = 0;
+		Counters.dropped = 0;
+		Counters.truncated = 0;
+	}
+}
+
+void* Logger::operator new(size_t size) {
+
+	void* pointer = nullptr;
+	if (posix_memalign(&pointer, alignof(Logger), size) != 0) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void Logger::operator delete(void* pointer) {
+	std::free(pointer);
+}
+
+LogRing* Logger::GetThreadRing() {
+
+	if (thread_ring.logger == this) {
+		return thread_ring.ring;
+	}
+	thread_ring.Release();
+
+	// The acquire pairs with the release of the ring's last owner, so
+	// this thread carries on from where it left off
+	for (auto& Ring : rings) {
+		bool Expected = false;
+		if (!Ring.is_claimed.load(std::memory_order_relaxed)
+			&& Ring.is_claimed.compare_exchange_strong(Expected, true, std::memory_order_acquire)) {
+			thread_ring.ring = &Ring;
+			thread_ring.logger = this;
+			break;
+		}
+	}
+	return thread_ring.ring;
+}
+
+void Logger::SetLogs(const std::string& log) {
+
+	LogCounters& Counters = counters[thread_player];
+	uint64_t Length = std::min<uint64_t>(log.size(), LOG_RECORD_LENGTH);
+
+	int64_t RecordLimit = records_per_frame.load(std::memory_order_relaxed);
+	int64_t ByteLimit = bytes_per_frame.load(std::memory_order_relaxed);
+	if ((RecordLimit > 0 && Counters.records.load(std::memory_order_relaxed) >= RecordLimit)
+		|| (ByteLimit > 0 && Counters.bytes.load(std::memory_order_relaxed) + (int64_t) Length > ByteLimit)) {
+		Counters.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	LogRing* Ring = GetThreadRing();
+	if (!Ring) {
+		Counters.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	uint64_t Position = Ring->write_position.load(std::memory_order_relaxed);
+	if (Position - Ring->read_position.load(std::memory_order_acquire) >= LOG_RING_CAPACITY) {
+		Counters.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	LogRecord& Record = Ring->records[Position % LOG_RING_CAPACITY];
+	std::memcpy(Record.text, log.data(), Length);
+	Record.length = Length;
+	Ring->write_position.store(Position + 1, std::memory_order_release);
+
+	Counters.records.fetch_add(1, std::memory_order_relaxed);
+	Counters.bytes.fetch_add(Length, std::memory_order_relaxed);
+	if (Length < log.size()) {
+		Counters.truncated.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void Logger::DrainLogs(IPC::State* StateMessage) {
+
+	if (is_draining.exchange(true, std::memory_order_acquire)) {
+		return;
+	}
+
+	for (auto& Ring : rings) {
+		uint64_t Position = Ring.read_position.load(std::memory_order_relaxed);
+		uint64_t End = Ring.write_position.load(std::memory_order_acquire);
+		for (; Position != End; ++Position) {
+			const LogRecord& Record = Ring.records[Position % LOG_RING_CAPACITY];
+			StateMessage->add_user_logs(Record.text, Record.length);
+		}
+		Ring.read_position.store(Position, std::memory_order_release);
+	}
+
+	for (auto& Counters : counters) {
+		Counters.records.store(0, std::memory_order_relaxed);
+		Counters.bytes.store(0, std::memory_order_relaxed);
+	}
+
+	is_draining.store(false, std::memory_order_release);
+}
+
+void Logger::SetLimits(int64_t records, int64_t bytes) {
+	records_per_frame = records;
+	bytes_per_frame = bytes;
+}
+
+int64_t Logger::GetDroppedLogs(int64_t player) const {
+	return counters[player].dropped.load();
 }
 
-void Logger::SetLogs(std::string log) {
-	std::lock_guard<std::mutex> lock(logmutex);
-	logs.push_back(log);
+int64_t Logger::GetTruncatedLogs(int64_t player) const {
+	return counters[player].truncated.load();
 }
 
-void Logger::EmptyLogs() {
-	std::lock_guard<std::mutex> lock(logmutex);
-	logs.clear();
+void Logger::SetThreadLogger(Logger* logger, int64_t player) {
+	thread_ring.Release();
+	thread_logger = logger;
+	thread_player = player;
 }
 
 Logger& Logger::Instance() {
 
 	static Logger static_instance;
-	return static_instance;
+	return thread_logger ? *thread_logger : static_instance;
 }
 
 }
@@ -22,25 +22,24 @@
  */
 state::Terrain DepopulateTerrain(const IPC::Terrain& TerrainMessage) {
 
-	std::vector<std::vector<state::TerrainElement> > Grid;
-
-	const int NoOfRows = TerrainMessage.no_of_rows();
+	const int NoOfRows = TerrainMessage.row_size();
 	const int SideLength = TerrainMessage.size_of_element();
 
 	/**
-	 * Iterates through the TerrainMessage object and fills in the Grid with
-	 * position, size and type of terrain
+	 * Iterates through the TerrainMessage object and fills in the type of
+	 * every element, the grid is then built from them in one go
 	 */
-	for (int i = 0; i < TerrainMessage.row_size(); i++)
+	std::vector<uint8_t> Types(NoOfRows * NoOfRows, state::PLAIN);
+
+	for (int i = 0; i < NoOfRows; i++)
 	{
 		const IPC::Terrain::TerrainRow& RowMessage = TerrainMessage.row(i);
-		std::vector<state::TerrainElement> Row;
-		for(int j = 0; j < RowMessage.element_size(); j++)
+		for(int j = 0; j < RowMessage.element_size() && j < NoOfRows; j++)
 		{
 
 			const IPC::Terrain::TerrainElement& ElementMessage = RowMessage.element(j);
-			
-			state::TERRAIN_TYPE terrain_type;
+
+			state::TERRAIN_TYPE terrain_type = state::PLAIN;
 			switch(ElementMessage.type())
 			{
 				case IPC::Terrain::TerrainElement::PLAIN : 
@@ -53,13 +52,11 @@ state::Terrain DepopulateTerrain(const IPC::Terrain& TerrainMessage) {
 					terrain_type = state::MOUNTAIN;
 					break;
 			}
-			Row.push_back(state::TerrainElement(terrain_type, physics::Vector2D(i * SideLength, j * SideLength), SideLength));
+			Types[i * NoOfRows + j] = terrain_type;
 		}
-		Grid.push_back(Row);
 	}
-	state::Terrain TerrainObject(Grid);
 
-	return TerrainObject;
+	return state::Terrain(NoOfRows, Types.data(), SideLength);
 }
 
 namespace ipc {
@@ -80,6 +77,11 @@ namespace ipc {
 		 */
 		GOOGLE_PROTOBUF_VERIFY_VERSION;
 
+		state::Terrain TerrainObject(0);
+		if (LoadBinaryTerrain(filename, &TerrainObject)) {
+			return TerrainObject;
+		}
+
 		IPC::Terrain TerrainMessage;
 
 		std::fstream input(filename, std::ios::in | std::ios::binary);
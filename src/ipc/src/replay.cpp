@@ -0,0 +1,324 @@
+/**
+ * @file replay.cpp
+ * Function definitions for the ReplayWriter and ReplayReader classes
+*/
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "replay.h"
+#include "replay.pb.h"
+#include "state.pb.h"
+
+/**
+ * Size of the header at the start of a replay file
+ */
+const uint64_t HEADER_SIZE = 16;
+
+/**
+ * Size of the footer at the end of a replay file
+ */
+const uint64_t FOOTER_SIZE = 16;
+
+/**
+ * Size of the size in front of each frame
+ */
+const uint64_t FRAME_SIZE_SIZE = 4;
+
+/**
+ * Writes a number as little endian bytes
+ *
+ * @param[in]  value  The number
+ * @param[in]  size   Number of bytes
+ * @param      out    Where to write the bytes
+ */
+static void EncodeLittleEndian(uint64_t value, int size, char* out) {
+	for (int i = 0; i < size; ++i) {
+		out[i] = static_cast<char>(value >> (8 * i));
+	}
+}
+
+/**
+ * Reads a number from little endian bytes
+ *
+ * @param[in]  in    The bytes
+ * @param[in]  size  Number of bytes
+ *
+ * @return     The number
+ */
+static uint64_t DecodeLittleEndian(const char* in, int size) {
+	uint64_t value = 0;
+	for (int i = 0; i < size; ++i) {
+		value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+	}
+	return value;
+}
+
+namespace ipc {
+
+	ReplayWriter::ReplayWriter(const std::string& filename, int64_t keyframe_interval) :
+		file(filename, std::ios::binary | std::ios::trunc),
+		offset(0),
+		encoder(keyframe_interval, LOS_RUN_LENGTH),
+		frame(),
+		keyframe_message(new IPC::Frame),
+		delta_message(new IPC::Frame),
+		index(new IPC::ReplayIndex),
+		buffer() {
+
+		char header[HEADER_SIZE];
+		std::memcpy(header, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+		EncodeLittleEndian(REPLAY_VERSION, 4, header + 8);
+		EncodeLittleEndian(std::max((int64_t) 1, keyframe_interval), 4, header + 12);
+		WriteBytes(header, HEADER_SIZE);
+	}
+
+	ReplayWriter::~ReplayWriter() {
+		Close();
+	}
+
+	bool ReplayWriter::IsOpen() const {
+		return file.is_open() && file.good();
+	}
+
+	void ReplayWriter::WriteBytes(const char* data, uint64_t size) {
+		file.write(data, size);
+		offset += size;
+	}
+
+	void ReplayWriter::Record(const FrameData& Frame) {
+
+		if (!file.is_open()) {
+			return;
+		}
+
+		/**
+		 * The encoder swaps the frame it's given with the previous one,
+		 * so it gets a copy and the caller can still send the frame on
+		 */
+		frame.state = Frame.state;
+		frame.los[0] = Frame.los[0];
+		frame.los[1] = Frame.los[1];
+
+		bool IsKeyframe = encoder.IsNextKeyframe();
+		IPC::Frame* FrameMessage = IsKeyframe ? keyframe_message.get() : delta_message.get();
+		encoder.Encode(frame, FrameMessage);
+
+		IPC::ReplayIndex::Entry* Entry = index->add_entries();
+		Entry->set_tick(Frame.state.tick());
+		Entry->set_game_time_us(Frame.state.game_time_us());
+		Entry->set_offset(offset);
+		Entry->set_is_keyframe(IsKeyframe);
+
+		FrameMessage->SerializeToString(&buffer);
+
+		char size[FRAME_SIZE_SIZE];
+		EncodeLittleEndian(buffer.size(), FRAME_SIZE_SIZE, size);
+		WriteBytes(size, FRAME_SIZE_SIZE);
+		WriteBytes(buffer.data(), buffer.size());
+	}
+
+	void ReplayWriter::Close() {
+
+		if (!file.is_open()) {
+			return;
+		}
+
+		uint64_t index_offset = offset;
+		index->SerializeToString(&buffer);
+		WriteBytes(buffer.data(), buffer.size());
+
+		char footer[FOOTER_SIZE];
+		EncodeLittleEndian(index_offset, 8, footer);
+		std::memcpy(footer + 8, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+		WriteBytes(footer, FOOTER_SIZE);
+
+		file.close();
+	}
+
+	ReplayReader::ReplayReader(const std::string& filename) :
+		data(nullptr),
+		size(0),
+		index(new IPC::ReplayIndex),
+		frame_message(new IPC::Frame),
+		current(),
+		position(-1) {
+
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return;
+		}
+		struct stat info;
+		if (fstat(fd, &info) < 0 || info.st_size < (off_t) HEADER_SIZE) {
+			close(fd);
+			return;
+		}
+		void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			return;
+		}
+		data = static_cast<const char*>(mapping);
+		size = info.st_size;
+
+		if (std::memcmp(data, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0
+			|| DecodeLittleEndian(data + 8, 4) != REPLAY_VERSION) {
+			munmap(mapping, size);
+			data = nullptr;
+			return;
+		}
+
+		if (!ReadIndex()) {
+			ScanFrames();
+		}
+	}
+
+	ReplayReader::~ReplayReader() {
+		if (data) {
+			munmap(const_cast<char*>(data), size);
+		}
+	}
+
+	bool ReplayReader::ReadIndex() {
+
+		if (size < HEADER_SIZE + FOOTER_SIZE
+			|| std::memcmp(data + size - 8, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+			return false;
+		}
+
+		uint64_t index_offset = DecodeLittleEndian(data + size - FOOTER_SIZE, 8);
+		if (index_offset < HEADER_SIZE || index_offset > size - FOOTER_SIZE) {
+			return false;
+		}
+
+		return index->ParseFromArray(data + index_offset, size - FOOTER_SIZE - index_offset);
+	}
+
+	void ReplayReader::ScanFrames() {
+
+		index->Clear();
+
+		uint64_t offset = HEADER_SIZE;
+		while (ParseFrame(offset)) {
+
+			IPC::ReplayIndex::Entry* Entry = index->add_entries();
+			Entry->set_offset(offset);
+			Entry->set_is_keyframe(frame_message->has_keyframe());
+			if (frame_message->has_keyframe()) {
+				Entry->set_tick(frame_message->keyframe().tick());
+				Entry->set_game_time_us(frame_message->keyframe().game_time_us());
+			}
+			else {
+				Entry->set_tick(frame_message->delta().tick());
+				Entry->set_game_time_us(frame_message->delta().game_time_us());
+			}
+
+			offset += FRAME_SIZE_SIZE + DecodeLittleEndian(data + offset, FRAME_SIZE_SIZE);
+		}
+	}
+
+	bool ReplayReader::ParseFrame(uint64_t offset) {
+
+		if (offset + FRAME_SIZE_SIZE > size) {
+			return false;
+		}
+		uint64_t frame_size = DecodeLittleEndian(data + offset, FRAME_SIZE_SIZE);
+		if (offset + FRAME_SIZE_SIZE + frame_size > size) {
+			return false;
+		}
+
+		return frame_message->ParseFromArray(data + offset + FRAME_SIZE_SIZE, frame_size);
+	}
+
+	bool ReplayReader::ApplyFrame(int64_t frame) {
+
+		if (!ParseFrame(index->entries(frame).offset())) {
+			return false;
+		}
+
+		if (frame_message->has_keyframe()) {
+			current.state.Swap(frame_message->mutable_keyframe());
+			DecodeLOS(current.state, current.los);
+			current.state.clear_player1_los();
+			current.state.clear_player2_los();
+			current.state.clear_player1_packed_los();
+			current.state.clear_player2_packed_los();
+		}
+		else if (frame_message->has_delta() && position == frame - 1) {
+			ApplyDelta(frame_message->delta(), &current);
+		}
+		else {
+			return false;
+		}
+
+		position = frame;
+		return true;
+	}
+
+	bool ReplayReader::IsOpen() const {
+		return data != nullptr;
+	}
+
+	int64_t ReplayReader::GetFrameCount() const {
+		return index->entries_size();
+	}
+
+	int64_t ReplayReader::GetTick(int64_t frame) const {
+		return index->entries(frame).tick();
+	}
+
+	int64_t ReplayReader::GetPosition() const {
+		return position;
+	}
+
+	bool ReplayReader::Seek(int64_t tick) {
+
+		auto& Entries = index->entries();
+
+		// The last frame taken at or before the tick
+		auto After = std::upper_bound(Entries.begin(), Entries.end(), tick,
+			[](int64_t tick, const IPC::ReplayIndex::Entry& Entry) {
+				return tick < Entry.tick();
+			});
+		if (After == Entries.begin()) {
+			return false;
+		}
+		int64_t target = (After - Entries.begin()) - 1;
+
+		int64_t keyframe = target;
+		while (keyframe > 0 && !Entries.Get(keyframe).is_keyframe()) {
+			--keyframe;
+		}
+
+		// Carry on from the current frame if it's past the keyframe
+		int64_t frame = position >= keyframe && position <= target ? position + 1 : keyframe;
+
+		for (; frame <= target; ++frame) {
+			if (!ApplyFrame(frame)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ReplayReader::Next() {
+
+		if (position + 1 >= GetFrameCount()) {
+			return false;
+		}
+		return ApplyFrame(position + 1);
+	}
+
+	const FrameData& ReplayReader::GetFrame() const {
+		return current;
+	}
+
+	void ReplayReader::GetState(IPC::State* State, LOS_FORMAT Format) const {
+
+		*State = current.state;
+
+		PopulateLOS(current.los, State, Format);
+	}
+}
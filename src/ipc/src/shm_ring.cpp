@@ -0,0 +1,302 @@
+/**
+ * @file shm_ring.cpp
+ * Function definitions for the shared memory ring buffer
+*/
+#include <climits>
+#include <new>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <google/protobuf/message_lite.h>
+#include "shm_ring.h"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+	"The ring's atomics must be lock free to be shared between processes");
+
+/**
+ * Size of the size field in front of each frame
+ */
+const uint64_t FRAME_HEADER_SIZE = 8;
+
+/**
+ * Rounds a size up to a multiple of 8
+ *
+ * @param[in]  size  The size
+ *
+ * @return     The rounded size
+ */
+static uint64_t Align(uint64_t size) {
+	return (size + 7) & ~(uint64_t) 7;
+}
+
+/**
+ * Gets the futex word of the doorbell
+ *
+ * @param      header  The ring's header
+ *
+ * @return     The futex word
+ */
+static uint32_t* Doorbell(ipc::ShmRingHeader* header) {
+	return reinterpret_cast<uint32_t*>(&header->doorbell);
+}
+
+/**
+ * Rings the doorbell, waking the readers if any are waiting
+ *
+ * @param      header  The ring's header
+ */
+static void RingDoorbell(ipc::ShmRingHeader* header) {
+
+	header->doorbell++;
+	if (header->waiters > 0) {
+		syscall(SYS_futex, Doorbell(header), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	}
+}
+
+namespace ipc {
+
+	ShmRingWriter::ShmRingWriter(const std::string& name, uint64_t capacity) :
+		name(name),
+		header(nullptr),
+		ring(nullptr),
+		mapped_size(sizeof(ShmRingHeader) + Align(capacity)),
+		reserved_position(0),
+		reserved_size(0) {
+
+		shm_unlink(name.c_str());
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) {
+			return;
+		}
+		if (ftruncate(fd, mapped_size) < 0) {
+			close(fd);
+			shm_unlink(name.c_str());
+			return;
+		}
+		void* mapping = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			shm_unlink(name.c_str());
+			return;
+		}
+
+		header = new (mapping) ShmRingHeader();
+		header->version = SHM_RING_VERSION;
+		header->capacity = Align(capacity);
+		header->write_position = 0;
+		header->doorbell = 0;
+		header->closed = 0;
+		header->dropped_frames = 0;
+		header->read_position = 0;
+		header->waiters = 0;
+		ring = static_cast<char*>(mapping) + sizeof(ShmRingHeader);
+
+		// Readers check the magic last, once everything else is set
+		header->magic = SHM_RING_MAGIC;
+	}
+
+	ShmRingWriter::~ShmRingWriter() {
+
+		if (!header) {
+			return;
+		}
+		Close();
+		munmap(header, mapped_size);
+		shm_unlink(name.c_str());
+	}
+
+	bool ShmRingWriter::IsOpen() const {
+		return header != nullptr;
+	}
+
+	char* ShmRingWriter::Reserve(uint32_t size) {
+
+		uint64_t capacity = header->capacity;
+		uint64_t frame_size = FRAME_HEADER_SIZE + Align(size);
+		if (size == SHM_RING_WRAP || frame_size > capacity) {
+			return nullptr;
+		}
+
+		uint64_t position = header->write_position.load(std::memory_order_relaxed);
+		uint64_t offset = position % capacity;
+
+		// Frames never wrap, so one that doesn't fit before the end skips it
+		uint64_t skipped = offset + frame_size > capacity ? capacity - offset : 0;
+
+		uint64_t read_position = header->read_position.load(std::memory_order_acquire);
+		if (position + skipped + frame_size - read_position > capacity) {
+			return nullptr;
+		}
+
+		if (skipped > 0) {
+			*reinterpret_cast<uint32_t*>(ring + offset) = SHM_RING_WRAP;
+			position += skipped;
+			offset = 0;
+		}
+
+		*reinterpret_cast<uint32_t*>(ring + offset) = size;
+		reserved_position = position;
+		reserved_size = frame_size;
+
+		return ring + offset + FRAME_HEADER_SIZE;
+	}
+
+	void ShmRingWriter::Commit() {
+
+		header->write_position = reserved_position + reserved_size;
+		reserved_size = 0;
+
+		RingDoorbell(header);
+	}
+
+	void ShmRingWriter::Write(const google::protobuf::MessageLite& Message) {
+
+		if (!header) {
+			return;
+		}
+
+		size_t size = Message.ByteSizeLong();
+		char* data = size < SHM_RING_WRAP ? Reserve(size) : nullptr;
+		if (!data) {
+			header->dropped_frames++;
+			return;
+		}
+
+		Message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data));
+		Commit();
+	}
+
+	void ShmRingWriter::Close() {
+
+		header->closed = 1;
+		RingDoorbell(header);
+	}
+
+	int64_t ShmRingWriter::GetDroppedFrames() const {
+		return header ? header->dropped_frames.load() : 0;
+	}
+
+	ShmRingReader::ShmRingReader(const std::string& name) :
+		header(nullptr),
+		ring(nullptr),
+		mapped_size(0),
+		next_position(0) {
+
+		int fd = shm_open(name.c_str(), O_RDWR, 0);
+		if (fd < 0) {
+			return;
+		}
+		struct stat info;
+		if (fstat(fd, &info) < 0 || info.st_size < (off_t) sizeof(ShmRingHeader)) {
+			close(fd);
+			return;
+		}
+		mapped_size = info.st_size;
+		void* mapping = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			return;
+		}
+
+		header = static_cast<ShmRingHeader*>(mapping);
+		if (header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION
+			|| sizeof(ShmRingHeader) + header->capacity > mapped_size) {
+			munmap(mapping, mapped_size);
+			header = nullptr;
+			return;
+		}
+		ring = static_cast<const char*>(mapping) + sizeof(ShmRingHeader);
+		next_position = header->read_position;
+	}
+
+	ShmRingReader::~ShmRingReader() {
+
+		if (header) {
+			munmap(header, mapped_size);
+		}
+	}
+
+	bool ShmRingReader::IsOpen() const {
+		return header != nullptr;
+	}
+
+	void ShmRingReader::WaitForDoorbell(std::chrono::nanoseconds timeout) {
+
+		header->waiters++;
+		uint32_t doorbell = header->doorbell;
+
+		// A frame written after the check rings a doorbell we have counted
+		if (header->write_position == next_position && !header->closed) {
+			struct timespec wait_time;
+			wait_time.tv_sec = timeout.count() / 1000000000;
+			wait_time.tv_nsec = timeout.count() % 1000000000;
+			syscall(SYS_futex, Doorbell(header), FUTEX_WAIT, doorbell, &wait_time, nullptr, 0);
+		}
+		header->waiters--;
+	}
+
+	bool ShmRingReader::Next(const char** data, uint32_t* size, std::chrono::nanoseconds timeout) {
+
+		Release();
+
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		uint64_t capacity = header->capacity;
+
+		while (true) {
+
+			uint64_t write_position = header->write_position.load(std::memory_order_acquire);
+
+			if (next_position != write_position) {
+				uint64_t offset = next_position % capacity;
+				uint32_t frame_size = *reinterpret_cast<const uint32_t*>(ring + offset);
+
+				if (frame_size == SHM_RING_WRAP) {
+					next_position += capacity - offset;
+					Release();
+					continue;
+				}
+
+				*data = ring + offset + FRAME_HEADER_SIZE;
+				*size = frame_size;
+				next_position += FRAME_HEADER_SIZE + Align(frame_size);
+				return true;
+			}
+
+			// The last frame is written before the ring is closed
+			if (header->closed && header->write_position == next_position) {
+				return false;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (now >= deadline) {
+				return false;
+			}
+			WaitForDoorbell(deadline - now);
+		}
+	}
+
+	bool ShmRingReader::Next(google::protobuf::MessageLite* message, std::chrono::nanoseconds timeout) {
+
+		const char* data;
+		uint32_t size;
+		if (!Next(&data, &size, timeout)) {
+			return false;
+		}
+		return message->ParseFromArray(data, size);
+	}
+
+	void ShmRingReader::Release() {
+		header->read_position.store(next_position, std::memory_order_release);
+	}
+
+	bool ShmRingReader::IsFinished() const {
+		return header->closed && header->write_position == next_position;
+	}
+
+	int64_t ShmRingReader::GetDroppedFrames() const {
+		return header->dropped_frames;
+	}
+}
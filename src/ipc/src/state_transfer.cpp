@@ -2,15 +2,57 @@
  * @file populate.cpp
  * Function definitions for state transfer
 */
+#include <algorithm>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <memory>
 #include "state.h"
 #include "actor/actor.h"
 #include "ipc.h"
+#include "state_writer.h"
 #include "state.pb.h"
 #include "utilities.h"
 
+/**
+ * Gets the next actor message of a state message to fill in
+ *
+ * An actor message left in the state message by an earlier snapshot is
+ * reused, with its scalar fields reset. Its vector fields are left for the
+ * caller to set or clear, since Clear() would delete them
+ *
+ * @param      StateMessage  the IPC::State message object
+ * @param      ActorCount    No of actor messages filled in so far
+ *
+ * @return     The actor message
+ */
+IPC::State::Actor* NextActor(IPC::State* StateMessage, int* ActorCount) {
+
+	if (*ActorCount == StateMessage->actors_size()) {
+		++*ActorCount;
+		return StateMessage->add_actors();
+	}
+
+	IPC::State::Actor* ActorMessage = StateMessage->mutable_actors((*ActorCount)++);
+
+	ActorMessage->set_id(0);
+	ActorMessage->set_player_id(0);
+	ActorMessage->set_x(0);
+	ActorMessage->set_y(0);
+	ActorMessage->set_is_attacking(false);
+	ActorMessage->set_hp(0);
+	ActorMessage->set_max_hp(0);
+	ActorMessage->set_is_moving(false);
+	ActorMessage->set_is_carrying_flag(false);
+	ActorMessage->set_is_being_carried(false);
+	ActorMessage->set_is_visible_to_enemy(false);
+	ActorMessage->set_contention_meter_score(0);
+	ActorMessage->set_actor_type(IPC::State::Actor::MAGICIAN);
+
+	return ActorMessage;
+}
+
 /**
  * Populates the actors
  *
@@ -37,10 +79,12 @@ void PopulateActors(std::shared_ptr<state::State> StateVar, IPC::State* StateMes
 
 	bool TowerFlag = false;
 
+	int ActorCount = 0;
+
 	for (auto actor1 : P1_Actors)
 	{
 
-		IPC::State::Actor* ActorMessageP1 = StateMessage->add_actors();
+		IPC::State::Actor* ActorMessageP1 = NextActor(StateMessage, &ActorCount);
 
 		ActorMessageP1->set_id(actor1->GetId());
 		ActorMessageP1->set_player_id(actor1->GetPlayerId());
@@ -50,34 +94,35 @@ void PopulateActors(std::shared_ptr<state::State> StateVar, IPC::State* StateMes
 		ActorMessageP1->set_x(pos.x);
 		ActorMessageP1->set_y(pos.y);
 
-		if(!actor1->CanAttack() || actor1->GetAttackTarget() == nullptr)
+		if(!actor1->CanAttack() || actor1->GetAttackTarget() == nullptr) {
 			ActorMessageP1->set_is_attacking(false);
+			ActorMessageP1->clear_attack_target_position();
+		}
 		else {
 			ActorMessageP1->set_is_attacking(true);
 
-			auto AttackTargetPosition = new IPC::State::Vector2D;
+			auto AttackTargetPosition = ActorMessageP1->mutable_attack_target_position();
 			physics::Vector2D attack_pos = actor1->GetAttackTarget()->GetPosition();
 
 			AttackTargetPosition->set_x(attack_pos.x);
 			AttackTargetPosition->set_y(attack_pos.y);
-
-			ActorMessageP1->set_allocated_attack_target_position(AttackTargetPosition);
 		}
 
 		ActorMessageP1->set_hp(actor1->GetHp());
 		ActorMessageP1->set_max_hp(actor1->GetMaxHp());
 		ActorMessageP1->set_is_moving(actor1->GetVelocity().magnitude() != 0);
 
-		IPC::State::Vector2D* Dest = new IPC::State::Vector2D;
-
 		if (actor1->CanPathPlan() && actor1->GetPathPlannerHelper()->IsPathPlanning()) {
 			auto pph = actor1->GetPathPlannerHelper();
 			auto Destination = pph->GetDestination();
 
+			IPC::State::Vector2D* Dest = ActorMessageP1->mutable_destination();
+
 			Dest->set_x(Destination.x);
 			Dest->set_y(Destination.y);
-
-			ActorMessageP1->set_allocated_destination(Dest);
+		}
+		else {
+			ActorMessageP1->clear_destination();
 		}
 
 		state::ActorType typevar = actor1->GetActorType();
@@ -118,7 +163,7 @@ void PopulateActors(std::shared_ptr<state::State> StateVar, IPC::State* StateMes
 
 	for (auto actor2 : P2_Actors)
 	{
-		IPC::State::Actor* ActorMessageP2 = StateMessage->add_actors();
+		IPC::State::Actor* ActorMessageP2 = NextActor(StateMessage, &ActorCount);
 
 		ActorMessageP2->set_id(actor2->GetId());
 		ActorMessageP2->set_player_id(actor2->GetPlayerId());
@@ -128,34 +173,35 @@ void PopulateActors(std::shared_ptr<state::State> StateVar, IPC::State* StateMes
 		ActorMessageP2->set_x(pos.x);
 		ActorMessageP2->set_y(pos.y);
 
-		if(!actor2->CanAttack() || actor2->GetAttackTarget() == nullptr)
+		if(!actor2->CanAttack() || actor2->GetAttackTarget() == nullptr) {
 			ActorMessageP2->set_is_attacking(false);
+			ActorMessageP2->clear_attack_target_position();
+		}
 		else {
 			ActorMessageP2->set_is_attacking(true);
 
-			auto AttackTargetPosition = new IPC::State::Vector2D;
+			auto AttackTargetPosition = ActorMessageP2->mutable_attack_target_position();
 			physics::Vector2D attack_pos = actor2->GetAttackTarget()->GetPosition();
 
 			AttackTargetPosition->set_x(attack_pos.x);
 			AttackTargetPosition->set_y(attack_pos.y);
-
-			ActorMessageP2->set_allocated_attack_target_position(AttackTargetPosition);
 		}
 
 		ActorMessageP2->set_hp(actor2->GetHp());
 		ActorMessageP2->set_max_hp(actor2->GetMaxHp());
 		ActorMessageP2->set_is_moving(actor2->GetVelocity().magnitude() != 0);
 
-		IPC::State::Vector2D* Dest = new IPC::State::Vector2D;
-
 		if (actor2->CanPathPlan() && actor2->GetPathPlannerHelper()->IsPathPlanning()) {
 			auto pph = actor2->GetPathPlannerHelper();
 			auto Destination = pph->GetDestination();
 
+			IPC::State::Vector2D* Dest = ActorMessageP2->mutable_destination();
+
 			Dest->set_x(Destination.x);
 			Dest->set_y(Destination.y);
-
-			ActorMessageP2->set_allocated_destination(Dest);
+		}
+		else {
+			ActorMessageP2->clear_destination();
 		}
 
 		state::ActorType typevar2 = actor2->GetActorType();
@@ -193,7 +239,7 @@ void PopulateActors(std::shared_ptr<state::State> StateVar, IPC::State* StateMes
 
 	for(auto Projectile : Projectiles)
 	{
-		IPC::State::Actor* ActorMessageProjectiles = StateMessage->add_actors();
+		IPC::State::Actor* ActorMessageProjectiles = NextActor(StateMessage, &ActorCount);
 
 		ActorMessageProjectiles->set_id(Projectile->GetId());
 		ActorMessageProjectiles->set_player_id(Projectile->GetPlayerId());
@@ -204,6 +250,16 @@ void PopulateActors(std::shared_ptr<state::State> StateVar, IPC::State* StateMes
 		ActorMessageProjectiles->set_y(pos.y);
 
 		ActorMessageProjectiles->set_actor_type(IPC::State::Actor::FIREBALL);
+		ActorMessageProjectiles->clear_attack_target_position();
+		ActorMessageProjectiles->clear_destination();
+	}
+
+	/**
+	 * Actor messages left over from a bigger earlier state are removed,
+	 * kept by the repeated field to be added again
+	 */
+	while (StateMessage->actors_size() > ActorCount) {
+		StateMessage->mutable_actors()->RemoveLast();
 	}
 
 	StateMessage->set_no_of_actors(ActorLength);
@@ -219,79 +275,90 @@ void PopulateActors(std::shared_ptr<state::State> StateVar, IPC::State* StateMes
 }
 
 /**
- * Populates the LOS for player 1 and player 2
+ * Gets the LOS of every terrain element for a player
  *
- * State LOS for player 1 and 2 are stored as embedded LOS messages which
- * are 2D arrays of enum LOS_TYPE
- *
- * @param[in]  StateVar        the state::State object
- * @param[in]  StateMessage    the IPC::State message object
+ * @param      TerrainVar  the state::Terrain object
+ * @param[in]  PlayerId    the player
+ * @param      Cells       LOS of each element in row major order, as
+ *                         IPC::State::LOS::LOS_TYPE values
  */
-void PopulateLOS(std::shared_ptr<state::State> StateVar, IPC::State* StateMessage) {
+void GetLOSCells(state::Terrain& TerrainVar, state::PlayerId PlayerId, std::vector<uint8_t>& Cells) {
 
-	state::PlayerId P1 = state::PLAYER1;
-	state::PlayerId P2 = state::PLAYER2;
-
-	state::Terrain TerrainVar = StateVar->GetTerrain();
-
-	/**
-	 * Create constructed instances of LOS to pass to StateMessage
-	 */
-	IPC::State::LOS* LOSP1 = new IPC::State::LOS;
-	IPC::State::LOS* LOSP2 = new IPC::State::LOS;
-
-	/**
-	 * Loop through the terrain to get LOS for each terrain element for each player
-	 */
 	int64_t size = TerrainVar.GetRows();
 
-	for (double row = 0; row < size; ++row) {
+	Cells.resize(size * size);
 
-		IPC::State::LOS::LOSRows* LOSRowsP1 = LOSP1->add_row();
-		IPC::State::LOS::LOSRows* LOSRowsP2 = LOSP2->add_row();
-		for (double col = 0; col < size; ++col) {
+	for (int64_t row = 0; row < size; ++row) {
+		for (int64_t col = 0; col < size; ++col) {
 
-			physics::Vector2D offset;
+			physics::Vector2D offset(row, col);
 
-			offset.x = row;
-			offset.y = col;
-
-			state::TerrainElement ElementVar = TerrainVar.OffsetToTerrainElement(offset);
-
-			state::LOS_TYPE Player1LOS = ElementVar.GetLos(P1);
-			state::LOS_TYPE Player2LOS = ElementVar.GetLos(P2);
-
-			switch(Player1LOS){
-				case state::UNEXPLORED :
-					LOSRowsP1->add_element(IPC::State::LOS::UNEXPLORED);
-					break;
-				case state::EXPLORED :
-					LOSRowsP1->add_element(IPC::State::LOS::EXPLORED);
-					break;
-				case state::DIRECT_LOS :
-					LOSRowsP1->add_element(IPC::State::LOS::DIRECT_LOS);
-					break;
-			}
-			switch(Player2LOS){
+			switch(TerrainVar.OffsetToTerrainElement(offset).GetLos(PlayerId)){
 				case state::UNEXPLORED :
-					LOSRowsP2->add_element(IPC::State::LOS::UNEXPLORED);
+					Cells[row * size + col] = IPC::State::LOS::UNEXPLORED;
 					break;
 				case state::EXPLORED :
-					LOSRowsP2->add_element(IPC::State::LOS::EXPLORED);
+					Cells[row * size + col] = IPC::State::LOS::EXPLORED;
 					break;
 				case state::DIRECT_LOS :
-					LOSRowsP2->add_element(IPC::State::LOS::DIRECT_LOS);
+					Cells[row * size + col] = IPC::State::LOS::DIRECT_LOS;
 					break;
 			}
 		}
 	}
-	/**
-	 * Pass instances of LOS to StateMessage for player 1 and 2
-	 */
-	StateMessage->set_allocated_player1_los(LOSP1);
-	StateMessage->set_allocated_player2_los(LOSP2);
+}
 
-	return;
+/**
+ * Writes a player's LOS into an LOS message as rows of elements
+ *
+ * @param[in]  Cells       LOS of each element in row major order
+ * @param[in]  size        Number of rows
+ * @param      LOSMessage  the IPC::State::LOS message object
+ */
+void PopulateLOSRows(const std::vector<uint8_t>& Cells, int64_t size, IPC::State::LOS* LOSMessage) {
+
+	for (int64_t row = 0; row < size; ++row) {
+
+		IPC::State::LOS::LOSRows* LOSRows = LOSMessage->add_row();
+
+		for (int64_t col = 0; col < size; ++col) {
+			LOSRows->add_element(static_cast<IPC::State::LOS::LOS_TYPE>(Cells[row * size + col]));
+		}
+	}
+}
+
+/**
+ * Reads a player's LOS out of an LOS message made of rows of elements
+ *
+ * @param[in]  LOSMessage  the IPC::State::LOS message object
+ * @param      Cells       LOS of each element in row major order
+ */
+void DepopulateLOSRows(const IPC::State::LOS& LOSMessage, std::vector<uint8_t>& Cells) {
+
+	Cells.clear();
+
+	for (auto& LOSRows : LOSMessage.row()) {
+		for (auto Element : LOSRows.element()) {
+			Cells.push_back(Element);
+		}
+	}
+}
+
+/**
+ * Applies the LOS cells that changed in a delta
+ *
+ * @param[in]  Cells   The changed cells of the delta
+ * @param[in]  Values  The new LOS values of the delta
+ * @param      LOS     LOS of the frame before the delta
+ */
+void ApplyLOSDelta(const google::protobuf::RepeatedField<int64_t>& Cells,
+	const google::protobuf::RepeatedField<int>& Values, std::vector<uint8_t>& LOS) {
+
+	for (int64_t i = 0; i < Cells.size(); ++i) {
+		if (Cells.Get(i) >= 0 && Cells.Get(i) < static_cast<int64_t>(LOS.size())) {
+			LOS[Cells.Get(i)] = Values.Get(i);
+		}
+	}
 }
 
 /**
@@ -301,18 +368,310 @@ void PopulateLOS(std::shared_ptr<state::State> StateVar, IPC::State* StateMessag
  */
 void PopulateLogger(IPC::State* StateMessage) {
 
-	std::vector<std::string> Logs = ipc::Logger::Instance().GetLogs();
+	ipc::Logger::Instance().DrainLogs(StateMessage);
+}
 
-	for(auto Log : Logs) {
+/**
+ * Checks if two optional vector fields of an actor message are the same
+ *
+ * @param[in]  HasA  true if the first is set
+ * @param[in]  A     The first
+ * @param[in]  HasB  true if the second is set
+ * @param[in]  B     The second
+ *
+ * @return     true if they are, false otherwise
+ */
+bool SameVector2D(bool HasA, const IPC::State::Vector2D& A,
+	bool HasB, const IPC::State::Vector2D& B) {
 
-		StateMessage->add_user_logs(Log);
-	}
+	return HasA == HasB && (!HasA || (A.x() == B.x() && A.y() == B.y()));
+}
 
-	ipc::Logger::Instance().EmptyLogs();
+/**
+ * Checks if an actor has the same fields in two frames
+ *
+ * Compares the fields directly, so that unchanged actors cost no
+ * serialisation
+ *
+ * @param[in]  A     The actor in the previous frame
+ * @param[in]  B     The actor in this frame
+ *
+ * @return     true if every field is the same, false otherwise
+ */
+bool SameActor(const IPC::State::Actor& A, const IPC::State::Actor& B) {
+
+	return A.id() == B.id()
+		&& A.player_id() == B.player_id()
+		&& A.x() == B.x()
+		&& A.y() == B.y()
+		&& A.is_attacking() == B.is_attacking()
+		&& A.hp() == B.hp()
+		&& A.max_hp() == B.max_hp()
+		&& SameVector2D(A.has_attack_target_position(), A.attack_target_position(),
+			B.has_attack_target_position(), B.attack_target_position())
+		&& A.is_moving() == B.is_moving()
+		&& SameVector2D(A.has_destination(), A.destination(),
+			B.has_destination(), B.destination())
+		&& A.is_carrying_flag() == B.is_carrying_flag()
+		&& A.is_being_carried() == B.is_being_carried()
+		&& A.is_visible_to_enemy() == B.is_visible_to_enemy()
+		&& A.contention_meter_score() == B.contention_meter_score()
+		&& A.actor_type() == B.actor_type();
+}
+
+/**
+ * Adds the LOS cells that differ between two frames to a delta
+ *
+ * @param[in]  Previous  LOS in the previous frame
+ * @param[in]  Current   LOS in this frame
+ * @param      Cells     The changed cells of the delta
+ * @param      Values    The new LOS values of the delta
+ */
+void PopulateLOSDelta(const std::vector<uint8_t>& Previous, const std::vector<uint8_t>& Current,
+	google::protobuf::RepeatedField<int64_t>* Cells, google::protobuf::RepeatedField<int>* Values) {
+
+	for (int64_t cell = 0; cell < static_cast<int64_t>(Current.size()); ++cell) {
+		if (Previous[cell] != Current[cell]) {
+			Cells->Add(cell);
+			Values->Add(Current[cell]);
+		}
+	}
 }
 
 namespace ipc {
 
+	void PackLOS(const std::vector<uint8_t>& Cells, std::string* Packed) {
+
+		Packed->assign((Cells.size() + 3) / 4, '\0');
+
+		for (int64_t cell = 0; cell < static_cast<int64_t>(Cells.size()); ++cell) {
+			(*Packed)[cell / 4] |= (Cells[cell] & 3) << (2 * (cell % 4));
+		}
+	}
+
+	std::string PackLOS(const std::vector<uint8_t>& Cells) {
+
+		std::string Packed;
+
+		PackLOS(Cells, &Packed);
+
+		return Packed;
+	}
+
+	std::vector<uint8_t> UnpackLOS(const std::string& Packed, int64_t CellCount) {
+
+		std::vector<uint8_t> Cells(std::min<int64_t>(CellCount, Packed.size() * 4));
+
+		for (int64_t cell = 0; cell < static_cast<int64_t>(Cells.size()); ++cell) {
+			Cells[cell] = (static_cast<uint8_t>(Packed[cell / 4]) >> (2 * (cell % 4))) & 3;
+		}
+
+		return Cells;
+	}
+
+	void RunLengthEncodeLOS(const std::vector<uint8_t>& Cells, std::string* Encoded) {
+
+		Encoded->clear();
+
+		for (int64_t start = 0; start < static_cast<int64_t>(Cells.size()); ) {
+
+			int64_t end = start + 1;
+			while (end < static_cast<int64_t>(Cells.size()) && Cells[end] == Cells[start]) {
+				++end;
+			}
+
+			/**
+			 * Each run is a varint of its length shifted left by 2, with
+			 * the value in the low 2 bits
+			 */
+			uint64_t run = static_cast<uint64_t>(end - start) << 2 | (Cells[start] & 3);
+			while (run >= 0x80) {
+				Encoded->push_back(static_cast<char>(run | 0x80));
+				run >>= 7;
+			}
+			Encoded->push_back(static_cast<char>(run));
+
+			start = end;
+		}
+	}
+
+	std::string RunLengthEncodeLOS(const std::vector<uint8_t>& Cells) {
+
+		std::string Encoded;
+
+		RunLengthEncodeLOS(Cells, &Encoded);
+
+		return Encoded;
+	}
+
+	std::vector<uint8_t> RunLengthDecodeLOS(const std::string& Encoded) {
+
+		std::vector<uint8_t> Cells;
+
+		uint64_t run = 0;
+		int shift = 0;
+		for (char byte : Encoded) {
+
+			run |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			shift += 7;
+
+			if ((byte & 0x80) == 0) {
+				Cells.insert(Cells.end(), run >> 2, run & 3);
+				run = 0;
+				shift = 0;
+			}
+		}
+
+		return Cells;
+	}
+
+	void PopulateLOS(const std::vector<uint8_t> (&Cells)[2], IPC::State* StateMessage, LOS_FORMAT Format) {
+
+		int64_t size = StateMessage->no_of_rows();
+
+		switch(Format){
+			case ipc::LOS_ROWS :
+				StateMessage->set_los_format(IPC::State::LOS_ROWS);
+				PopulateLOSRows(Cells[0], size, StateMessage->mutable_player1_los());
+				PopulateLOSRows(Cells[1], size, StateMessage->mutable_player2_los());
+				break;
+			case ipc::LOS_PACKED :
+				StateMessage->set_los_format(IPC::State::LOS_PACKED);
+				ipc::PackLOS(Cells[0], StateMessage->mutable_player1_packed_los());
+				ipc::PackLOS(Cells[1], StateMessage->mutable_player2_packed_los());
+				break;
+			case ipc::LOS_RUN_LENGTH :
+				StateMessage->set_los_format(IPC::State::LOS_RUN_LENGTH);
+				ipc::RunLengthEncodeLOS(Cells[0], StateMessage->mutable_player1_packed_los());
+				ipc::RunLengthEncodeLOS(Cells[1], StateMessage->mutable_player2_packed_los());
+				break;
+		}
+
+		return;
+	}
+
+	void DecodeLOS(const IPC::State& StateMessage, std::vector<uint8_t> (&Cells)[2]) {
+
+		int64_t CellCount = StateMessage.no_of_rows() * StateMessage.no_of_rows();
+
+		switch(StateMessage.los_format()) {
+			case IPC::State::LOS_PACKED :
+				Cells[0] = UnpackLOS(StateMessage.player1_packed_los(), CellCount);
+				Cells[1] = UnpackLOS(StateMessage.player2_packed_los(), CellCount);
+				break;
+			case IPC::State::LOS_RUN_LENGTH :
+				Cells[0] = RunLengthDecodeLOS(StateMessage.player1_packed_los());
+				Cells[1] = RunLengthDecodeLOS(StateMessage.player2_packed_los());
+				break;
+			default :
+				DepopulateLOSRows(StateMessage.player1_los(), Cells[0]);
+				DepopulateLOSRows(StateMessage.player2_los(), Cells[1]);
+				break;
+		}
+	}
+
+	void ApplyDelta(const IPC::StateDelta& DeltaMessage, FrameData* Frame) {
+
+		auto* Actors = Frame->state.mutable_actors();
+
+		std::unordered_map<int64_t, int> ActorIndex;
+		for (int i = 0; i < Actors->size(); ++i) {
+			ActorIndex[Actors->Get(i).id()] = i;
+		}
+
+		for (auto& Actor : DeltaMessage.changed_actors()) {
+			auto Found = ActorIndex.find(Actor.id());
+			if (Found == ActorIndex.end()) {
+				*Actors->Add() = Actor;
+			}
+			else {
+				*Actors->Mutable(Found->second) = Actor;
+			}
+		}
+
+		if (DeltaMessage.removed_actor_ids_size() > 0) {
+
+			std::unordered_set<int64_t> RemovedIds(DeltaMessage.removed_actor_ids().begin(),
+				DeltaMessage.removed_actor_ids().end());
+
+			int Kept = 0;
+			for (int i = 0; i < Actors->size(); ++i) {
+				if (RemovedIds.count(Actors->Get(i).id()) == 0) {
+					Actors->SwapElements(Kept++, i);
+				}
+			}
+			Actors->DeleteSubrange(Kept, Actors->size() - Kept);
+		}
+
+		ApplyLOSDelta(DeltaMessage.player1_los_cells(), DeltaMessage.player1_los_values(), Frame->los[0]);
+		ApplyLOSDelta(DeltaMessage.player2_los_cells(), DeltaMessage.player2_los_values(), Frame->los[1]);
+
+		Frame->state.set_no_of_actors(DeltaMessage.no_of_actors());
+		Frame->state.set_contention_meter_limit(DeltaMessage.contention_meter_limit());
+		Frame->state.set_score_player1(DeltaMessage.score_player1());
+		Frame->state.set_score_player2(DeltaMessage.score_player2());
+		Frame->state.set_exit_status(DeltaMessage.exit_status());
+		*Frame->state.mutable_user_logs() = DeltaMessage.user_logs();
+		Frame->state.set_tick(DeltaMessage.tick());
+		Frame->state.set_game_time_us(DeltaMessage.game_time_us());
+	}
+
+	void SnapshotState(std::shared_ptr<state::State> StateVar, bool ExitStatus, FrameData* Frame) {
+
+		/**
+		 * Clear() would delete the LOS and actor vector submessages, so
+		 * the fields of a reused frame are reset one by one instead. The
+		 * actor messages are refilled in place by PopulateActors, and the
+		 * LOS rows are emptied for PopulateLOS to fill again
+		 */
+		IPC::State& StateMessage = Frame->state;
+
+		if (StateMessage.has_player1_los()) {
+			StateMessage.mutable_player1_los()->clear_row();
+		}
+		if (StateMessage.has_player2_los()) {
+			StateMessage.mutable_player2_los()->clear_row();
+		}
+		StateMessage.clear_player1_packed_los();
+		StateMessage.clear_player2_packed_los();
+		StateMessage.clear_user_logs();
+		StateMessage.clear_contention_meter_limit();
+		StateMessage.clear_los_format();
+		StateMessage.clear_tick();
+		StateMessage.clear_game_time_us();
+
+		PopulateActors(StateVar, &Frame->state, ExitStatus);
+
+		state::Terrain& TerrainVar = StateVar->GetTerrain();
+
+		Frame->state.set_no_of_rows(TerrainVar.GetRows());
+
+		GetLOSCells(TerrainVar, state::PLAYER1, Frame->los[0]);
+		GetLOSCells(TerrainVar, state::PLAYER2, Frame->los[1]);
+
+		PopulateLogger(&Frame->state);
+	}
+
+	StreamOutput::StreamOutput(std::ostream& out) :
+		out(out),
+		buffer() {}
+
+	void StreamOutput::Write(const google::protobuf::MessageLite& Message) {
+
+		Message.SerializeToString(&buffer);
+
+		out.write(buffer.data(), buffer.size());
+
+		out << std::flush;
+	}
+
+	void WriteState(FrameData& Frame, LOS_FORMAT Format, FrameOutput& Out) {
+
+		PopulateLOS(Frame.los, &Frame.state, Format);
+
+		Out.Write(Frame.state);
+	}
+
 	/**
 	 * Populates the state message
 	 *
@@ -321,7 +680,15 @@ namespace ipc {
 	 * @param[in]  StateVar  the state object
 	 */
 
-	void StateTransfer(std::shared_ptr<state::State> StateVar, bool ExitStatus) {
+	void StateTransfer(std::shared_ptr<state::State> StateVar, bool ExitStatus, LOS_FORMAT Format) {
+
+		static thread_local StreamOutput Out(std::cout);
+
+		StateTransfer(StateVar, ExitStatus, Format, Out);
+	}
+
+	void StateTransfer(std::shared_ptr<state::State> StateVar, bool ExitStatus, LOS_FORMAT Format,
+		FrameOutput& Out) {
 
 		/**
 		 * Verify that the version of the library that we linked against is
@@ -329,18 +696,165 @@ namespace ipc {
 		 */
 		GOOGLE_PROTOBUF_VERIFY_VERSION;
 
-		IPC::State StateMessage;
+		/**
+		 * Kept from frame to frame so its memory is reused
+		 */
+		static thread_local FrameData Frame;
+
+		SnapshotState(StateVar, ExitStatus, &Frame);
 
-		PopulateActors(StateVar, &StateMessage, ExitStatus);
+		WriteState(Frame, Format, Out);
 
-		PopulateLOS(StateVar, &StateMessage);
+		return;
+	}
 
-		PopulateLogger(&StateMessage);
+	DeltaEncoder::DeltaEncoder(int64_t keyframe_interval, LOS_FORMAT los_format) :
+		keyframe_interval(std::max((int64_t) 1, keyframe_interval)),
+		frame_number(0),
+		los_format(los_format),
+		previous(new IPC::State),
+		actor_index(),
+		snapshot(new FrameData),
+		keyframe_message(new IPC::Frame),
+		delta_message(new IPC::Frame) {}
 
-		StateMessage.SerializeToOstream(&std::cout);
+	DeltaEncoder::~DeltaEncoder() {}
 
-		std::cout << std::flush;
+	void DeltaEncoder::EncodeDelta(const FrameData& Frame, IPC::StateDelta* DeltaMessage) {
 
-		return;
+		const IPC::State& Current = Frame.state;
+
+		/**
+		 * actor_index maps an actor ID to its position in the previous
+		 * frame, -1 if it wasn't there. Matched actors are marked -2
+		 */
+		for (int64_t i = 0; i < previous->actors_size(); ++i) {
+			int64_t id = previous->actors(i).id();
+			if (id < 0) {
+				continue;
+			}
+			if (id >= static_cast<int64_t>(actor_index.size())) {
+				actor_index.resize(id + 1, -1);
+			}
+			actor_index[id] = i;
+		}
+
+		for (auto& Actor : Current.actors()) {
+
+			int64_t id = Actor.id();
+			int64_t i = id >= 0 && id < static_cast<int64_t>(actor_index.size())
+				? actor_index[id] : -1;
+
+			/**
+			 * Actors with IDs that can't be matched are always sent
+			 */
+			if (i < 0) {
+				*DeltaMessage->add_changed_actors() = Actor;
+				continue;
+			}
+
+			if (!SameActor(previous->actors(i), Actor)) {
+				*DeltaMessage->add_changed_actors() = Actor;
+			}
+			actor_index[id] = -2;
+		}
+
+		for (auto& Actor : previous->actors()) {
+			int64_t id = Actor.id();
+			if (id < 0) {
+				continue;
+			}
+			if (actor_index[id] != -2) {
+				DeltaMessage->add_removed_actor_ids(id);
+			}
+			actor_index[id] = -1;
+		}
+
+		PopulateLOSDelta(previous_los[0], Frame.los[0],
+			DeltaMessage->mutable_player1_los_cells(), DeltaMessage->mutable_player1_los_values());
+		PopulateLOSDelta(previous_los[1], Frame.los[1],
+			DeltaMessage->mutable_player2_los_cells(), DeltaMessage->mutable_player2_los_values());
+
+		DeltaMessage->set_no_of_actors(Current.no_of_actors());
+		DeltaMessage->set_contention_meter_limit(Current.contention_meter_limit());
+		DeltaMessage->set_score_player1(Current.score_player1());
+		DeltaMessage->set_score_player2(Current.score_player2());
+		DeltaMessage->set_exit_status(Current.exit_status());
+		DeltaMessage->set_tick(Current.tick());
+		DeltaMessage->set_game_time_us(Current.game_time_us());
+		*DeltaMessage->mutable_user_logs() = Current.user_logs();
+	}
+
+	bool DeltaEncoder::IsNextKeyframe() const {
+		return frame_number % keyframe_interval == 0;
+	}
+
+	void DeltaEncoder::Encode(FrameData& Frame, IPC::Frame* FrameVar) {
+
+		bool IsKeyframe = IsNextKeyframe();
+
+		FrameVar->set_frame_number(frame_number);
+
+		if (IsKeyframe) {
+			/**
+			 * A delta only needs the cells to compare, not the LOS message
+			 */
+			PopulateLOS(Frame.los, &Frame.state, los_format);
+			*FrameVar->mutable_keyframe() = Frame.state;
+		}
+		else {
+			IPC::StateDelta* DeltaMessage = FrameVar->mutable_delta();
+			DeltaMessage->Clear();
+			EncodeDelta(Frame, DeltaMessage);
+		}
+
+		/**
+		 * Swapping hands the old previous frame's memory back to the
+		 * caller to reuse. Logs are sent once, the next frame must not
+		 * compare against them
+		 */
+		previous->Swap(&Frame.state);
+		previous->clear_user_logs();
+		previous_los[0].swap(Frame.los[0]);
+		previous_los[1].swap(Frame.los[1]);
+		frame_number++;
+	}
+
+	void DeltaEncoder::Encode(std::shared_ptr<state::State> StateVar, bool ExitStatus, IPC::Frame* FrameVar) {
+
+		SnapshotState(StateVar, ExitStatus, snapshot.get());
+
+		Encode(*snapshot, FrameVar);
+	}
+
+	void DeltaEncoder::WriteFrame(FrameData& Frame, FrameOutput& Out) {
+
+		/**
+		 * Keyframes and deltas each have a message of their own, so that
+		 * neither is ever freed by switching the other one in
+		 */
+		IPC::Frame* FrameMessage = IsNextKeyframe()
+			? keyframe_message.get() : delta_message.get();
+
+		Encode(Frame, FrameMessage);
+
+		Out.Write(*FrameMessage);
+	}
+
+	void DeltaEncoder::StateTransfer(std::shared_ptr<state::State> StateVar, bool ExitStatus) {
+
+		static thread_local StreamOutput Out(std::cout);
+
+		StateTransfer(StateVar, ExitStatus, Out);
+	}
+
+	void DeltaEncoder::StateTransfer(std::shared_ptr<state::State> StateVar, bool ExitStatus,
+		FrameOutput& Out) {
+
+		GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+		SnapshotState(StateVar, ExitStatus, snapshot.get());
+
+		WriteFrame(*snapshot, Out);
 	}
 }
@@ -0,0 +1,217 @@
+/**
+ * @file state_writer.cpp
+ * Function definitions for the StateWriter class
+*/
+#include <algorithm>
+#include "replay.h"
+#include "state_writer.h"
+
+/**
+ * Moves the user logs of a frame that won't be written to the front of
+ * another frame's logs
+ *
+ * @param      From  The frame that won't be written
+ * @param      To    The frame that will
+ */
+static void HandOnLogs(ipc::FrameData& From, ipc::FrameData& To) {
+
+	if (From.state.user_logs_size() == 0) {
+		return;
+	}
+
+	From.state.mutable_user_logs()->MergeFrom(To.state.user_logs());
+	To.state.mutable_user_logs()->Swap(From.state.mutable_user_logs());
+}
+
+namespace ipc {
+
+	StateWriter::StateWriter(FrameOutput* out, int64_t capacity, WRITER_QUEUE_POLICY policy,
+		LOS_FORMAT los_format, int64_t keyframe_interval, ReplayWriter* replay) :
+		out(out),
+		replay(replay),
+		capacity(std::max((int64_t) 1, capacity)),
+		policy(policy),
+		los_format(los_format),
+		delta_encoder(),
+		queue(),
+		sent_frames(0),
+		free_frames(),
+		is_stopped(false),
+		dropped_frames(0),
+		coalesced_frames(0),
+		blocked_pushes(0) {
+
+		if (keyframe_interval > 0) {
+			delta_encoder.reset(new DeltaEncoder(keyframe_interval, los_format));
+		}
+		writer = std::thread(&StateWriter::WriterLoop, this);
+	}
+
+	StateWriter::~StateWriter() {
+		Stop();
+	}
+
+	std::unique_ptr<FrameData> StateWriter::GetFrame() {
+
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+
+			if (!free_frames.empty()) {
+				std::unique_ptr<FrameData> frame = std::move(free_frames.back());
+				free_frames.pop_back();
+				return frame;
+			}
+		}
+		return std::unique_ptr<FrameData>(new FrameData);
+	}
+
+	void StateWriter::Recycle(std::unique_ptr<FrameData> frame) {
+
+		/**
+		 * Frames in the queue, one being written and one being filled
+		 * are all that are usually in use. Frames only waiting to be
+		 * recorded beyond those are freed
+		 */
+		if (static_cast<int64_t>(free_frames.size()) < capacity + 2) {
+			free_frames.push_back(std::move(frame));
+		}
+	}
+
+	void StateWriter::Drop(int64_t index) {
+
+		sent_frames--;
+
+		if (replay) {
+			queue[index].is_sent = false;
+			return;
+		}
+		Recycle(std::move(queue[index].frame));
+		queue.erase(queue.begin() + index);
+	}
+
+	void StateWriter::Push(std::unique_ptr<FrameData> frame) {
+
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+
+			/**
+			 * Frames that are only recorded are never dropped, so the
+			 * replay stays whole
+			 */
+			if (out && sent_frames >= capacity) {
+
+				/**
+				 * Dropping the oldest frames keeps those waiting only to
+				 * be recorded ahead of the ones to be written
+				 */
+				int64_t oldest = queue.size() - sent_frames;
+
+				switch(policy) {
+					case DROP_OLDEST :
+						HandOnLogs(*queue[oldest].frame,
+							sent_frames > 1 ? *queue[oldest + 1].frame : *frame);
+						Drop(oldest);
+						dropped_frames++;
+						break;
+					case BLOCK :
+						blocked_pushes++;
+						not_full_cv.wait(lock, [this] {
+							return sent_frames < capacity;
+						});
+						break;
+					case COALESCE :
+						HandOnLogs(*queue.back().frame, *frame);
+						Drop(queue.size() - 1);
+						coalesced_frames++;
+						break;
+				}
+			}
+
+			/**
+			 * Frames waiting only to be recorded are bounded too, so a
+			 * stalled output can't make the queue grow without end
+			 */
+			if (replay && static_cast<int64_t>(queue.size()) - sent_frames >= capacity) {
+				blocked_pushes++;
+				not_full_cv.wait(lock, [this] {
+					return static_cast<int64_t>(queue.size()) - sent_frames < capacity;
+				});
+			}
+
+			queue.push_back({std::move(frame), out != nullptr});
+			if (out) {
+				sent_frames++;
+			}
+		}
+		not_empty_cv.notify_one();
+	}
+
+	void StateWriter::WriterLoop() {
+
+		GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+		while (true) {
+
+			QueuedFrame queued;
+			{
+				std::unique_lock<std::mutex> lock(queue_mutex);
+				not_empty_cv.wait(lock, [this] {
+					return is_stopped || !queue.empty();
+				});
+				if (queue.empty()) {
+					break;
+				}
+				queued = std::move(queue.front());
+				queue.pop_front();
+				if (queued.is_sent) {
+					sent_frames--;
+				}
+			}
+			not_full_cv.notify_one();
+
+			std::unique_ptr<FrameData>& frame = queued.frame;
+
+			/**
+			 * Writing changes the frame, so it's recorded first
+			 */
+			if (replay) {
+				replay->Record(*frame);
+			}
+			if (queued.is_sent && out) {
+				if (delta_encoder) {
+					delta_encoder->WriteFrame(*frame, *out);
+				}
+				else {
+					WriteState(*frame, los_format, *out);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			Recycle(std::move(frame));
+		}
+	}
+
+	void StateWriter::Stop() {
+
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			is_stopped = true;
+		}
+		not_empty_cv.notify_one();
+		if (writer.joinable()) {
+			writer.join();
+		}
+	}
+
+	int64_t StateWriter::GetDroppedFrames() {
+		return dropped_frames;
+	}
+
+	int64_t StateWriter::GetCoalescedFrames() {
+		return coalesced_frames;
+	}
+
+	int64_t StateWriter::GetBlockedPushes() {
+		return blocked_pushes;
+	}
+}
@@ -3,129 +3,17 @@
 #include <fstream>
 #include <algorithm>
 #include <cmath>
+#include <stdexcept>
 #include "player_state_handler/player_state_handler.h"
 #include "ipc.h"
+#include "initial_state.h"
 #include "main_driver.h"
+#include "match_scheduler.h"
 #include "player1.h"
 #include "player2.h"
 #include "ai.h"
 #include "ai1.h"
 
-const int64_t ELEMENT_SIZE = 200;
-
-/**
- * Makes a state object with the given terrain
- *
- * @param[in]  terrain  The terrain
- *
- * @return     The state object
- */
-state::State MakeState(state::Terrain terrain)
-{
-	std::vector<std::shared_ptr<state::Base> > bases(2);
-	std::vector<std::shared_ptr<state::Flag> > flags(2);
-	std::vector<std::shared_ptr<state::King> > kings(2);
-	std::vector<std::vector<std::shared_ptr<state::Scout> > > scouts(
-		2, std::vector<std::shared_ptr<state::Scout> >(1));
-	std::vector<std::vector<std::shared_ptr<state::Tower> > > towers(
-		2, std::vector<std::shared_ptr<state::Tower> >(3));
-	std::vector<std::vector<std::shared_ptr<state::Swordsman> > > swordsmen(
-		2, std::vector<std::shared_ptr<state::Swordsman> >(20));
-	std::vector<std::vector<std::shared_ptr<state::Magician> > > magicians(
-		2, std::vector<std::shared_ptr<state::Magician> >(10));
-	std::vector<std::vector<std::shared_ptr<state::Actor> > > sorted_actors(2);
-
-	flags[0] = std::shared_ptr<state::Flag>(new state::Flag(0, state::PLAYER1, 0, 0, 0, 0, 10, 0, 0, 0,
-		physics::Vector2D(4 * ELEMENT_SIZE, 4 * ELEMENT_SIZE), physics::Vector2D(0, 0), 0, 0));
-	sorted_actors[0].push_back(std::static_pointer_cast<state::Actor>(flags[0]));
-
-	flags[1] = std::shared_ptr<state::Flag>(new state::Flag(1, state::PLAYER2, 0, 0, 0, 0, 10, 0, 0, 0,
-		physics::Vector2D(27 * ELEMENT_SIZE, 27 * ELEMENT_SIZE), physics::Vector2D(0, 0), 0, 0));
-	sorted_actors[1].push_back(std::static_pointer_cast<state::Actor>(flags[1]));
-
-	bases[0] = std::shared_ptr<state::Base>(new state::Base(4, state::PLAYER1, 0, 0, 0, 0, 10, 0, 0, 0,
-		physics::Vector2D(4 * ELEMENT_SIZE, 4 * ELEMENT_SIZE), physics::Vector2D(0, 0), 3, 0,
-		4 * ELEMENT_SIZE, 10));
-	sorted_actors[0].push_back(std::static_pointer_cast<state::Actor>(bases[0]));
-
-	bases[1] = std::shared_ptr<state::Base>(new state::Base(5, state::PLAYER2, 0, 0, 0, 0, 10, 0, 0, 0,
-		physics::Vector2D(27 * ELEMENT_SIZE, 27 * ELEMENT_SIZE), physics::Vector2D(0, 0), 3, 0,
-		4 * ELEMENT_SIZE, 10));
-	sorted_actors[1].push_back(std::static_pointer_cast<state::Actor>(bases[1]));
-
-	kings[0] = std::shared_ptr<state::King>(new state::King(2, state::PLAYER1, 0, 400, 400, 10, 10, 210,
-		0, 0, physics::Vector2D(4 * ELEMENT_SIZE, 4 * ELEMENT_SIZE), physics::Vector2D(0, 0), 1,
-		0));
-	kings[0]->AddPathPlanner(state::PathPlannerHelper(kings[0]));
-	sorted_actors[0].push_back(std::static_pointer_cast<state::Actor>(kings[0]));
-
-	kings[1] = std::shared_ptr<state::King>(new state::King(3, state::PLAYER2, 0, 400, 400, 10, 10, 210,
-		0, 0, physics::Vector2D(27 * ELEMENT_SIZE, 27 * ELEMENT_SIZE), physics::Vector2D(0, 0), 1,
-		0));
-	kings[1]->AddPathPlanner(state::PathPlannerHelper(kings[1]));
-	sorted_actors[1].push_back(std::static_pointer_cast<state::Actor>(kings[1]));
-
-	scouts[0][0] = std::shared_ptr<state::Scout>(new state::Scout(6, state::PLAYER1, 0, 300, 300, 37, 10,
-		90, 0, 0, physics::Vector2D(4 * ELEMENT_SIZE, 4 * ELEMENT_SIZE), physics::Vector2D(0, 0),
-		6, 0, 0));
-	scouts[0][0]->AddPathPlanner(state::PathPlannerHelper(scouts[0][0]));
-	sorted_actors[0].push_back(std::static_pointer_cast<state::Actor>(scouts[0][0]));
-
-	scouts[1][0] = std::shared_ptr<state::Scout>(new state::Scout(7, state::PLAYER2, 0, 300, 300, 37, 10,
-		90, 0, 0, physics::Vector2D(27 * ELEMENT_SIZE, 27 * ELEMENT_SIZE),
-		physics::Vector2D(0, 0), 6, 0, 0));
-	scouts[1][0]->AddPathPlanner(state::PathPlannerHelper(scouts[1][0]));
-	sorted_actors[1].push_back(std::static_pointer_cast<state::Actor>(scouts[1][0]));
-
-	std::vector<physics::Vector2D> tower_pos{ physics::Vector2D(11, 5), physics::Vector2D(22, 8),
-		physics::Vector2D(7, 13), physics::Vector2D(20, 26), physics::Vector2D(24, 18), physics::Vector2D(9, 23) };
-
-	state::act_id_t id_count = 7;
-	for (int64_t i = 0; i < 2; i++) {
-		for (int64_t j = 0; j < 3; j++) {
-			state::PlayerId p = static_cast<state::PlayerId>(i);
-			towers[i][j] = std::shared_ptr<state::Tower>(new state::Tower(++id_count, p, 80, 600,
-				600, 0, 10, 0, 0, 0, tower_pos[i * 3 + j] * ELEMENT_SIZE,
-				physics::Vector2D(0, 0), 5, 40, 5 * ELEMENT_SIZE, 100, 5 * ELEMENT_SIZE, 60, 300, 10));
-			sorted_actors[i].push_back(
-				std::static_pointer_cast<state::Actor>(towers[i][j]));
-		}
-	}
-
-	for (int64_t i = 0; i < 2; i++) {
-		for (int64_t j = 0; j < 20; j++) {
-			int team_pos = i == 0 ? 1 : 29;
-			state::PlayerId p = static_cast<state::PlayerId>(i);
-			swordsmen[i][j] = std::shared_ptr<state::Swordsman>(
-				new state::Swordsman(++id_count, p, 20, 200, 200, 20, 10, 45, 0, 0,
-					physics::Vector2D(team_pos * ELEMENT_SIZE, team_pos * ELEMENT_SIZE),
-					physics::Vector2D(0, 0), 2, 10, 30));
-			swordsmen[i][j]->AddPathPlanner(state::PathPlannerHelper(swordsmen[i][j]));
-			sorted_actors[i].push_back(
-				std::static_pointer_cast<state::Actor>(swordsmen[i][j]));
-		}
-	}
-
-	for (int64_t i = 0; i < 2; i++) {
-		for (int64_t j = 0; j < 10; j++) {
-			int team_pos = i == 0 ? 1 : 29;
-			state::PlayerId p = static_cast<state::PlayerId>(i);
-			magicians[i][j] = std::shared_ptr<state::Magician>(
-				new state::Magician(++id_count, p, 50, 150, 150, 30, 10, 60, 0, 0,
-					physics::Vector2D(team_pos * ELEMENT_SIZE, team_pos * ELEMENT_SIZE),
-					physics::Vector2D(0, 0), 3, 25, 3 * ELEMENT_SIZE, 60, 100, 10));
-			magicians[i][j]->AddPathPlanner(state::PathPlannerHelper(magicians[i][j]));
-			sorted_actors[i].push_back(
-				std::static_pointer_cast<state::Actor>(magicians[i][j]));
-		}
-	}
-
-	state::State S(terrain, sorted_actors, kings, bases, flags, towers, scouts,
-		magicians, swordsmen);
-
-	return S;
-}
-
 /**
  * Debugging method to print the terrain
  *
@@ -162,52 +50,284 @@ void PrintLos(state::Terrain terrain, state::PlayerId player_id)
 }
 
 /**
- * Method to load a terrain from a plaintext file
+ * Parses an option of the form --name=value or --name
  *
- * Elements are stored in one long line, and the terrain is assumed to
- * be a square
+ * Options recognised:
+ * - --think-budget=MICROSECONDS: Thread CPU time a player may use per update
+ * - --think-budget-policy=drop|penalise: What happens to a player over budget
+ * - --stats: Print per player CPU time statistics to stderr at the end
+ * - --affinity=none|pin|set: Pin each thread of the match to its own CPU,
+ *   or let them share a set of CPUs
+ * - --cpus=LIST: CPUs the match may use, like 0-3,8, shared by its
+ *   threads unless --affinity says otherwise. Needed to pin the threads
+ *   or keep them on a cache or node, so concurrent matches can be given
+ *   CPUs of their own
+ * - --keep-on=l3|numa: Keep the match on the L3 cache or NUMA node of
+ *   the first CPU it may use
+ * - --workers=N: Split the Actor updates of a tick between N threads,
+ *   0 for one per hardware thread
+ * - --matches=N: Run N headless matches at once, sharing a pool of threads
+ * - --threads=N: Size of the pool the matches share, 0 for one per
+ *   hardware thread
+ * - --lockstep: Wait for both players every tick and advance the game by
+ *   a fixed step, so the match plays out the same on any machine
+ * - --lockstep-timeout=MILLISECONDS: Longest a tick waits for the players
+ * - --seed=N: Seed for the AIs' random number generators
+ * - --delta-stream[=N]: Send the renderer a keyframe every N frames, 30
+ *   by default, and only the changes in between
+ * - --los-format=rows|packed|rle: How the LOS sent to the renderer is
+ *   encoded, renderers that predate the packed formats need rows
+ * - --async-output[=drop-oldest|block|coalesce]: Write to the renderer
+ *   on a thread of its own, and what to do when it falls behind
+ * - --output-queue=N: Most frames waiting to be written, 4 by default
+ * - --tick-rate=HZ: Ticks simulated per second of game time, 30 by
+ *   default
+ * - --output-rate=HZ: Frames sent to the renderer per second of game
+ *   time, one every tick by default
+ * - --speed=X: Seconds of game time simulated per second of real time
+ * - --replay=FILE: Record the match to FILE, with .N appended for the
+ *   Nth of several matches
+ * - --replay-keyframes=N: Frames per keyframe of the replay, 30 by
+ *   default
+ * - --shm-ring=NAME: Write frames to the renderer through the shared
+ *   memory ring NAME instead of stdout
+ * - --shm-ring-size=MEGABYTES: Size of the shared memory ring, 16 by
+ *   default
+ * - --log-limit=N: Logs each player may send per frame, 64 by default,
+ *   0 for no limit
+ * - --log-bytes=BYTES: Bytes of logs each player may send per frame,
+ *   8192 by default, 0 for no limit
+ * - --overload=on|off: Whether a match that can't keep up with its frame
+ *   rate is degraded gracefully, off by default
  *
- * Each element is one of:
- * - 'P': Plain
- * - 'M': Mountain
- * - 'F': Forest
+ * @param[in]  arg      The argument
+ * @param      options  The options to store the result in
  *
- * @param[in]  file_name  The file name
+ * @return     true if the option was recognised, false otherwise, or if
+ *             its value isn't a number it should be
+ */
+bool ParseOption(const std::string& arg, drivers::DriverOptions& options)
+{
+	auto separator = arg.find('=');
+	std::string name = arg.substr(0, separator);
+	std::string value = separator == std::string::npos ? "" : arg.substr(separator + 1);
+
+	// The numbers are converted before anything is stored, so a bad one
+	// leaves the options as they were
+	try {
+		if (name == "--think-budget") {
+			options.think_budget = std::stoll(value);
+		}
+		else if (name == "--think-budget-policy" && value == "drop") {
+			options.think_budget_policy = drivers::DROP_COMMANDS;
+		}
+		else if (name == "--think-budget-policy" && value == "penalise") {
+			options.think_budget_policy = drivers::PENALISE;
+		}
+		else if (name == "--stats") {
+			options.print_stats = true;
+		}
+		else if (name == "--affinity" && value == "none") {
+			options.affinity_policy = drivers::AFFINITY_NONE;
+		}
+		else if (name == "--affinity" && value == "pin") {
+			options.affinity_policy = drivers::AFFINITY_PIN;
+		}
+		else if (name == "--affinity" && value == "set") {
+			options.affinity_policy = drivers::AFFINITY_SET;
+		}
+		else if (name == "--cpus") {
+			options.cpus = drivers::ParseCpuList(value);
+		}
+		else if (name == "--workers") {
+			options.worker_threads = std::stoll(value);
+		}
+		else if (name == "--matches") {
+			options.match_count = std::stoll(value);
+		}
+		else if (name == "--threads") {
+			options.scheduler_threads = std::stoll(value);
+		}
+		else if (name == "--lockstep") {
+			options.lockstep = true;
+		}
+		else if (name == "--lockstep-timeout") {
+			options.lockstep_timeout = std::stoll(value);
+		}
+		else if (name == "--delta-stream") {
+			options.delta_keyframe_interval = value.empty() ? 30 : std::stoll(value);
+		}
+		else if (name == "--los-format" && value == "rows") {
+			options.los_format = ipc::LOS_ROWS;
+		}
+		else if (name == "--los-format" && value == "packed") {
+			options.los_format = ipc::LOS_PACKED;
+		}
+		else if (name == "--los-format" && value == "rle") {
+			options.los_format = ipc::LOS_RUN_LENGTH;
+		}
+		else if (name == "--async-output" && (value.empty() || value == "drop-oldest")) {
+			options.async_output = true;
+			options.output_queue_policy = ipc::DROP_OLDEST;
+		}
+		else if (name == "--async-output" && value == "block") {
+			options.async_output = true;
+			options.output_queue_policy = ipc::BLOCK;
+		}
+		else if (name == "--async-output" && value == "coalesce") {
+			options.async_output = true;
+			options.output_queue_policy = ipc::COALESCE;
+		}
+		else if (name == "--output-queue") {
+			options.output_queue_capacity = std::stoll(value);
+		}
+		else if (name == "--tick-rate") {
+			options.tick_rate = std::stoll(value);
+		}
+		else if (name == "--output-rate") {
+			options.output_rate = std::stoll(value);
+		}
+		else if (name == "--speed") {
+			options.speed = std::stod(value);
+		}
+		else if (name == "--replay" && !value.empty()) {
+			options.replay_file = value;
+		}
+		else if (name == "--replay-keyframes") {
+			options.replay_keyframe_interval = std::stoll(value);
+		}
+		else if (name == "--shm-ring" && !value.empty()) {
+			options.shm_ring_name = value[0] == '/' ? value : "/" + value;
+		}
+		else if (name == "--shm-ring-size") {
+			options.shm_ring_capacity = std::stoll(value) << 20;
+		}
+		else if (name == "--log-limit") {
+			options.log_records_per_frame = std::stoll(value);
+		}
+		else if (name == "--log-bytes") {
+			options.log_bytes_per_frame = std::stoll(value);
+		}
+		else if (name == "--overload" && value == "on") {
+			options.degrade_on_overload = true;
+		}
+		else if (name == "--overload" && value == "off") {
+			options.degrade_on_overload = false;
+		}
+		else if (name == "--seed") {
+			options.seed = std::stoul(value);
+		}
+		else if (name == "--keep-on" && value == "l3") {
+			options.placement_domain = drivers::DOMAIN_L3;
+		}
+		else if (name == "--keep-on" && value == "numa") {
+			options.placement_domain = drivers::DOMAIN_NUMA;
+		}
+		else {
+			return false;
+		}
+	}
+	catch (const std::invalid_argument&) {
+		return false;
+	}
+	catch (const std::out_of_range&) {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Makes the AI for a level
+ *
+ * @param[in]  level_number  The level number
  *
- * @return     The terrain
+ * @return     The AI
  */
-state::Terrain LoadTerrain(std::string file_name)
+player::PlayerAiHelper* MakeAi(int level_number)
 {
-	std::string line;
-	std::ifstream file(file_name);
-	std::getline(file, line);
-	int rows = (int)sqrt(line.size());
-	int total = line.size();
-	std::vector<std::vector<state::TerrainElement> > grid;
-	for (int i = 0; i < rows; i++) {
-		std::vector<state::TerrainElement> temp;
-		for (int j = 0; j < rows; j++) {
-			state::TERRAIN_TYPE t;
-			switch (line[i * rows + j]) {
-			case 'F':
-				t = state::FOREST;
-				break;
-			case 'M':
-				t = state::MOUNTAIN;
-				break;
-			default:
-				t = state::PLAIN;
-			}
-			temp.push_back(state::TerrainElement(
-				t, physics::Vector2D(i * ELEMENT_SIZE, j * ELEMENT_SIZE), ELEMENT_SIZE));
+	if (level_number == 1) {
+		return new ai1::Ai1();
+	}
+	return new ai::AI(level_number);
+}
+
+/**
+ * Runs several headless matches on the same terrain on a MatchScheduler,
+ * printing each one's scores
+ *
+ * @param[in]  terrain       The terrain
+ * @param[in]  level_number  The level number
+ * @param[in]  label         The label the scores are printed with
+ * @param[in]  options       The options
+ */
+void RunMatches(const state::Terrain& terrain, int level_number, const std::string& label,
+	const drivers::DriverOptions& options)
+{
+	drivers::MatchScheduler scheduler(options.scheduler_threads);
+	std::vector<std::shared_ptr<state::State> > states;
+
+	for (int64_t i = 0; i < options.match_count; i++) {
+		// Copies of a State share its Actors, so every match needs a
+		// State of its own
+		auto state = drivers::MakeState(terrain);
+		auto S = std::shared_ptr<state::State>(new state::State(state));
+		auto S1 = std::shared_ptr<state::State>(S->Clone());
+		auto S2 = std::shared_ptr<state::State>(S->Clone());
+
+		drivers::DriverOptions match_options = options;
+		if (!options.replay_file.empty()) {
+			match_options.replay_file += "." + std::to_string(i);
 		}
-		grid.push_back(temp);
+
+		scheduler.AddMatch(std::shared_ptr<drivers::MainDriver>(new drivers::MainDriver(
+			player::PlayerAi(std::shared_ptr<player::PlayerAiHelper>(new player1::Player1())),
+			player::PlayerAi(std::shared_ptr<player::PlayerAiHelper>(MakeAi(level_number))),
+			S, S1, S2, 5 * 60 * 1000, true, match_options)));
+		states.push_back(S);
+	}
+
+	scheduler.Run();
+
+	for (int64_t i = 0; i < options.match_count; i++) {
+		auto scores = states[i]->GetScores();
+		std::cout << label << '.' << i << ':' << scores[0] << ':' << scores[1] << std::endl;
 	}
-	return state::Terrain(grid);
 }
 
 int main(int argc, char * argv[])
 {
+	// Options may appear anywhere, everything else is positional
+	drivers::DriverOptions options;
+	std::vector<char *> args;
+	bool is_affinity_given = false;
+	for (int i = 0; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (i > 0 && arg.compare(0, 2, "--") == 0) {
+			if (!ParseOption(arg, options)) {
+				std::cerr << "Unknown option " << arg << std::endl;
+			}
+			is_affinity_given = is_affinity_given || arg.compare(0, 11, "--affinity=") == 0;
+		}
+		else {
+			args.push_back(argv[i]);
+		}
+	}
+	// Restricting the CPUs implies placing the threads, unless told how
+	if (!is_affinity_given
+		&& (!options.cpus.empty() || options.placement_domain != drivers::DOMAIN_ANY)) {
+		options.affinity_policy = drivers::AFFINITY_SET;
+	}
+	argv = args.data();
+
+	// convert INPUT OUTPUT turns a proto or plaintext terrain into a binary one
+	if (args.size() >= 4 && std::string(argv[1]) == "convert") {
+		if (!ipc::ConvertTerrain(argv[2], argv[3], drivers::ELEMENT_SIZE)) {
+			std::cerr << "Could not convert " << argv[2] << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
 	bool is_headless;
 	std::string exec_path(argv[0]);
 	exec_path = exec_path.substr(0, exec_path.size() - 4);
@@ -226,27 +346,31 @@ int main(int argc, char * argv[])
 	std::string terrain_file_path(argv[3]);
 
 	state::Terrain TT(ipc::LoadTerrain(terrain_file_path));
+	if (TT.GetRows() < drivers::MIN_TERRAIN_ROWS) {
+		std::cerr << "Could not load a terrain of at least " << drivers::MIN_TERRAIN_ROWS
+			<< " rows from " << terrain_file_path << std::endl;
+		return 1;
+	}
 
-	auto state = MakeState(TT);
+	auto state = drivers::MakeState(TT);
+
+	if (is_headless && options.match_count > 1) {
+		RunMatches(TT, level_number, argv[4], options);
+		return 0;
+	}
 
 	auto S = std::shared_ptr<state::State>(new state::State(state));
 
-	auto S1 = std::shared_ptr<state::State>(new state::State(state));
+	auto S1 = std::shared_ptr<state::State>(S->Clone());
 	state::PlayerStateHandler PSH1(S1.get(), state::PLAYER1);
 
-	auto S2 = std::shared_ptr<state::State>(new state::State(state));
+	auto S2 = std::shared_ptr<state::State>(S->Clone());
 	state::PlayerStateHandler PSH2(S2.get(), state::PLAYER2);
 
-	player::PlayerAiHelper* ai;
-	if (level_number == 1) {
-		ai = new ai1::Ai1();
-	}
-	else {
-		ai = new ai::AI(level_number);
-	}
+	player::PlayerAiHelper* ai = MakeAi(level_number);
 
 	drivers::MainDriver driver(player::PlayerAi(std::shared_ptr<player::PlayerAiHelper>(new player1::Player1())),
-		player::PlayerAi(std::shared_ptr<player::PlayerAiHelper>(ai)), S, S1, S2, 5 * 60 * 1000, is_headless);
+		player::PlayerAi(std::shared_ptr<player::PlayerAiHelper>(ai)), S, S1, S2, 5 * 60 * 1000, is_headless, options);
 
 	driver.Run();
 
@@ -26,6 +26,12 @@ public:
 	 * @param[in]  state  The Buffer State Handler used by the Player
 	 */
 	void Update(std::shared_ptr<state::PlayerStateHandler> state);
+	/**
+	 * Seeds the random number generator the Player AI draws from
+	 *
+	 * @param[in]  seed  The seed
+	 */
+	void Seed(unsigned int seed);
 };
 
 }
@@ -2,6 +2,7 @@
 #define PLAYER_PLAYER_AI_HELPER_H
 
 #include <memory>
+#include <random>
 
 #include "player_state_handler/player_state_handler.h"
 #include "player_export.h"
@@ -12,11 +13,27 @@ namespace player {
  * Class where player defines AI code
  */
 class PLAYER_EXPORT PlayerAiHelper {
+protected:
+	/**
+	 * Random number generator for the AI to draw from
+	 *
+	 * Each AI has its own, seeded by the match, so a seeded match plays
+	 * out the same every time whichever player's thread runs first
+	 */
+	std::mt19937 random_generator;
 public:
 	/**
 	 * Player AI update function (main logic of the AI)
 	 */
 	virtual void Update(std::shared_ptr<state::PlayerStateHandler> state) = 0;
+	/**
+	 * Seeds the AI's random number generator
+	 *
+	 * @param[in]  seed  The seed
+	 */
+	void Seed(unsigned int seed) {
+		random_generator.seed(seed);
+	}
 };
 
 }
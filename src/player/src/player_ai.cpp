@@ -12,6 +12,10 @@ void PlayerAi::Update(std::shared_ptr<state::PlayerStateHandler> state) {
 	helper->Update(state);
 }
 
+void PlayerAi::Seed(unsigned int seed) {
+	helper->Seed(seed);
+}
+
 }
 
 #endif
@@ -6,6 +6,7 @@
 #ifndef STATE_ACTOR_ACTOR_H
 #define STATE_ACTOR_ACTOR_H
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include "actor/actor.fwd.h"
@@ -135,6 +136,21 @@ protected:
 	 * If true, actor is dead, false otherwise
 	 */
 	bool is_dead;
+	/**
+	 * Damage dealt to this Actor during the current tick, applied in
+	 * Commit
+	 *
+	 * Atomic since attackers may be updated concurrently
+	 */
+	std::atomic<int64_t> queued_damage;
+	/**
+	 * If true, the Actor dies in Commit
+	 */
+	bool is_death_pending;
+	/**
+	 * If true, the Actor respawns in Commit
+	 */
+	bool is_respawn_pending;
 	/**
 	 * A player sets this for a dead Actor to signal that he's ready to
 	 * respawn it, assuming time_to_respawn is 0
@@ -183,10 +199,27 @@ public:
 	/**
 	 * Update function to be called every tick
 	 *
+	 * Decides what the Actor does this tick. Updates of different
+	 * Actors may run concurrently, so this must only change the Actor
+	 * itself, and changes other Actors can see must wait for Commit
+	 *
 	 * @param[in]  delta_time  The difference in time between the
 	 *                         previous and current Update calls
 	 */
 	virtual void Update(float delta_time) = 0;
+	/**
+	 * Applies what was decided in this tick's Update calls
+	 *
+	 * Called for every Actor in order of ID after all Updates are done
+	 *
+	 * Default behaviour:
+	 * Applies the damage queued on the Actor
+	 * Makes the Actor die or respawn if requested
+	 *
+	 * @param[in]  delta_time  The difference in time between the
+	 *                         previous and current Update calls
+	 */
+	virtual void Commit(float delta_time);
 	/**
 	 * Gets the Actor ID
 	 *
@@ -397,6 +430,34 @@ public:
 	 * @param[in]  damage_amount  The damage amount
 	 */
 	void Damage(int64_t damage_amount);
+	/**
+	 * Deals damage to the Actor at the next Commit
+	 *
+	 * Safe to call from concurrent Updates of other Actors
+	 *
+	 * @param[in]  damage_amount  The damage amount
+	 */
+	void QueueDamage(int64_t damage_amount);
+	/**
+	 * Makes the Actor die at the next Commit
+	 */
+	void RequestDeath();
+	/**
+	 * Checks if the Actor dies at the next Commit
+	 *
+	 * @return     true if death is pending, false otherwise
+	 */
+	bool IsDeathPending();
+	/**
+	 * Makes the Actor respawn at the next Commit
+	 */
+	void RequestRespawn();
+	/**
+	 * Checks if the Actor respawns at the next Commit
+	 *
+	 * @return     true if respawn is pending, false otherwise
+	 */
+	bool IsRespawnPending();
 	/**
 	 * Gets the Actor's respawn location
 	 *
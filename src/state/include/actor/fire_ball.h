@@ -58,7 +58,7 @@ public:
 	 * The fire_ball's attack function
 	 *
 	 * Sets the is_done bool to true
-	 * Inflicts damage on attack_target
+	 * Queues damage on attack_target
 	 */
 	void Attack() override;
 	/**
@@ -71,6 +71,15 @@ public:
 	 *                         previous and current Update calls
 	 */
 	void Update(float delta_time) override;
+	/**
+	 * Applies what was decided in this tick's Update calls
+	 *
+	 * Moves the Flag to its King if captured
+	 *
+	 * @param[in]  delta_time  The difference in time between the
+	 *                         previous and current Update calls
+	 */
+	void Commit(float delta_time) override;
 	/**
 	 * Merges this, a Flag in the main state, with the corresponding
 	 * Flag in a player's state
@@ -66,6 +66,16 @@ public:
 	 *                         previous and current Update calls
 	 */
 	void Update(float delta_time) override;
+	/**
+	 * Applies what was decided in this tick's Update calls
+	 *
+	 * After the default Actor behaviour, drops the flag if the King
+	 * died and moves the King
+	 *
+	 * @param[in]  delta_time  The difference in time between the
+	 *                         previous and current Update calls
+	 */
+	void Commit(float delta_time) override;
 	/**
 	 * Merges this, a King in the main state, with the corresponding
 	 * King in a player's state
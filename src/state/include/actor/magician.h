@@ -101,6 +101,15 @@ public:
 	 * Update function to be called every tick
 	 */
 	void Update(float delta_time) override;
+	/**
+	 * Applies what was decided in this tick's Update calls
+	 *
+	 * Moves the Magician after the default Actor behaviour
+	 *
+	 * @param[in]  delta_time  The difference in time between the
+	 *                         previous and current Update calls
+	 */
+	void Commit(float delta_time) override;
 };
 
 }
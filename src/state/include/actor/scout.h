@@ -43,6 +43,15 @@ public:
 	 *                         previous and current Update calls
 	 */
 	void Update(float delta_time) override;
+	/**
+	 * Applies what was decided in this tick's Update calls
+	 *
+	 * Moves the Scout after the default Actor behaviour
+	 *
+	 * @param[in]  delta_time  The difference in time between the
+	 *                         previous and current Update calls
+	 */
+	void Commit(float delta_time) override;
 };
 
 }
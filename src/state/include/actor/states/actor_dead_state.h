@@ -23,7 +23,8 @@ public:
 	/**
 	 * Called right after the Actor switches to this state
 	 * 
-	 * Calls Actor's Die method
+	 * Requests the Actor's death, which happens when the tick is
+	 * committed
 	 *
 	 * @param      actor  The Actor
 	 */
@@ -32,8 +33,9 @@ public:
 	 * Called every tick by the Actor
 	 *
 	 * If the Actor's time_to_respawn is 0 and its respawn_location has
-	 * been set, i.e., it isn't (-1, -1), returns ActorIdleState.
-	 * Else returns nullptr.
+	 * been set, i.e., it isn't (-1, -1), requests a respawn. Once the
+	 * respawn is committed, or for towers, once they're captured,
+	 * returns ActorIdleState. Else returns nullptr.
 	 *
 	 * Decreases time_to_respawn each tick
 	 *
@@ -52,8 +54,6 @@ public:
 	/**
 	 * Called right before the Actor switches to another state
 	 *
-	 * Calls Actor's Respawn method
-	 *
 	 * @param      actor  The Actor
 	 */
 	virtual void Exit(Actor * actor) override;
@@ -0,0 +1,144 @@
+/**
+ * @file influence_map.h
+ * Definitions for the per player grids of unit strength over the map
+ */
+
+#ifndef STATE_INFLUENCE_INFLUENCE_MAP_H
+#define STATE_INFLUENCE_INFLUENCE_MAP_H
+
+#include <cstdint>
+#include <vector>
+#include "state_export.h"
+#include "utilities.h"
+
+namespace state {
+
+/**
+ * What an InfluenceMap adds up, as seen by one player
+ */
+enum INFLUENCE_TYPE {
+	/**
+	 * HP of the player's living units
+	 */
+	ALLY_HP,
+	/**
+	 * HP of the enemy units the player can see
+	 */
+	ENEMY_HP,
+	/**
+	 * Attack damage per second of the enemy units the player can see
+	 */
+	ENEMY_DPS,
+	LAST_INFLUENCE_TYPE = ENEMY_DPS,
+};
+
+/**
+ * What one Actor adds to an InfluenceMap
+ */
+struct InfluenceEntry {
+	/**
+	 * The cell the value is added to, as row * rows + column, -1 if none
+	 */
+	int64_t cell;
+	/**
+	 * The value added
+	 */
+	int64_t value;
+};
+
+/**
+ * A value for each terrain element, the sum of what each Actor in it adds
+ *
+ * Each Actor's part is remembered, so setting it again only changes the
+ * cells it left and entered. A 2D Fenwick tree over the cells is kept
+ * alongside them, so sums over boxes of cells don't go over every cell
+ */
+class STATE_EXPORT InfluenceMap {
+private:
+	/**
+	 * No of cells per row in the square grid
+	 */
+	int64_t rows;
+	/**
+	 * The value of each cell, as row * rows + column
+	 */
+	std::vector<int64_t> cells;
+	/**
+	 * Fenwick tree over cells, indexed from 1 in both directions
+	 */
+	std::vector<int64_t> tree;
+	/**
+	 * What each Actor adds, indexed by Actor ID
+	 */
+	std::vector<InfluenceEntry> entries;
+	/**
+	 * Adds to a cell and the parts of the tree covering it
+	 *
+	 * @param[in]  cell   The cell, as row * rows + column
+	 * @param[in]  delta  Amount to add
+	 */
+	void AddToCell(int64_t cell, int64_t delta);
+	/**
+	 * Sums the cells with row below row_end and column below column_end
+	 *
+	 * @param[in]  row_end     The row after the last row
+	 * @param[in]  column_end  The column after the last column
+	 *
+	 * @return     The sum
+	 */
+	int64_t GetPrefixSum(int64_t row_end, int64_t column_end) const;
+public:
+	InfluenceMap();
+	/**
+	 * Constructor for an InfluenceMap with every cell 0
+	 *
+	 * @param[in]  rows  No of cells per row
+	 */
+	explicit InfluenceMap(int64_t rows);
+	/**
+	 * Sets what an Actor adds, in place of what it added before
+	 *
+	 * @param[in]  actor_id  The Actor's ID
+	 * @param[in]  cell      The cell, as row * rows + column, -1 if none
+	 * @param[in]  value     The value
+	 */
+	void Set(act_id_t actor_id, int64_t cell, int64_t value);
+	/**
+	 * Gets the value of a cell
+	 *
+	 * @param[in]  row     The row
+	 * @param[in]  column  The column
+	 *
+	 * @return     The value, 0 if the cell is off the grid
+	 */
+	int64_t GetCell(int64_t row, int64_t column) const;
+	/**
+	 * Sums the cells in a box, clipped to the grid
+	 *
+	 * @param[in]  first_row     The first row
+	 * @param[in]  first_column  The first column
+	 * @param[in]  last_row      The last row
+	 * @param[in]  last_column   The last column
+	 *
+	 * @return     The sum
+	 */
+	int64_t GetSum(
+		int64_t first_row,
+		int64_t first_column,
+		int64_t last_row,
+		int64_t last_column
+	) const;
+	/**
+	 * Merges this, a player state's InfluenceMap, with the main state's
+	 *
+	 * Each Actor's part is set to what it is in the main state's map, so
+	 * only the cells that differ are touched
+	 *
+	 * @param[in]  influence_map  The main state's InfluenceMap
+	 */
+	void MergeWithMain(const InfluenceMap& influence_map);
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file task_pool.h
+ * Defines the TaskPool class
+ */
+
+#ifndef STATE_PARALLEL_TASK_POOL_H
+#define STATE_PARALLEL_TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "state_export.h"
+
+namespace state {
+
+/**
+ * A fixed set of threads running independent tasks, with work stealing
+ *
+ * Every thread has its own queue. Tasks submitted by a pool thread go to
+ * the end of that thread's queue, other tasks are spread over the queues
+ * in turn. A thread runs the tasks of its queue in order, and when it
+ * runs out, steals from the far end of the other queues
+ */
+class STATE_EXPORT TaskPool {
+public:
+	/**
+	 * A unit of work
+	 */
+	typedef std::function<void()> Task;
+private:
+	/**
+	 * The queue of tasks owned by one thread
+	 */
+	struct TaskQueue {
+		/**
+		 * Guards tasks
+		 */
+		std::mutex mutex;
+		/**
+		 * Tasks waiting to run
+		 */
+		std::deque<Task> tasks;
+	};
+	/**
+	 * One queue per thread
+	 */
+	std::vector<std::unique_ptr<TaskQueue> > queues;
+	/**
+	 * The pool's threads
+	 */
+	std::vector<std::thread> workers;
+	/**
+	 * Guards sleeping and is_stopped
+	 */
+	std::mutex sleep_mutex;
+	/**
+	 * Signalled when a task is submitted or the pool is stopped
+	 */
+	std::condition_variable sleep_cv;
+	/**
+	 * Number of tasks in all the queues
+	 */
+	std::atomic<int64_t> queued_tasks;
+	/**
+	 * Queue the next task submitted from outside the pool goes to
+	 */
+	std::atomic<int64_t> next_queue;
+	/**
+	 * True once the pool is being destroyed
+	 */
+	bool is_stopped;
+	/**
+	 * Takes a task from a thread's own queue, or steals one
+	 *
+	 * @param[in]  worker  Index of the thread
+	 * @param      task    The task taken
+	 *
+	 * @return     true if a task was taken, false if all queues are empty
+	 */
+	bool TakeTask(int64_t worker, Task& task);
+	/**
+	 * Runs tasks until the pool is stopped and no tasks are left
+	 *
+	 * @param[in]  worker  Index of the thread
+	 */
+	void WorkerLoop(int64_t worker);
+public:
+	/**
+	 * Constructor for TaskPool
+	 *
+	 * @param[in]  thread_count  Number of threads, 0 uses one thread
+	 *                           per hardware thread
+	 */
+	TaskPool(int64_t thread_count);
+	/**
+	 * Runs all remaining tasks, then stops the threads
+	 */
+	~TaskPool();
+	TaskPool(const TaskPool&) = delete;
+	TaskPool& operator=(const TaskPool&) = delete;
+	/**
+	 * Gets the number of threads
+	 *
+	 * @return     The thread count
+	 */
+	int64_t GetThreadCount();
+	/**
+	 * Queues a task to be run on one of the pool's threads
+	 *
+	 * May be called from any thread, including from inside a task
+	 *
+	 * @param[in]  task  The task
+	 */
+	void Submit(Task task);
+};
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file worker_pool.h
+ * Defines the WorkerPool class
+ */
+
+#ifndef STATE_PARALLEL_WORKER_POOL_H
+#define STATE_PARALLEL_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "state_export.h"
+
+namespace state {
+
+/**
+ * A fixed set of threads that split loops over index ranges between them
+ */
+class STATE_EXPORT WorkerPool {
+public:
+	/**
+	 * Function run on a range of indices, from begin up to but not
+	 * including end
+	 */
+	typedef std::function<void(int64_t begin, int64_t end)> RangeFunction;
+private:
+	/**
+	 * The pool's threads, not counting the thread calling ParallelFor
+	 */
+	std::vector<std::thread> workers;
+	/**
+	 * Serialises calls to ParallelFor
+	 */
+	std::mutex call_mutex;
+	/**
+	 * Guards the fields below that the workers wait on
+	 */
+	std::mutex job_mutex;
+	/**
+	 * Signalled when a new job is posted or the pool is stopped
+	 */
+	std::condition_variable job_cv;
+	/**
+	 * Signalled when the last worker finishes its share of a job
+	 */
+	std::condition_variable done_cv;
+	/**
+	 * The function of the current job
+	 */
+	const RangeFunction * job;
+	/**
+	 * Number of indices in the current job
+	 */
+	int64_t job_size;
+	/**
+	 * Number of indices handed out at a time
+	 */
+	int64_t chunk_size;
+	/**
+	 * First index of the current job not yet handed out
+	 */
+	std::atomic<int64_t> next_index;
+	/**
+	 * Incremented for every job, so workers can tell a new job apart
+	 * from a spurious wakeup
+	 */
+	int64_t job_generation;
+	/**
+	 * Number of workers still working on the current job
+	 */
+	int64_t busy_workers;
+	/**
+	 * True once the pool is being destroyed
+	 */
+	bool is_stopped;
+	/**
+	 * Runs chunks of the current job until none are left
+	 */
+	void RunChunks();
+	/**
+	 * Waits for jobs and works on them until the pool is stopped
+	 */
+	void WorkerLoop();
+public:
+	/**
+	 * Constructor for WorkerPool
+	 *
+	 * @param[in]  thread_count  Number of threads that work on each job,
+	 *                           including the thread calling ParallelFor.
+	 *                           0 uses one thread per hardware thread
+	 */
+	WorkerPool(int64_t thread_count);
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	/**
+	 * Gets the number of threads that work on each job
+	 *
+	 * @return     The thread count, including the calling thread
+	 */
+	int64_t GetThreadCount();
+	/**
+	 * Splits [0, count) into chunks and runs function on them in parallel
+	 *
+	 * The calling thread works on chunks too and returns only after all
+	 * of them are done. Chunks may run in any order, so function must
+	 * not depend on it
+	 *
+	 * @param[in]  count     The number of indices
+	 * @param[in]  function  The function run on every chunk
+	 */
+	void ParallelFor(int64_t count, const RangeFunction& function);
+};
+
+/**
+ * Runs function on [0, count) using a worker pool if there is one
+ *
+ * @param      worker_pool  The worker pool, if nullptr function is run
+ *                          on the whole range on the calling thread
+ * @param[in]  count        The number of indices
+ * @param[in]  function     The function run on every chunk
+ */
+STATE_EXPORT void ParallelFor(
+	WorkerPool * worker_pool,
+	int64_t count,
+	const WorkerPool::RangeFunction& function
+);
+
+}
+
+#endif
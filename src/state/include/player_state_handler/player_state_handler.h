@@ -11,9 +11,14 @@
 
 #include <memory>
 #include <cstdint>
+#include <cfloat>
+#include <vector>
 #include "vector2d.h"
 #include "actor/actor.h"
 #include "state.h"
+#include "player_state_handler/spatial_index.h"
+#include "player_state_handler/unit_snapshot.h"
+#include "player_state_handler/view_range.h"
 #include "player_state_handler/unit_views.h"
 #include "terrain/terrain_element.h"
 #include "state_export.h"
@@ -55,6 +60,17 @@ private:
 	 * The player ID to whom the handler belongs.
 	 */
 	PlayerId player_id;
+	/**
+	 * The player's living units and the enemy units it can see, rebuilt
+	 * whenever the state's version changes
+	 */
+	SpatialIndex spatial_index;
+	/**
+	 * Gets the spatial index, rebuilding it if the state has changed
+	 *
+	 * @return     The spatial index
+	 */
+	const SpatialIndex& GetSpatialIndex();
 public:
 	/**
 	 * The constructor.
@@ -78,9 +94,10 @@ public:
 	 * @param[in]  player_id  ID of the player whose enemies are to be
 	 *                        returned
 	 *
-	 * @return     List of required Actor IDs.
+	 * @return     List of required Actor IDs, valid until the state next
+	 *             changes
 	 */
-	list_act_id_t GetPlayerEnemyIds();
+	const list_act_id_t& GetPlayerEnemyIds();
 	/**
 	 * Gets the player's Magicians
 	 *
@@ -129,6 +146,66 @@ public:
 	 * @return     The enemy's towers
 	 */
 	std::vector<EnemyTowerView> GetEnemyTowers();
+	/**
+	 * Gets the player's Magicians without copying them out of the state
+	 *
+	 * @return     Range over the player's Magicians, valid until the state
+	 *             next changes
+	 */
+	MagicianRange GetMagicianRange();
+	/**
+	 * Gets the enemy's Magicians that GetEnemyMagicians would, without copying
+	 * them out of the state
+	 *
+	 * @return     Range over the enemy's Magicians, valid until the state
+	 *             next changes
+	 */
+	EnemyMagicianRange GetEnemyMagicianRange();
+	/**
+	 * Gets the player's Scouts without copying them out of the state
+	 *
+	 * @return     Range over the player's Scouts, valid until the state
+	 *             next changes
+	 */
+	ScoutRange GetScoutRange();
+	/**
+	 * Gets the enemy's Scouts that GetEnemyScouts would, without copying
+	 * them out of the state
+	 *
+	 * @return     Range over the enemy's Scouts, valid until the state
+	 *             next changes
+	 */
+	EnemyScoutRange GetEnemyScoutRange();
+	/**
+	 * Gets the player's Swordsmen without copying them out of the state
+	 *
+	 * @return     Range over the player's Swordsmen, valid until the state
+	 *             next changes
+	 */
+	SwordsmanRange GetSwordsmanRange();
+	/**
+	 * Gets the enemy's Swordsmen that GetEnemySwordsmen would, without copying
+	 * them out of the state
+	 *
+	 * @return     Range over the enemy's Swordsmen, valid until the state
+	 *             next changes
+	 */
+	EnemySwordsmanRange GetEnemySwordsmanRange();
+	/**
+	 * Gets the player's Towers without copying them out of the state
+	 *
+	 * @return     Range over the player's Towers, valid until the state
+	 *             next changes
+	 */
+	TowerRange GetTowerRange();
+	/**
+	 * Gets the enemy's Towers that GetEnemyTowers would, without copying
+	 * them out of the state
+	 *
+	 * @return     Range over the enemy's Towers, valid until the state
+	 *             next changes
+	 */
+	EnemyTowerRange GetEnemyTowerRange();
 	/**
 	 * Gets player's King
 	 *
@@ -220,6 +297,75 @@ public:
 	 * @return     The number of rows
 	 */
 	int64_t GetTerrainRows();
+	/**
+	 * Copies the whole terrain, as the player sees it, into flat arrays
+	 *
+	 * The TerrainElement OffsetToTerrainElement gives for offset (x, y)
+	 * is at x * GetTerrainRows() + y, so each array must have room for
+	 * GetTerrainRows() squared elements
+	 *
+	 * @param      terrain_types  Filled with the TERRAIN_TYPE of each
+	 *                            element, UNDEFINED if it's unexplored,
+	 *                            or NULL to skip
+	 * @param      los_types      Filled with the LOS_TYPE of each
+	 *                            element, or NULL to skip
+	 *
+	 * @return     The LOS version the arrays are at, for
+	 *             GetChangedTerrainElements
+	 */
+	int64_t GetTerrainGrid(uint8_t * terrain_types, uint8_t * los_types);
+	/**
+	 * Gets the TerrainElements whose LOS, and so maybe terrain type as
+	 * the player sees it, changed since an earlier call
+	 *
+	 * Patching the arrays from GetTerrainGrid with these keeps them up
+	 * to date without copying the whole terrain again
+	 *
+	 * @param[in]  since    LOS version returned by an earlier call to
+	 *                      this or GetTerrainGrid
+	 * @param      changed  Filled with the elements, as
+	 *                      x * GetTerrainRows() + y, in increasing order
+	 *
+	 * @return     The current LOS version
+	 */
+	int64_t GetChangedTerrainElements(
+		int64_t since,
+		std::vector<int64_t>& changed
+	);
+	/**
+	 * Gets the influence of a type on a TerrainElement, the sum over
+	 * the units standing on it
+	 *
+	 * Enemy influence only counts enemy units the player can see
+	 *
+	 * @param[in]  influence_type  The type
+	 * @param[in]  offset          The TerrainElement's offsets,
+	 *                             offset.x = row_no, offset.y = col_no
+	 *
+	 * @return     The influence, 0 if the offset is out of bounds
+	 */
+	int64_t GetInfluence(
+		INFLUENCE_TYPE influence_type,
+		physics::Vector2D offset
+	);
+	/**
+	 * Gets the influence of a type on the TerrainElements overlapping a
+	 * square centred on a position, summed
+	 *
+	 * Takes time logarithmic in the number of terrain rows, whatever the
+	 * size of the square or the number of units
+	 *
+	 * @param[in]  influence_type  The type
+	 * @param[in]  position        Centre of the square
+	 * @param[in]  distance        Half the side of the square
+	 *
+	 * @return     The influence
+	 */
+	int64_t GetInfluenceNear(
+		INFLUENCE_TYPE influence_type,
+		physics::Vector2D position,
+		double distance
+	);
 	/**
 	 * Gets the actor from it's id
 	 *
@@ -257,6 +403,71 @@ public:
 	 *             Else, returns an empty EnemyUnitView
 	 */
 	EnemyUnitView GetEnemyUnitFromId(act_id_t actor_id, int * success);
+	/**
+	 * Fills a snapshot with all of the player's units and the enemy units
+	 * it can see
+	 *
+	 * Shows the same as GetUnitFromId and GetEnemyUnitFromId would for
+	 * each unit, without making a view per unit
+	 *
+	 * @param      snapshot  The snapshot, emptied first
+	 */
+	void GetUnitSnapshot(UnitSnapshot * snapshot);
+	/**
+	 * Gets the living units within a distance of a point
+	 *
+	 * Only enemy units the player can see are found
+	 *
+	 * @param[in]  center  The point
+	 * @param[in]  radius  The distance
+	 * @param[in]  filter  Whether to find the player's units, the
+	 *                     enemy's or both
+	 *
+	 * @return     The units' IDs, in no particular order
+	 */
+	list_act_id_t QueryUnitsInRadius(
+		physics::Vector2D center,
+		double radius,
+		UNIT_FILTER filter = ENEMY_UNITS
+	);
+	/**
+	 * Gets the k living units nearest to a point
+	 *
+	 * Only enemy units the player can see are found
+	 *
+	 * @param[in]  center        The point
+	 * @param[in]  k             Most units to return
+	 * @param[in]  filter        Whether to find the player's units, the
+	 *                           enemy's or both
+	 * @param[in]  types         Types of unit to find, all if empty
+	 * @param[in]  max_distance  Furthest from the point a unit may be
+	 *
+	 * @return     The units' IDs, nearest first
+	 */
+	list_act_id_t QueryKNearest(
+		physics::Vector2D center,
+		int64_t k,
+		UNIT_FILTER filter = ENEMY_UNITS,
+		std::vector<ActorType> types = std::vector<ActorType>(),
+		double max_distance = DBL_MAX
+	);
+	/**
+	 * Gets the living units inside an axis aligned box, edges included
+	 *
+	 * Only enemy units the player can see are found
+	 *
+	 * @param[in]  min_corner  Corner with the smallest coordinates
+	 * @param[in]  max_corner  Corner with the largest coordinates
+	 * @param[in]  filter      Whether to find the player's units, the
+	 *                         enemy's or both
+	 *
+	 * @return     The units' IDs, in no particular order
+	 */
+	list_act_id_t QueryBox(
+		physics::Vector2D min_corner,
+		physics::Vector2D max_corner,
+		UNIT_FILTER filter = ENEMY_UNITS
+	);
 	/**
 	 * Gets the player's score
 	 *
@@ -0,0 +1,172 @@
+/**
+ * @file spatial_index.h
+ *
+ * Definitions for the grid of units that spatial queries are answered from
+ */
+
+#ifndef STATE_PLAYER_STATE_HANDLER_SPATIAL_INDEX_H
+#define STATE_PLAYER_STATE_HANDLER_SPATIAL_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "actor/actor.h"
+#include "vector2d.h"
+#include "state_export.h"
+#include "utilities.h"
+
+namespace state {
+
+/**
+ * Number of terrain elements along each side of a cell of the index
+ */
+const int64_t SPATIAL_INDEX_CELL_ELEMENTS = 2;
+
+/**
+ * Which units a spatial query looks at
+ */
+enum UNIT_FILTER {
+	/**
+	 * Only the player's own units
+	 */
+	OWN_UNITS,
+	/**
+	 * Only the enemy units the player can see
+	 */
+	ENEMY_UNITS,
+	/**
+	 * Both
+	 */
+	ALL_UNITS
+};
+
+/**
+ * A unit in the index
+ */
+struct SpatialEntry {
+	act_id_t id;
+	ActorType actor_type;
+	bool is_enemy;
+	double x;
+	double y;
+};
+
+/**
+ * Uniform grid over the map, holding the units in each cell
+ *
+ * Units are bucketed by cell into one array, so a query only looks at the
+ * units in the cells it overlaps
+ */
+class STATE_EXPORT SpatialIndex {
+private:
+	/**
+	 * Length of a side of a cell
+	 */
+	double cell_size;
+	/**
+	 * Number of cells along each side of the grid
+	 */
+	int64_t columns;
+	/**
+	 * Version of the state the index was built at, -1 if never
+	 */
+	int64_t version;
+	/**
+	 * Units added since the last Build
+	 */
+	std::vector<SpatialEntry> pending;
+	/**
+	 * The units, ordered by cell
+	 */
+	std::vector<SpatialEntry> entries;
+	/**
+	 * Index into entries of the first unit of each cell, with one more
+	 * for the end of the last cell
+	 */
+	std::vector<int64_t> cell_starts;
+	/**
+	 * Gets the column or row of the cell a coordinate is in
+	 *
+	 * @param[in]  coordinate  The coordinate
+	 *
+	 * @return     The column or row, clamped to the grid
+	 */
+	int64_t CellOf(double coordinate) const;
+	/**
+	 * Checks if a unit passes a filter
+	 *
+	 * @param[in]  entry   The unit
+	 * @param[in]  filter  The filter
+	 *
+	 * @return     true if it does, false otherwise
+	 */
+	static bool Matches(const SpatialEntry& entry, UNIT_FILTER filter);
+public:
+	SpatialIndex();
+	/**
+	 * Removes all units, keeping the memory
+	 */
+	void Clear();
+	/**
+	 * Adds a unit, which is only queried after the next Build
+	 *
+	 * @param[in]  entry  The unit
+	 */
+	void Add(const SpatialEntry& entry);
+	/**
+	 * Buckets the units added since Clear into the grid
+	 *
+	 * @param[in]  map_size   Length of a side of the map
+	 * @param[in]  cell_size  Length of a side of a cell
+	 * @param[in]  version    Version of the state the units came from
+	 */
+	void Build(double map_size, double cell_size, int64_t version);
+	/**
+	 * Gets the version of the state the index was built at
+	 *
+	 * @return     The version, -1 if never built
+	 */
+	int64_t GetVersion() const;
+	/**
+	 * Finds the units within a distance of a point
+	 *
+	 * @param[in]  center  The point
+	 * @param[in]  radius  The distance
+	 * @param[in]  filter  Which units to look at
+	 * @param      result  Filled with the units' IDs, in no particular
+	 *                     order
+	 */
+	void QueryRadius(physics::Vector2D center, double radius,
+		UNIT_FILTER filter, list_act_id_t& result) const;
+	/**
+	 * Finds the units inside an axis aligned box, edges included
+	 *
+	 * @param[in]  min_corner  Corner with the smallest coordinates
+	 * @param[in]  max_corner  Corner with the largest coordinates
+	 * @param[in]  filter      Which units to look at
+	 * @param      result      Filled with the units' IDs, in no particular
+	 *                         order
+	 */
+	void QueryBox(physics::Vector2D min_corner, physics::Vector2D max_corner,
+		UNIT_FILTER filter, list_act_id_t& result) const;
+	/**
+	 * Finds the k units nearest to a point
+	 *
+	 * Looks at rings of cells further and further out, and stops once no
+	 * unlooked at cell can hold a nearer unit
+	 *
+	 * @param[in]  center        The point
+	 * @param[in]  k             Most units to find
+	 * @param[in]  filter        Which units to look at
+	 * @param[in]  types         Types of unit to look at, all if empty
+	 * @param[in]  max_distance  Furthest a unit may be
+	 * @param      result        Filled with the units' IDs, nearest first,
+	 *                           ties broken by ID
+	 */
+	void QueryKNearest(physics::Vector2D center, int64_t k, UNIT_FILTER filter,
+		const std::vector<ActorType>& types, double max_distance,
+		list_act_id_t& result) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file unit_snapshot.h
+ *
+ * Definitions for the columnar snapshot of units for players
+ */
+
+#ifndef STATE_PLAYER_STATE_HANDLER_UNIT_SNAPSHOT_H
+#define STATE_PLAYER_STATE_HANDLER_UNIT_SNAPSHOT_H
+
+#include <cstdint>
+#include <vector>
+#include "actor/actor.h"
+#include "state_export.h"
+#include "utilities.h"
+
+namespace state {
+
+/**
+ * Bits of UnitSnapshot::flags
+ */
+enum UNIT_FLAG {
+	/**
+	 * The unit is the enemy's
+	 */
+	UNIT_IS_ENEMY = 1 << 0,
+	/**
+	 * The unit can attack
+	 */
+	UNIT_CAN_ATTACK = 1 << 1,
+	/**
+	 * The unit can path plan
+	 */
+	UNIT_CAN_PATH_PLAN = 1 << 2,
+	/**
+	 * The unit is under attack, only known for the player's own units
+	 */
+	UNIT_UNDER_ATTACK = 1 << 3,
+	/**
+	 * The unit is path planning, only known for the player's own units
+	 */
+	UNIT_PATH_PLANNING = 1 << 4,
+	/**
+	 * The unit is dead, only the player's own units can be
+	 */
+	UNIT_DEAD = 1 << 5,
+	/**
+	 * The unit is a king carrying a flag
+	 */
+	UNIT_HAS_FLAG = 1 << 6
+};
+
+/**
+ * The player's units and the enemy units it can see, one array per field
+ *
+ * Row i of every array is the same unit. The player's own units come
+ * first, then the visible enemies, so that an AI can go over either with
+ * a linear pass instead of building a view per unit
+ *
+ * Owned by the caller and filled in by PlayerStateHandler::GetUnitSnapshot.
+ * Filling it again reuses the arrays, so a snapshot kept between updates
+ * doesn't allocate
+ *
+ * Fields an EnemyUnitView doesn't show are 0, or -1 for IDs, for enemies
+ */
+struct STATE_EXPORT UnitSnapshot {
+	/**
+	 * Number of the player's own units, which are rows [0, own_count)
+	 */
+	int64_t own_count;
+	/**
+	 * Version of the state the snapshot was taken at
+	 *
+	 * @see State::GetVersion
+	 */
+	int64_t version;
+
+	std::vector<act_id_t> ids;
+	std::vector<ActorType> actor_types;
+	std::vector<double> position_x;
+	std::vector<double> position_y;
+	std::vector<double> velocity_x;
+	std::vector<double> velocity_y;
+	std::vector<int64_t> hp;
+	std::vector<int64_t> max_hp;
+	std::vector<int64_t> size;
+	std::vector<int64_t> attack_range;
+	/**
+	 * ID of the enemy the unit is attacking, -1 if none
+	 */
+	std::vector<act_id_t> attack_targets;
+	/**
+	 * UNIT_FLAG bits
+	 */
+	std::vector<uint8_t> flags;
+	/**
+	 * Row of each Actor, indexed by Actor ID, -1 if it isn't in the
+	 * snapshot
+	 */
+	std::vector<int64_t> rows;
+
+	UnitSnapshot();
+	/**
+	 * Empties the snapshot, keeping the memory of the arrays
+	 */
+	void Clear();
+	/**
+	 * Gets the number of units in the snapshot
+	 *
+	 * @return     The number of rows
+	 */
+	int64_t Size() const;
+	/**
+	 * Adds a row for an Actor
+	 *
+	 * The player's own units must all be added before any enemy
+	 *
+	 * @param      actor     The Actor
+	 * @param[in]  is_enemy  true if it's the enemy's, in which case only
+	 *                       what an EnemyUnitView shows is filled in
+	 */
+	void Add(Actor * actor, bool is_enemy);
+};
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+/**
+ * @file view_range.h
+ *
+ * Definitions for ranges of views over the Actors in the state
+ */
+
+#ifndef STATE_PLAYER_STATE_HANDLER_VIEW_RANGE_H
+#define STATE_PLAYER_STATE_HANDLER_VIEW_RANGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include "actor/magician.h"
+#include "actor/scout.h"
+#include "actor/swordsman.h"
+#include "actor/tower.h"
+#include "player_state_handler/unit_views.h"
+
+namespace state {
+
+/**
+ * A range over a list of Actors in the state, yielding a view of each
+ *
+ * Views are made as the range is iterated over, straight from the state's
+ * own list, so nothing is copied or allocated. Like the views themselves,
+ * a range is only valid until the state next changes
+ *
+ * @tparam     View    The view of each Actor
+ * @tparam     ActorT  The type of the Actors in the list
+ */
+template <typename View, typename ActorT>
+class ViewRange {
+public:
+	typedef std::vector<std::shared_ptr<ActorT> > actor_list_t;
+
+	class Iterator {
+	private:
+		typename actor_list_t::const_iterator current;
+		typename actor_list_t::const_iterator last;
+		/**
+		 * Which Actors to yield, indexed by Actor ID, all if null
+		 */
+		const std::vector<bool> * visible;
+		/**
+		 * Moves forward to the next Actor to yield, if the current one
+		 * isn't
+		 */
+		void SkipHidden() {
+			if (visible == nullptr)
+				return;
+			while (current != last) {
+				auto id = (*current)->GetId();
+				if (id >= 0 && id < static_cast<int64_t>(visible->size()) && (*visible)[id])
+					return;
+				++current;
+			}
+		}
+	public:
+		// Views are made on the fly, so there are no references to them
+		typedef std::input_iterator_tag iterator_category;
+		typedef View value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const View * pointer;
+		typedef View reference;
+
+		Iterator(
+			typename actor_list_t::const_iterator current,
+			typename actor_list_t::const_iterator last,
+			const std::vector<bool> * visible
+		):
+			current(current),
+			last(last),
+			visible(visible) {
+				SkipHidden();
+			}
+		View operator*() const {
+			return View(current->get());
+		}
+		Iterator& operator++() {
+			++current;
+			SkipHidden();
+			return *this;
+		}
+		Iterator operator++(int) {
+			Iterator old = *this;
+			++(*this);
+			return old;
+		}
+		bool operator==(const Iterator& other) const {
+			return current == other.current;
+		}
+		bool operator!=(const Iterator& other) const {
+			return current != other.current;
+		}
+	};
+
+private:
+	/**
+	 * The state's list of Actors
+	 */
+	const actor_list_t * actors;
+	/**
+	 * Which Actors to yield, indexed by Actor ID, all if null
+	 */
+	const std::vector<bool> * visible;
+public:
+	/**
+	 * Constructor
+	 *
+	 * @param[in]  actors   The state's list of Actors
+	 * @param[in]  visible  Which Actors to yield, indexed by Actor ID, or
+	 *                      null for all of them
+	 */
+	ViewRange(
+		const actor_list_t& actors,
+		const std::vector<bool> * visible = nullptr
+	):
+		actors(&actors),
+		visible(visible) {}
+	Iterator begin() const {
+		return Iterator(actors->begin(), actors->end(), visible);
+	}
+	Iterator end() const {
+		return Iterator(actors->end(), actors->end(), visible);
+	}
+	/**
+	 * Checks if the range yields no views
+	 *
+	 * @return     true if it doesn't, false otherwise
+	 */
+	bool Empty() const {
+		return begin() == end();
+	}
+	/**
+	 * Copies the views into a list, the way the vector returning getters
+	 * of PlayerStateHandler do
+	 *
+	 * @return     The views
+	 */
+	std::vector<View> ToVector() const {
+		std::vector<View> views;
+		views.reserve(actors->size());
+		for (auto view : *this) {
+			views.push_back(view);
+		}
+		return views;
+	}
+};
+
+typedef ViewRange<MagicianView, Magician> MagicianRange;
+typedef ViewRange<EnemyMagicianView, Magician> EnemyMagicianRange;
+typedef ViewRange<ScoutView, Scout> ScoutRange;
+typedef ViewRange<EnemyScoutView, Scout> EnemyScoutRange;
+typedef ViewRange<SwordsmanView, Swordsman> SwordsmanRange;
+typedef ViewRange<EnemySwordsmanView, Swordsman> EnemySwordsmanRange;
+typedef ViewRange<TowerView, Tower> TowerRange;
+typedef ViewRange<EnemyTowerView, Tower> EnemyTowerRange;
+
+}
+
+#endif
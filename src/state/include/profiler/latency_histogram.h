@@ -0,0 +1,148 @@
+/**
+ * @file latency_histogram.h
+ * Defines the LatencyHistogram class
+ */
+
+#ifndef STATE_PROFILER_LATENCY_HISTOGRAM_H
+#define STATE_PROFILER_LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "state_export.h"
+
+namespace state {
+
+/**
+ * Histogram of durations in nanoseconds with HDR-style log-linear buckets
+ *
+ * Every power of two range is split into a fixed number of linear sub
+ * buckets, so any recorded value is reported with a relative error of
+ * about 3%, no matter how large it is. Recording is O(1) and allocation
+ * free.
+ *
+ * Not thread safe, a histogram must be written to by one thread at a time
+ */
+class STATE_EXPORT LatencyHistogram {
+private:
+	/**
+	 * Number of bits of precision kept for each recorded value
+	 */
+	static const int64_t SUB_BUCKET_BITS = 5;
+	/**
+	 * Number of buckets in the second half of each power of two range
+	 */
+	static const int64_t SUB_BUCKET_HALF = 1 << (SUB_BUCKET_BITS - 1);
+	/**
+	 * Number of recorded values in each bucket
+	 */
+	std::vector<int64_t> counts;
+	/**
+	 * Total number of recorded values
+	 */
+	int64_t total_count;
+	/**
+	 * Sum of all recorded values
+	 */
+	double total_sum;
+	/**
+	 * Sum of the squares of all recorded values
+	 */
+	double total_sum_squares;
+	/**
+	 * Smallest recorded value
+	 */
+	int64_t min_value;
+	/**
+	 * Largest recorded value
+	 */
+	int64_t max_value;
+	/**
+	 * Gets the bucket a value is counted in
+	 *
+	 * @param[in]  value  The value
+	 *
+	 * @return     Index into counts
+	 */
+	static int64_t BucketIndex(int64_t value);
+	/**
+	 * Gets the smallest value counted in a bucket
+	 *
+	 * @param[in]  index  Index into counts
+	 *
+	 * @return     The bucket's lower bound
+	 */
+	static int64_t BucketLowerBound(int64_t index);
+public:
+	LatencyHistogram();
+	/**
+	 * Records a value
+	 *
+	 * Negative values are recorded as 0
+	 *
+	 * @param[in]  value  The value in nanoseconds
+	 */
+	void Record(int64_t value);
+	/**
+	 * Adds all values recorded in another histogram to this one
+	 *
+	 * @param[in]  other  The other histogram
+	 */
+	void Merge(const LatencyHistogram& other);
+	/**
+	 * Discards all recorded values
+	 */
+	void Reset();
+	/**
+	 * Gets the number of recorded values
+	 *
+	 * @return     The count
+	 */
+	int64_t GetCount() const;
+	/**
+	 * Gets the smallest recorded value
+	 *
+	 * @return     The minimum, 0 if nothing was recorded
+	 */
+	int64_t GetMin() const;
+	/**
+	 * Gets the largest recorded value
+	 *
+	 * @return     The maximum, 0 if nothing was recorded
+	 */
+	int64_t GetMax() const;
+	/**
+	 * Gets the mean of the recorded values
+	 *
+	 * @return     The mean, 0 if nothing was recorded
+	 */
+	double GetMean() const;
+	/**
+	 * Gets the standard deviation of the recorded values
+	 *
+	 * Unlike the percentiles, this is exact rather than bucketed
+	 *
+	 * @return     The standard deviation, 0 if nothing was recorded
+	 */
+	double GetStdDev() const;
+	/**
+	 * Gets the value below which the given percentage of values lie
+	 *
+	 * @param[in]  percentile  The percentile, between 0 and 100
+	 *
+	 * @return     The value at the percentile, 0 if nothing was recorded
+	 */
+	int64_t GetPercentile(double percentile) const;
+	/**
+	 * Prints a one line summary of the histogram in milliseconds
+	 *
+	 * @param      out   The stream to print to
+	 * @param[in]  name  The name the line is labelled with
+	 */
+	void Print(std::ostream& out, const std::string& name) const;
+};
+
+}
+
+#endif
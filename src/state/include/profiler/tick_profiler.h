@@ -0,0 +1,172 @@
+/**
+ * @file tick_profiler.h
+ * Defines the TickProfiler class and the macros used to instrument a tick
+ */
+
+#ifndef STATE_PROFILER_TICK_PROFILER_H
+#define STATE_PROFILER_TICK_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include "profiler/latency_histogram.h"
+#include "state_export.h"
+
+namespace state {
+
+/**
+ * The parts of a tick that are timed separately
+ */
+enum TICK_PHASE {
+	/**
+	 * A whole tick of the game loop, including IPC but not the sleep
+	 */
+	TICK,
+	/**
+	 * State::MergeWithBuffer for both players
+	 */
+	MERGE_WITH_BUFFER,
+	/**
+	 * PathPlanner::Update
+	 */
+	PATH_PLANNER_UPDATE,
+	/**
+	 * The loop over all actors in State::Update
+	 */
+	ACTOR_UPDATE,
+	/**
+	 * Terrain::Update
+	 */
+	TERRAIN_UPDATE,
+	/**
+	 * ProjectileHandler::Update
+	 */
+	PROJECTILE_HANDLER_UPDATE,
+	/**
+	 * State::UpdateInfluenceMaps
+	 */
+	INFLUENCE_UPDATE,
+	/**
+	 * State::MergeWithMain for both players
+	 */
+	MERGE_WITH_MAIN,
+	/**
+	 * ipc::StateTransfer
+	 */
+	STATE_TRANSFER,
+	/**
+	 * Number of phases, not a phase
+	 */
+	TICK_PHASE_COUNT
+};
+
+/**
+ * Collects a latency histogram for every TICK_PHASE
+ *
+ * Phases are timed with the PROFILE_TICK_PHASE macro, which compiles to
+ * nothing unless ENABLE_TICK_PROFILER is defined
+ */
+class STATE_EXPORT TickProfiler {
+private:
+	/**
+	 * One histogram per phase, in nanoseconds
+	 */
+	LatencyHistogram histograms[TICK_PHASE_COUNT];
+	/**
+	 * Guards histograms
+	 */
+	std::mutex histogram_mutex;
+	/**
+	 * Set when a dump has been requested but not yet printed
+	 */
+	std::atomic<bool> dump_requested;
+	TickProfiler();
+public:
+	/**
+	 * Records the duration of one run of a phase
+	 *
+	 * @param[in]  phase     The phase
+	 * @param[in]  duration  The duration in nanoseconds
+	 */
+	void Record(TICK_PHASE phase, int64_t duration);
+	/**
+	 * Prints the histograms of all phases that have been recorded
+	 *
+	 * @param      out   The stream to print to
+	 */
+	void Print(std::ostream& out);
+	/**
+	 * Discards everything recorded so far
+	 */
+	void Reset();
+	/**
+	 * Asks for the histograms to be printed at the end of the current tick
+	 *
+	 * Only sets an atomic flag, so it may be called from a signal handler
+	 */
+	void RequestDump();
+	/**
+	 * Prints the histograms if a dump was requested since the last call
+	 *
+	 * @param      out   The stream to print to
+	 */
+	void DumpIfRequested(std::ostream& out);
+	/**
+	 * Gets the profiler shared by the whole process
+	 *
+	 * @return     The profiler
+	 */
+	static TickProfiler& Instance();
+};
+
+/**
+ * Records the time between its construction and destruction as one run
+ * of a phase
+ */
+class ScopedPhaseTimer {
+private:
+	/**
+	 * The phase being timed
+	 */
+	TICK_PHASE phase;
+	/**
+	 * Time at which the timer was created
+	 */
+	std::chrono::steady_clock::time_point start;
+public:
+	ScopedPhaseTimer(TICK_PHASE phase) :
+		phase(phase),
+		start(std::chrono::steady_clock::now()) {}
+	~ScopedPhaseTimer() {
+		TickProfiler::Instance().Record(phase,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start
+			).count()
+		);
+	}
+};
+
+}
+
+#define TICK_PROFILER_CONCAT_(a, b) a##b
+#define TICK_PROFILER_CONCAT(a, b) TICK_PROFILER_CONCAT_(a, b)
+
+#ifdef ENABLE_TICK_PROFILER
+/**
+ * Times the rest of the enclosing scope as one run of phase
+ */
+#define PROFILE_TICK_PHASE(phase) \
+	state::ScopedPhaseTimer TICK_PROFILER_CONCAT(phase_timer_, __LINE__)(state::phase)
+/**
+ * Records an already measured std::chrono duration as one run of phase
+ */
+#define PROFILE_TICK_RECORD(phase, duration) \
+	state::TickProfiler::Instance().Record(state::phase, \
+		std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count())
+#else
+#define PROFILE_TICK_PHASE(phase)
+#define PROFILE_TICK_RECORD(phase, duration)
+#endif
+
+#endif
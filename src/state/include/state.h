@@ -22,8 +22,10 @@
 #include "actor/base.h"
 #include "actor/projectile_handler.h"
 #include "terrain/terrain.h"
+#include "influence/influence_map.h"
 #include "path_planner/path_planner.h"
 #include "path_planner/path_planner_helper.h"
+#include "parallel/worker_pool.h"
 #include "utilities.h"
 #include "state_export.h"
 
@@ -70,8 +72,20 @@ private:
 	std::vector<list_act_id_t> player_unit_ids;
 	/**
 	 * List of Actor IDs of visible enemy units for each player
+	 *
+	 * Found at most once per version, see UpdateVisibleEnemies
 	 */
 	std::vector<list_act_id_t> player_visible_enemy_unit_ids;
+	/**
+	 * For each player, whether each Actor is a visible enemy, indexed
+	 * by Actor ID
+	 */
+	std::vector<std::vector<bool> > player_visible_enemy_flags;
+	/**
+	 * For each player, the version its visible enemies were found at,
+	 * -1 if never
+	 */
+	std::vector<int64_t> player_visible_enemy_versions;
 	/**
 	 * List of Towers for each player
 	 */
@@ -121,6 +135,44 @@ private:
 	 */
 	std::vector<int64_t> base_poisoning_penalty;
 	std::vector<int64_t> tower_capture_score;
+	/**
+	 * Threads the Actor updates are split between
+	 *
+	 * If nullptr, Actors are updated on the calling thread
+	 */
+	std::shared_ptr<WorkerPool> worker_pool;
+	/**
+	 * Number of calls to Update per LOS refresh
+	 */
+	int64_t los_update_interval;
+	/**
+	 * Number of calls to Update since LOS was last refreshed
+	 */
+	int64_t ticks_since_los_update;
+	/**
+	 * Bumped whenever Actors may have moved, died or changed hands, or
+	 * the LOS may have changed
+	 */
+	int64_t version;
+	/**
+	 * For each player, an InfluenceMap of each INFLUENCE_TYPE
+	 */
+	std::vector<std::vector<InfluenceMap> > influence_maps;
+	/**
+	 * Finds the enemies visible to a player, unless they were already
+	 * found at this version
+	 *
+	 * @param[in]  player_id  The player's ID
+	 */
+	void UpdateVisibleEnemies(PlayerId player_id);
+	/**
+	 * Sets what each Actor adds to each player's InfluenceMaps, from
+	 * where it is, its HP and attack, and who can see it
+	 *
+	 * Only the cells of Actors that moved, or whose HP or visibility
+	 * changed, are touched
+	 */
+	void UpdateInfluenceMaps();
 public:
 	State();
 	State(
@@ -145,6 +197,16 @@ public:
 		std::vector<std::shared_ptr<Base> > bases,
 		std::vector<std::shared_ptr<Flag> > flags
 	);
+	/**
+	 * Makes a copy of the state with Actors of its own
+	 *
+	 * Copies of a State share its Actors. A clone's Actors, and the
+	 * pointers between them, are copies, so a player's buffer can be
+	 * changed on the player's thread without touching the main state
+	 *
+	 * @return     The clone
+	 */
+	std::unique_ptr<State> Clone() const;
 	/**
 	 * Gets Actor IDs of the given player's units.
 	 *
@@ -161,26 +223,71 @@ public:
 	 *
 	 * @return     The player's Actors
 	 */
-	std::vector<std::shared_ptr<Actor> > GetPlayerActors(
+	const std::vector<std::shared_ptr<Actor> >& GetPlayerActors(
 		PlayerId player_id
 	);
 	/**
 	 * Gets Actor IDs for enemy units visible to a particular player
 	 *
+	 * The list is only rebuilt when the state has changed since the
+	 * last call
+	 *
 	 * @param[in]  player_id  ID of the player whose enemies are to be
 	 *                        returned
 	 *
-	 * @return     List of required Actor IDs.
+	 * @return     List of required Actor IDs, valid until the state next
+	 *             changes
 	 */
-	list_act_id_t GetPlayerEnemyIds(PlayerId player_id);
+	const list_act_id_t& GetPlayerEnemyIds(PlayerId player_id);
+	/**
+	 * Checks if an Actor is an enemy unit visible to a particular player
+	 *
+	 * @param[in]  player_id  ID of the player
+	 * @param[in]  actor_id   ID of the Actor
+	 *
+	 * @return     true if it's in GetPlayerEnemyIds, false otherwise
+	 */
+	bool IsVisibleEnemy(PlayerId player_id, act_id_t actor_id);
+	/**
+	 * Gets whether each Actor is an enemy unit visible to a particular
+	 * player, the lookup IsVisibleEnemy does
+	 *
+	 * @param[in]  player_id  ID of the player
+	 *
+	 * @return     Flags indexed by Actor ID, valid until the state next
+	 *             changes
+	 */
+	const std::vector<bool>& GetVisibleEnemyFlags(PlayerId player_id);
+	/**
+	 * Gets a player's InfluenceMap of a particular type, which covers
+	 * the terrain one cell per TerrainElement
+	 *
+	 * @param[in]  player_id       ID of the player
+	 * @param[in]  influence_type  The type
+	 *
+	 * @return     The InfluenceMap, valid until the state next changes
+	 */
+	const InfluenceMap& GetInfluenceMap(
+		PlayerId player_id,
+		INFLUENCE_TYPE influence_type
+	);
+	/**
+	 * Gets the version of the state, which changes whenever Actors may
+	 * have moved, died or changed hands, or the LOS may have changed
+	 *
+	 * @return     The version
+	 */
+	int64_t GetVersion();
 	/**
 	 * Gets a player's Magicians
 	 *
 	 * @param[in]  player_id  Player ID
 	 *
-	 * @return     The Magicians
+	 * @return     The Magicians, valid until the state next changes
 	 */
-	std::vector<std::shared_ptr<Magician> > GetMagicians(PlayerId player_id);
+	const std::vector<std::shared_ptr<Magician> >& GetMagicians(
+		PlayerId player_id
+	);
 	/**
 	 * Gets an enemy's Magicians, taking into account LOS
 	 *
@@ -196,9 +303,11 @@ public:
 	 *
 	 * @param[in]  player_id  Player ID
 	 *
-	 * @return     The Scouts
+	 * @return     The Scouts, valid until the state next changes
 	 */
-	std::vector<std::shared_ptr<Scout> > GetScouts(PlayerId player_id);
+	const std::vector<std::shared_ptr<Scout> >& GetScouts(
+		PlayerId player_id
+	);
 	/**
 	 * Gets an enemy's Scouts, taking into account LOS
 	 *
@@ -214,9 +323,9 @@ public:
 	 *
 	 * @param[in]  player_id  Player ID
 	 *
-	 * @return     The Swordsmen
+	 * @return     The Swordsmen, valid until the state next changes
 	 */
-	std::vector<std::shared_ptr<Swordsman> > GetSwordsmen(
+	const std::vector<std::shared_ptr<Swordsman> >& GetSwordsmen(
 		PlayerId player_id
 	);
 	/**
@@ -234,9 +343,11 @@ public:
 	 *
 	 * @param[in]  player_id  Player ID
 	 *
-	 * @return     The Towers
+	 * @return     The Towers, valid until the state next changes
 	 */
-	std::vector<std::shared_ptr<Tower> > GetTowers(PlayerId player_id);
+	const std::vector<std::shared_ptr<Tower> >& GetTowers(
+		PlayerId player_id
+	);
 	/**
 	 * Gets an enemy's towers, taking into account LOS
 	 *
@@ -556,10 +667,32 @@ public:
 	 *
 	 * @return     The terrain
 	 */
-	Terrain GetTerrain();
+	Terrain& GetTerrain();
+	/**
+	 * Sets the threads the Actor updates are split between
+	 *
+	 * The result of Update does not depend on the number of threads
+	 *
+	 * @param[in]  worker_pool  The worker pool, nullptr to update
+	 *                          Actors on the calling thread
+	 */
+	void SetWorkerPool(std::shared_ptr<WorkerPool> worker_pool);
+	/**
+	 * Sets how often Update refreshes LOS
+	 *
+	 * Between refreshes, every player keeps the LOS of the last refresh
+	 *
+	 * @param[in]  los_update_interval  Number of calls to Update per
+	 *                                  refresh, 1 refreshes on every call
+	 */
+	void SetLosUpdateInterval(int64_t los_update_interval);
 	/**
 	 * Updates the internal state of the game.
 	 *
+	 * Actors first decide what to do, possibly in parallel, without
+	 * changing anything other Actors can see. Damage, deaths, respawns,
+	 * movement and tower captures are then committed in order of ID
+	 *
 	 * @param[in] delta_time The difference in time in ms between
 	 *                       the previous and current Update calls.
 	 */
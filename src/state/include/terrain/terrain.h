@@ -10,6 +10,7 @@
 #include <memory>
 #include "actor/actor.h"
 #include "terrain/terrain_element.h"
+#include "parallel/worker_pool.h"
 #include "state_export.h"
 
 namespace state {
@@ -56,6 +57,36 @@ struct LosListEntry {
 	bool operator<(const LosListEntry& rhs);
 };
 
+/**
+ * A living unit whose LOS is computed during Terrain::Update
+ */
+struct LosSource {
+	/**
+	 * The player the unit belongs to
+	 */
+	PlayerId player_id;
+	/**
+	 * The grid offset of the unit
+	 */
+	physics::Vector2D offset;
+	/**
+	 * The unit's LOS radius in offsets
+	 */
+	int64_t radius;
+	/**
+	 * The first grid row the unit can see
+	 */
+	int64_t min_row;
+	/**
+	 * The last grid row the unit can see
+	 */
+	int64_t max_row;
+	/**
+	 * Every TerrainElement the unit can see, as row * row_size + column
+	 */
+	std::vector<int64_t> cells;
+};
+
 /**
  * Class for the entire terrain
  */
@@ -78,22 +109,70 @@ private:
 	 */
 	std::vector<physics::Vector2D> diagonal_neighbours;
 	/**
-	 * Helper method to update los of grid elements inside a radius
+	 * Number of LOS updates so far
+	 */
+	int64_t los_version;
+	/**
+	 * For each player, the LOS version at which the LOS of each
+	 * TerrainElement last changed, as row * row_size + column, 0 if it
+	 * never has
+	 */
+	std::vector<std::vector<int64_t> > los_changed_at;
+	/**
+	 * The TerrainElements whose LOS changed in the last LOS update, as
+	 * row * row_size + column, one list per player and band
+	 */
+	std::vector<std::vector<int64_t> > los_band_changes;
+	/**
+	 * Helper method to find the grid elements a unit can see
+	 *
+	 * Only reads the grid, so sources can be flooded concurrently
 	 *
-	 * @param[in]  offset  The grid offset
-	 * @param[in]  radius  The radius in offsets to flood
-	 * @param[in]  los     The LOS_TYPE to update with
-	 * @param[in]  pid     The PlayerId whose LOS is to be updated
+	 * @param      source   The unit, whose cells, min_row and max_row
+	 *                      are filled in
+	 * @param      queue    Scratch space for the flood queue
+	 * @param      visited  Scratch space for the visited flags
 	 */
-	void UpdateLos(
-		physics::Vector2D offset,
-		int64_t radius,
-		LOS_TYPE los,
-		PlayerId pid
+	void FloodLos(
+		LosSource& source,
+		std::vector<LosListEntry>& queue,
+		std::vector<bool>& visited
+	);
+	/**
+	 * Helper method to update one player's LOS in a band of rows
+	 *
+	 * Cells seen by the player's sources become DIRECT_LOS, and other
+	 * cells seen in the last update become EXPLORED. Only cells whose
+	 * LOS changes are written to
+	 *
+	 * @param[in]  sources    All LOS sources, already flooded
+	 * @param[in]  pid        The PlayerId whose LOS is to be updated
+	 * @param[in]  first_row  The first row of the band
+	 * @param[in]  last_row   The row after the last row of the band
+	 * @param      changes    Filled with the cells whose LOS changed, in
+	 *                        increasing order
+	 */
+	void UpdateLosBand(
+		const std::vector<LosSource>& sources,
+		PlayerId pid,
+		int64_t first_row,
+		int64_t last_row,
+		std::vector<int64_t>& changes
 	);
 public:
 	Terrain(int64_t nrows);
 	Terrain(std::vector<std::vector<TerrainElement> > grid);
+	/**
+	 * Constructor for Terrain from packed terrain types
+	 *
+	 * Builds the grid in one pass, without an intermediate grid to copy
+	 *
+	 * @param[in]  nrows         No of terrain elements per row
+	 * @param[in]  types         The TERRAIN_TYPE of each element, one byte
+	 *                           each in row major order
+	 * @param[in]  element_size  Side length of each element
+	 */
+	Terrain(int64_t nrows, const uint8_t* types, int64_t element_size);
 	/**
 	 * Gets TerrainElement corresponding to position vector
 	 *
@@ -123,6 +202,48 @@ public:
 	 * @return     The number of rows
 	 */
 	int64_t GetRows();
+	/**
+	 * Gets the number of LOS updates so far, which only changes when
+	 * some TerrainElement's LOS may have
+	 *
+	 * @return     The LOS version
+	 */
+	int64_t GetLosVersion();
+	/**
+	 * Copies the grid, as a player sees it, into flat arrays
+	 *
+	 * Each array holds row * row_size + column for every element, so
+	 * must have room for row_size squared elements
+	 *
+	 * @param[in]  player_id      The player
+	 * @param      terrain_types  Filled with the TERRAIN_TYPE of each
+	 *                            element, UNDEFINED if it's UNEXPLORED,
+	 *                            or nullptr to skip
+	 * @param      los_types      Filled with the player's LOS_TYPE of
+	 *                            each element, or nullptr to skip
+	 */
+	void CopyGrids(
+		PlayerId player_id,
+		uint8_t * terrain_types,
+		uint8_t * los_types
+	);
+	/**
+	 * Gets the TerrainElements whose LOS for a player changed after a
+	 * particular LOS version
+	 *
+	 * Uses the last update's list of changes when asked for just that
+	 * update, and goes over the whole grid otherwise
+	 *
+	 * @param[in]  player_id  The player
+	 * @param[in]  since      The LOS version
+	 * @param      changes    Filled with the elements, as
+	 *                        row * row_size + column, in increasing order
+	 */
+	void GetLosChanges(
+		PlayerId player_id,
+		int64_t since,
+		std::vector<int64_t>& changes
+	);
 	/**
 	 * Gets the adjacent neighbours of a given TerrainElement
 	 *
@@ -160,13 +281,25 @@ public:
 	 * Updates the LOS of the TerrainElements
 	 * Updates which units are on which TerrainElement
 	 *
-	 * @param[in]  actors  The actors in the game
+	 * Each unit's LOS is computed on its own, then each player's LOS,
+	 * split into bands of rows on large maps, is updated on its own,
+	 * so both parts can be split between threads
+	 *
+	 * @param[in]  actors       The actors in the game
+	 * @param      worker_pool  The threads to split the work between,
+	 *                          nullptr to use the calling thread
 	 */
-	void Update(std::vector<std::vector<std::shared_ptr<Actor> > > actors);
+	void Update(
+		const std::vector<std::vector<std::shared_ptr<Actor> > >& actors,
+		WorkerPool * worker_pool = nullptr
+	);
 	/**
 	 * Merges this, a player state's Terrain, with the main state's
 	 * Terrain
 	 *
+	 * When this is one LOS update behind, only the elements that changed
+	 * in that update are copied
+	 *
 	 * @param[in]  terrain  The main state's Terrain
 	 */
 	void MergeWithMain(const Terrain& terrain);
@@ -6,6 +6,7 @@
 #ifndef STATE_TERRAIN_TERRAIN_ELEMENT_H
 #define STATE_TERRAIN_TERRAIN_ELEMENT_H
 
+#include <array>
 #include <cstdint>
 #include <vector>
 #include "vector2d.h"
@@ -58,8 +59,10 @@ private:
 	TERRAIN_TYPE terrain_type;
 	/**
 	 * The LOS type for players
+	 *
+	 * Held in place, so elements are made and copied without allocating
 	 */
-	std::vector<LOS_TYPE> los_type_player;
+	std::array<LOS_TYPE, LAST_PLAYER + 1> los_type_player;
 	/**
 	 * The timestamps noting when the element was last visited by the players
 	 */
@@ -9,7 +9,11 @@ PathPlannerHelper* Actor::GetPathPlannerHelper() {
 	return &path_planner_helper;
 }
 
-Actor::Actor() : path_planner_helper(std::shared_ptr<Actor>(this)) {}
+Actor::Actor() :
+	queued_damage(0),
+	is_death_pending(false),
+	is_respawn_pending(false),
+	path_planner_helper(std::shared_ptr<Actor>(this)) {}
 Actor::Actor(
 		act_id_t id,
 		PlayerId player_id,
@@ -53,18 +57,28 @@ Actor::Actor(
 	attack_speed(attack_speed),
 	attack_range(attack_range),
 	is_dead(false),
+	queued_damage(0),
+	is_death_pending(false),
+	is_respawn_pending(false),
 	respawn_location(nullptr),
 	path_planner_helper() {}
 
-Actor::Actor(const Actor& other) {
+Actor::Actor(const Actor& other) :
+	queued_damage(other.queued_damage.load()),
+	is_death_pending(other.is_death_pending),
+	is_respawn_pending(other.is_respawn_pending) {
 	id = other.id;
 	player_id = other.player_id;
 	actor_type = other.actor_type;
 	state = other.state->Clone();
+	can_attack = other.can_attack;
+	is_under_attack = other.is_under_attack;
+	can_plan_path = other.can_plan_path;
 	attack = other.attack;
 	hp = other.hp;
 	max_hp = other.max_hp;
 	max_speed = other.max_speed;
+	speed = other.speed;
 	size = other.size;
 	total_respawn_time = other.total_respawn_time;
 	time_to_respawn = other.time_to_respawn;
@@ -221,6 +235,41 @@ void Actor::Damage(int64_t damage_amount) {
 	hp = std::max((int64_t) 0, hp - damage_amount);
 }
 
+void Actor::QueueDamage(int64_t damage_amount) {
+	queued_damage.fetch_add(damage_amount, std::memory_order_relaxed);
+}
+
+void Actor::RequestDeath() {
+	is_death_pending = true;
+}
+
+bool Actor::IsDeathPending() {
+	return is_death_pending;
+}
+
+void Actor::RequestRespawn() {
+	is_respawn_pending = true;
+}
+
+bool Actor::IsRespawnPending() {
+	return is_respawn_pending;
+}
+
+void Actor::Commit(float) {
+	int64_t damage_amount = queued_damage.exchange(0);
+	if (damage_amount > 0) {
+		Damage(damage_amount);
+	}
+	if (is_death_pending) {
+		is_death_pending = false;
+		Die();
+	}
+	if (is_respawn_pending) {
+		is_respawn_pending = false;
+		Respawn();
+	}
+}
+
 Actor * Actor::GetRespawnLocation() {
 	return respawn_location;
 }
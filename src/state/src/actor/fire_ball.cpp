@@ -43,7 +43,7 @@ bool FireBall::IsDone() {
 
 void FireBall::Attack() {
 	is_done = true;
-	attack_target->Damage(attack);
+	attack_target->QueueDamage(attack);
 }
 
 void FireBall::Update(float delta_time) {
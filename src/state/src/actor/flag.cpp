@@ -58,7 +58,9 @@ void Flag::MoveToBase(physics::Vector2D base_position) {
 	position = base_position;
 }
 
-void Flag::Update(float delta_time) {
+void Flag::Update(float) {}
+
+void Flag::Commit(float) {
 	if (IsCaptured()) {
 		position = king->GetPosition();
 	}
@@ -56,6 +56,10 @@ bool King::HasFlag() {
 
 void King::Update(float delta_time) {
 	DecideState(delta_time);
+}
+
+void King::Commit(float delta_time) {
+	Actor::Commit(delta_time);
 	if (IsDead() && HasFlag()) {
 		flag->Drop();
 		DropFlag();
@@ -79,7 +79,11 @@ void Magician::SetReadyToAttackToFalse() {
 
 void Magician::Update(float delta_time) {
 	DecideState(delta_time);
-	position = position + velocity * delta_time;
 };
 
+void Magician::Commit(float delta_time) {
+	Actor::Commit(delta_time);
+	position = position + velocity * delta_time;
+}
+
 }
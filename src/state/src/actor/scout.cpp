@@ -42,6 +42,10 @@ Scout::Scout(
 
 void Scout::Update(float delta_time) {
 	DecideState(delta_time);
+}
+
+void Scout::Commit(float delta_time) {
+	Actor::Commit(delta_time);
 	position = position + velocity * delta_time;
 }
 
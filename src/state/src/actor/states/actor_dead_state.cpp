@@ -5,34 +5,34 @@
 namespace state {
 
 void ActorDeadState::Enter(Actor * actor) {
-	actor->Die();
+	actor->RequestDeath();
 }
 
 std::unique_ptr<ActorState> ActorDeadState::Update(
 	Actor * actor,
 	float delta_time
 ) {
+	// Death and respawn only take effect when the tick is committed
+	if (actor->IsDeathPending() || actor->IsRespawnPending()) {
+		return nullptr;
+	}
+	// Respawned, or for towers, captured
+	if (!actor->IsDead()) {
+		return std::unique_ptr<ActorState>(new ActorIdleState());
+	}
 	if (actor->GetActorType() == ActorType::TOWER) {
-		if (actor->IsDead()) {
-			return nullptr;
-		}
-		else {
-			return std::unique_ptr<ActorState>(new ActorIdleState());
-		}
+		return nullptr;
 	}
 	if (actor->GetTimeToRespawn() <= 0 &&
 		actor->GetRespawnLocation() != nullptr) {
-		return std::unique_ptr<ActorState>(new ActorIdleState());
+		actor->RequestRespawn();
+		return nullptr;
 	}
 	actor->DecreaseRespawnTime(delta_time);
 	return nullptr;
 }
 
-void ActorDeadState::Exit(Actor * actor) {
-	if (actor->GetActorType() != ActorType::TOWER) {
-		actor->Respawn();
-	}
-}
+void ActorDeadState::Exit(Actor *) {}
 
 std::unique_ptr<ActorState> ActorDeadState::Clone() {
 	return std::unique_ptr<ActorState>(new ActorDeadState(*this));
@@ -42,11 +42,15 @@ Swordsman::Swordsman(
 	) {}
 
 void Swordsman::Attack() {
-	attack_target->Damage(attack);
+	attack_target->QueueDamage(attack);
 }
 
 void Swordsman::Update(float delta_time) {
 	DecideState(delta_time);
+}
+
+void Swordsman::Commit(float delta_time) {
+	Actor::Commit(delta_time);
 	position = position + velocity * delta_time;
 }
 
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include "influence/influence_map.h"
+
+namespace state {
+
+InfluenceMap::InfluenceMap() : rows(0) {}
+
+InfluenceMap::InfluenceMap(int64_t rows)
+	: rows(rows),
+	cells(rows * rows, 0),
+	tree((rows + 1) * (rows + 1), 0) {}
+
+void InfluenceMap::AddToCell(int64_t cell, int64_t delta) {
+	cells[cell] += delta;
+	for (int64_t i = cell / rows + 1; i <= rows; i += i & -i) {
+		for (int64_t j = cell % rows + 1; j <= rows; j += j & -j) {
+			tree[i * (rows + 1) + j] += delta;
+		}
+	}
+}
+
+int64_t InfluenceMap::GetPrefixSum(int64_t row_end, int64_t column_end) const {
+	int64_t sum = 0;
+	for (int64_t i = row_end; i > 0; i -= i & -i) {
+		for (int64_t j = column_end; j > 0; j -= j & -j) {
+			sum += tree[i * (rows + 1) + j];
+		}
+	}
+	return sum;
+}
+
+void InfluenceMap::Set(act_id_t actor_id, int64_t cell, int64_t value) {
+	if (actor_id >= static_cast<int64_t>(entries.size())) {
+		entries.resize(actor_id + 1, {-1, 0});
+	}
+	if (value == 0) {
+		cell = -1;
+	}
+
+	auto& entry = entries[actor_id];
+	if (entry.cell == cell && entry.value == value) {
+		return;
+	}
+	if (entry.cell != -1) {
+		AddToCell(entry.cell, -entry.value);
+	}
+	if (cell != -1) {
+		AddToCell(cell, value);
+	}
+	entry.cell = cell;
+	entry.value = value;
+}
+
+int64_t InfluenceMap::GetCell(int64_t row, int64_t column) const {
+	if (row < 0 || row >= rows || column < 0 || column >= rows) {
+		return 0;
+	}
+	return cells[row * rows + column];
+}
+
+int64_t InfluenceMap::GetSum(
+	int64_t first_row,
+	int64_t first_column,
+	int64_t last_row,
+	int64_t last_column
+) const {
+	first_row = std::max(first_row, (int64_t) 0);
+	first_column = std::max(first_column, (int64_t) 0);
+	last_row = std::min(last_row, rows - 1);
+	last_column = std::min(last_column, rows - 1);
+	if (first_row > last_row || first_column > last_column) {
+		return 0;
+	}
+
+	return GetPrefixSum(last_row + 1, last_column + 1)
+		- GetPrefixSum(first_row, last_column + 1)
+		- GetPrefixSum(last_row + 1, first_column)
+		+ GetPrefixSum(first_row, first_column);
+}
+
+void InfluenceMap::MergeWithMain(const InfluenceMap& influence_map) {
+	if (rows != influence_map.rows) {
+		*this = influence_map;
+		return;
+	}
+	for (int64_t i = 0; i < static_cast<int64_t>(influence_map.entries.size()); ++i) {
+		auto& entry = influence_map.entries[i];
+		Set(i, entry.cell, entry.value);
+	}
+}
+
+}
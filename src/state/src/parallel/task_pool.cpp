@@ -0,0 +1,108 @@
+#include <algorithm>
+#include "parallel/task_pool.h"
+
+namespace state {
+
+/**
+ * The pool the calling thread belongs to, nullptr if none
+ */
+static thread_local TaskPool * current_pool = nullptr;
+
+/**
+ * Index of the calling thread in current_pool
+ */
+static thread_local int64_t current_worker = -1;
+
+TaskPool::TaskPool(int64_t thread_count) :
+	queued_tasks(0),
+	next_queue(0),
+	is_stopped(false) {
+
+	if (thread_count <= 0) {
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (int64_t i = 0; i < thread_count; ++i) {
+		queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+	}
+	for (int64_t i = 0; i < thread_count; ++i) {
+		workers.push_back(std::thread(&TaskPool::WorkerLoop, this, i));
+	}
+}
+
+TaskPool::~TaskPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		is_stopped = true;
+	}
+	sleep_cv.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+int64_t TaskPool::GetThreadCount() {
+	return workers.size();
+}
+
+void TaskPool::Submit(Task task) {
+	int64_t queue;
+	if (current_pool == this) {
+		queue = current_worker;
+	}
+	else {
+		queue = next_queue.fetch_add(1) % queues.size();
+	}
+	{
+		std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+		queues[queue]->tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		queued_tasks++;
+	}
+	sleep_cv.notify_one();
+}
+
+bool TaskPool::TakeTask(int64_t worker, Task& task) {
+	for (int64_t i = 0; i < static_cast<int64_t>(queues.size()); ++i) {
+		auto& queue = *queues[(worker + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) {
+			continue;
+		}
+		// Own tasks run oldest first, so that matches take turns.
+		// Stolen tasks come from the other end to disturb the owner less
+		if (i == 0) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		else {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		queued_tasks--;
+		return true;
+	}
+	return false;
+}
+
+void TaskPool::WorkerLoop(int64_t worker) {
+	current_pool = this;
+	current_worker = worker;
+	while (1) {
+		Task task;
+		if (TakeTask(worker, task)) {
+			task();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleep_cv.wait(lock, [this] {
+			return is_stopped || queued_tasks > 0;
+		});
+		if (is_stopped && queued_tasks == 0) {
+			break;
+		}
+	}
+}
+
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include "parallel/worker_pool.h"
+
+namespace state {
+
+WorkerPool::WorkerPool(int64_t thread_count) :
+	job(nullptr),
+	job_size(0),
+	chunk_size(1),
+	next_index(0),
+	job_generation(0),
+	busy_workers(0),
+	is_stopped(false) {
+
+	if (thread_count <= 0) {
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (int64_t i = 1; i < thread_count; ++i) {
+		workers.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		is_stopped = true;
+	}
+	job_cv.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+int64_t WorkerPool::GetThreadCount() {
+	return workers.size() + 1;
+}
+
+void WorkerPool::RunChunks() {
+	int64_t begin;
+	while ((begin = next_index.fetch_add(chunk_size)) < job_size) {
+		(*job)(begin, std::min(begin + chunk_size, job_size));
+	}
+}
+
+void WorkerPool::WorkerLoop() {
+	int64_t seen_generation = 0;
+	while (1) {
+		{
+			std::unique_lock<std::mutex> lock(job_mutex);
+			job_cv.wait(lock, [this, seen_generation] {
+				return is_stopped || job_generation != seen_generation;
+			});
+			if (is_stopped) {
+				break;
+			}
+			seen_generation = job_generation;
+		}
+		RunChunks();
+		{
+			std::lock_guard<std::mutex> lock(job_mutex);
+			busy_workers--;
+			if (busy_workers == 0) {
+				done_cv.notify_one();
+			}
+		}
+	}
+}
+
+void WorkerPool::ParallelFor(int64_t count, const RangeFunction& function) {
+	if (count <= 0) {
+		return;
+	}
+	if (workers.empty() || count == 1) {
+		function(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> call_lock(call_mutex);
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		job = &function;
+		job_size = count;
+		// A few chunks per thread, so that uneven chunks even out
+		chunk_size = std::max((int64_t) 1, count / (4 * GetThreadCount()));
+		next_index = 0;
+		busy_workers = workers.size();
+		job_generation++;
+	}
+	job_cv.notify_all();
+
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(job_mutex);
+	done_cv.wait(lock, [this] { return busy_workers == 0; });
+	job = nullptr;
+}
+
+void ParallelFor(
+	WorkerPool * worker_pool,
+	int64_t count,
+	const WorkerPool::RangeFunction& function
+) {
+	if (worker_pool) {
+		worker_pool->ParallelFor(count, function);
+	}
+	else if (count > 0) {
+		function(0, count);
+	}
+}
+
+}
@@ -14,7 +14,7 @@ bool IsValidFormation(
 		&& formation[0] == physics::Vector2D(0,0));
 }
 
-PathPlannerHelper::PathPlannerHelper() : leader(NULL) {}
+PathPlannerHelper::PathPlannerHelper() : leader(NULL), is_path_planning(false) {}
 PathPlannerHelper::PathPlannerHelper(std::shared_ptr<Actor> self) :
 	self(self), leader(NULL), is_path_planning(false) {}
 
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cmath>
 #include "player_state_handler/player_state_handler.h"
 
 namespace state {
@@ -29,75 +30,85 @@ list_act_id_t PlayerStateHandler::GetPlayerUnitIds() {
 	return state->GetPlayerUnitIds(player_id);
 }
 
-list_act_id_t PlayerStateHandler::GetPlayerEnemyIds() {
+const list_act_id_t& PlayerStateHandler::GetPlayerEnemyIds() {
 	return state->GetPlayerEnemyIds(player_id);
 }
 
 std::vector<MagicianView> PlayerStateHandler::GetMagicians() {
-	auto magicians = state->GetMagicians(player_id);
-	std::vector<MagicianView> magician_views;
-	for (auto magician : magicians)
-		magician_views.push_back(MagicianView(magician.get()));
-	return magician_views;
+	return GetMagicianRange().ToVector();
 }
 
 std::vector<EnemyMagicianView> PlayerStateHandler::GetEnemyMagicians() {
-	auto magicians = state->GetEnemyMagicians(player_id);
-	std::vector<EnemyMagicianView> magician_views;
-	for (auto magician : magicians)
-		magician_views.push_back(EnemyUnitView(magician.get()));
-	return magician_views;
+	return GetEnemyMagicianRange().ToVector();
+}
+
+MagicianRange PlayerStateHandler::GetMagicianRange() {
+	return MagicianRange(state->GetMagicians(player_id));
+}
+
+EnemyMagicianRange PlayerStateHandler::GetEnemyMagicianRange() {
+	PlayerId enemy_player_id =
+		static_cast<PlayerId>((player_id + 1) % (LAST_PLAYER + 1));
+	return EnemyMagicianRange(state->GetMagicians(enemy_player_id),
+		&state->GetVisibleEnemyFlags(player_id));
 }
 
 std::vector<ScoutView> PlayerStateHandler::GetScouts() {
-	auto scouts = state->GetScouts(player_id);
-	std::vector<ScoutView> scout_views;
-	for (auto scout : scouts)
-		scout_views.push_back(UnitView(scout.get()));
-	return scout_views;
+	return GetScoutRange().ToVector();
 }
 
 std::vector<EnemyScoutView> PlayerStateHandler::GetEnemyScouts() {
-	auto scouts = state->GetEnemyScouts(player_id);
-	std::vector<EnemyScoutView> scout_views;
-	for (auto scout : scouts)
-		scout_views.push_back(EnemyUnitView(scout.get()));
-	return scout_views;
+	return GetEnemyScoutRange().ToVector();
+}
+
+ScoutRange PlayerStateHandler::GetScoutRange() {
+	return ScoutRange(state->GetScouts(player_id));
+}
+
+EnemyScoutRange PlayerStateHandler::GetEnemyScoutRange() {
+	PlayerId enemy_player_id =
+		static_cast<PlayerId>((player_id + 1) % (LAST_PLAYER + 1));
+	return EnemyScoutRange(state->GetScouts(enemy_player_id),
+		&state->GetVisibleEnemyFlags(player_id));
 }
 
 std::vector<SwordsmanView> PlayerStateHandler::GetSwordsmen() {
-	auto swordsmen = state->GetSwordsmen(player_id);
-	std::vector<SwordsmanView> swordsman_views;
-	for (auto swordsman : swordsmen) {
-		swordsman_views.push_back(SwordsmanView(swordsman.get()));
-	}
-	return swordsman_views;
+	return GetSwordsmanRange().ToVector();
 }
 
 std::vector<EnemySwordsmanView>
 PlayerStateHandler::GetEnemySwordsmen() {
-	auto swordsmen = state->GetEnemySwordsmen(player_id);
-	std::vector<EnemySwordsmanView> swordsman_views;
-	for (auto swordsman : swordsmen) {
-		swordsman_views.push_back(EnemySwordsmanView(swordsman.get()));
-	}
-	return swordsman_views;
+	return GetEnemySwordsmanRange().ToVector();
+}
+
+SwordsmanRange PlayerStateHandler::GetSwordsmanRange() {
+	return SwordsmanRange(state->GetSwordsmen(player_id));
+}
+
+EnemySwordsmanRange PlayerStateHandler::GetEnemySwordsmanRange() {
+	PlayerId enemy_player_id =
+		static_cast<PlayerId>((player_id + 1) % (LAST_PLAYER + 1));
+	return EnemySwordsmanRange(state->GetSwordsmen(enemy_player_id),
+		&state->GetVisibleEnemyFlags(player_id));
 }
 
 std::vector<TowerView> PlayerStateHandler::GetTowers() {
-	auto towers = state->GetTowers(player_id);
-	std::vector<TowerView> tower_views;
-	for (auto tower : towers)
-		tower_views.push_back(TowerView(tower.get()));
-	return tower_views;
+	return GetTowerRange().ToVector();
 }
 
 std::vector<EnemyTowerView> PlayerStateHandler::GetEnemyTowers() {
-	auto towers = state->GetEnemyTowers(player_id);
-	std::vector<EnemyTowerView> tower_views;
-	for (auto tower : towers)
-		tower_views.push_back(EnemyTowerView(tower.get()));
-	return tower_views;
+	return GetEnemyTowerRange().ToVector();
+}
+
+TowerRange PlayerStateHandler::GetTowerRange() {
+	return TowerRange(state->GetTowers(player_id));
+}
+
+EnemyTowerRange PlayerStateHandler::GetEnemyTowerRange() {
+	PlayerId enemy_player_id =
+		static_cast<PlayerId>((player_id + 1) % (LAST_PLAYER + 1));
+	return EnemyTowerRange(state->GetTowers(enemy_player_id),
+		&state->GetVisibleEnemyFlags(player_id));
 }
 
 FlagView PlayerStateHandler::GetFlag() {
@@ -165,6 +176,47 @@ int64_t PlayerStateHandler::GetTerrainRows() {
 	return state->GetTerrain().GetRows();
 }
 
+int64_t PlayerStateHandler::GetTerrainGrid(
+	uint8_t * terrain_types,
+	uint8_t * los_types
+) {
+	auto& terrain = state->GetTerrain();
+	terrain.CopyGrids(player_id, terrain_types, los_types);
+	return terrain.GetLosVersion();
+}
+
+int64_t PlayerStateHandler::GetChangedTerrainElements(
+	int64_t since,
+	std::vector<int64_t>& changed
+) {
+	auto& terrain = state->GetTerrain();
+	terrain.GetLosChanges(player_id, since, changed);
+	return terrain.GetLosVersion();
+}
+
+int64_t PlayerStateHandler::GetInfluence(
+	INFLUENCE_TYPE influence_type,
+	physics::Vector2D offset
+) {
+	return state->GetInfluenceMap(player_id, influence_type)
+		.GetCell(offset.x, offset.y);
+}
+
+int64_t PlayerStateHandler::GetInfluenceNear(
+	INFLUENCE_TYPE influence_type,
+	physics::Vector2D position,
+	double distance
+) {
+	int64_t element_size = state->GetTerrain()
+		.CoordinateToTerrainElement(physics::Vector2D(0, 0)).GetSize();
+	return state->GetInfluenceMap(player_id, influence_type).GetSum(
+		std::floor((position.x - distance) / element_size),
+		std::floor((position.y - distance) / element_size),
+		std::floor((position.x + distance) / element_size),
+		std::floor((position.y + distance) / element_size)
+	);
+}
+
 UnitView PlayerStateHandler::GetUnitFromId(act_id_t actor_id, int * success) {
 	auto actor = state->GetActorFromId(player_id, actor_id, success);
 	if (actor != nullptr)
@@ -180,9 +232,7 @@ PlayerStateHandler::GetEnemyUnitFromId(act_id_t actor_id, int * success) {
 	if (actor == nullptr)
 		return EnemyUnitView();
 
-	auto enemies = state->GetPlayerEnemyIds(player_id);
-
-	if (std::find(enemies.begin(), enemies.end(), actor_id) == enemies.end()) {
+	if (!state->IsVisibleEnemy(player_id, actor_id)) {
 		if (success) {
 			*success = -2;
 		}
@@ -192,6 +242,88 @@ PlayerStateHandler::GetEnemyUnitFromId(act_id_t actor_id, int * success) {
 	return EnemyUnitView(actor.get());
 }
 
+void PlayerStateHandler::GetUnitSnapshot(UnitSnapshot * snapshot) {
+	PlayerId enemy_player_id =
+		static_cast<PlayerId>((player_id + 1) % (LAST_PLAYER + 1));
+
+	snapshot->Clear();
+	snapshot->version = state->GetVersion();
+
+	for (auto& actor : state->GetPlayerActors(player_id))
+		snapshot->Add(actor.get(), false);
+
+	for (auto actor_id : state->GetPlayerEnemyIds(player_id)) {
+		auto actor = state->GetActorFromId(enemy_player_id, actor_id, nullptr);
+		if (actor != nullptr)
+			snapshot->Add(actor.get(), true);
+	}
+}
+
+const SpatialIndex& PlayerStateHandler::GetSpatialIndex() {
+	if (spatial_index.GetVersion() == state->GetVersion())
+		return spatial_index;
+
+	PlayerId enemy_player_id =
+		static_cast<PlayerId>((player_id + 1) % (LAST_PLAYER + 1));
+
+	spatial_index.Clear();
+	for (auto& actor : state->GetPlayerActors(player_id)) {
+		if (!actor->IsDead()) {
+			auto position = actor->GetPosition();
+			spatial_index.Add({actor->GetId(), actor->GetActorType(), false,
+				position.x, position.y});
+		}
+	}
+	for (auto actor_id : state->GetPlayerEnemyIds(player_id)) {
+		auto actor = state->GetActorFromId(enemy_player_id, actor_id, nullptr);
+		if (actor != nullptr) {
+			auto position = actor->GetPosition();
+			spatial_index.Add({actor->GetId(), actor->GetActorType(), true,
+				position.x, position.y});
+		}
+	}
+
+	auto& terrain = state->GetTerrain();
+	auto element_size = terrain.CoordinateToTerrainElement(
+		physics::Vector2D(0, 0)).GetSize();
+	spatial_index.Build(terrain.GetRows() * element_size,
+		SPATIAL_INDEX_CELL_ELEMENTS * element_size, state->GetVersion());
+
+	return spatial_index;
+}
+
+list_act_id_t PlayerStateHandler::QueryUnitsInRadius(
+	physics::Vector2D center,
+	double radius,
+	UNIT_FILTER filter
+) {
+	list_act_id_t result;
+	GetSpatialIndex().QueryRadius(center, radius, filter, result);
+	return result;
+}
+
+list_act_id_t PlayerStateHandler::QueryKNearest(
+	physics::Vector2D center,
+	int64_t k,
+	UNIT_FILTER filter,
+	std::vector<ActorType> types,
+	double max_distance
+) {
+	list_act_id_t result;
+	GetSpatialIndex().QueryKNearest(center, k, filter, types, max_distance, result);
+	return result;
+}
+
+list_act_id_t PlayerStateHandler::QueryBox(
+	physics::Vector2D min_corner,
+	physics::Vector2D max_corner,
+	UNIT_FILTER filter
+) {
+	list_act_id_t result;
+	GetSpatialIndex().QueryBox(min_corner, max_corner, filter, result);
+	return result;
+}
+
 int64_t PlayerStateHandler::GetScore() {
 	return state->GetScores()[player_id];
 }
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "player_state_handler/spatial_index.h"
+
+namespace state {
+
+SpatialIndex::SpatialIndex()
+	: cell_size(1),
+	columns(1),
+	version(-1),
+	cell_starts(2, 0) {}
+
+int64_t SpatialIndex::CellOf(double coordinate) const {
+	auto cell = static_cast<int64_t>(std::floor(coordinate / cell_size));
+	return std::min(std::max(cell, (int64_t) 0), columns - 1);
+}
+
+bool SpatialIndex::Matches(const SpatialEntry& entry, UNIT_FILTER filter) {
+	switch (filter) {
+	case OWN_UNITS:
+		return !entry.is_enemy;
+	case ENEMY_UNITS:
+		return entry.is_enemy;
+	default:
+		return true;
+	}
+}
+
+void SpatialIndex::Clear() {
+	pending.clear();
+}
+
+void SpatialIndex::Add(const SpatialEntry& entry) {
+	pending.push_back(entry);
+}
+
+void SpatialIndex::Build(double map_size, double cell_size, int64_t version) {
+	this->cell_size = std::max(cell_size, 1.0);
+	this->version = version;
+	columns = std::max((int64_t) 1,
+		static_cast<int64_t>(std::ceil(map_size / this->cell_size)));
+
+	// Counting sort of the units by cell
+	cell_starts.assign(columns * columns + 1, 0);
+	for (auto& entry : pending) {
+		cell_starts[CellOf(entry.y) * columns + CellOf(entry.x) + 1]++;
+	}
+	for (int64_t i = 1; i < static_cast<int64_t>(cell_starts.size()); ++i) {
+		cell_starts[i] += cell_starts[i - 1];
+	}
+
+	entries.resize(pending.size());
+	for (auto& entry : pending) {
+		auto cell = CellOf(entry.y) * columns + CellOf(entry.x);
+		// cell_starts[cell] is used as the cursor, and ends up at the
+		// start of the next cell
+		entries[cell_starts[cell]++] = entry;
+	}
+	for (int64_t i = cell_starts.size() - 1; i > 0; --i) {
+		cell_starts[i] = cell_starts[i - 1];
+	}
+	cell_starts[0] = 0;
+}
+
+int64_t SpatialIndex::GetVersion() const {
+	return version;
+}
+
+void SpatialIndex::QueryRadius(
+	physics::Vector2D center,
+	double radius,
+	UNIT_FILTER filter,
+	list_act_id_t& result
+) const {
+	result.clear();
+	auto radius_squared = radius * radius;
+
+	for (auto row = CellOf(center.y - radius); row <= CellOf(center.y + radius); ++row) {
+		for (auto column = CellOf(center.x - radius); column <= CellOf(center.x + radius); ++column) {
+			auto cell = row * columns + column;
+			for (auto i = cell_starts[cell]; i < cell_starts[cell + 1]; ++i) {
+				auto& entry = entries[i];
+				auto dx = entry.x - center.x;
+				auto dy = entry.y - center.y;
+				if (Matches(entry, filter) && dx * dx + dy * dy <= radius_squared) {
+					result.push_back(entry.id);
+				}
+			}
+		}
+	}
+}
+
+void SpatialIndex::QueryBox(
+	physics::Vector2D min_corner,
+	physics::Vector2D max_corner,
+	UNIT_FILTER filter,
+	list_act_id_t& result
+) const {
+	result.clear();
+
+	for (auto row = CellOf(min_corner.y); row <= CellOf(max_corner.y); ++row) {
+		for (auto column = CellOf(min_corner.x); column <= CellOf(max_corner.x); ++column) {
+			auto cell = row * columns + column;
+			for (auto i = cell_starts[cell]; i < cell_starts[cell + 1]; ++i) {
+				auto& entry = entries[i];
+				if (Matches(entry, filter) &&
+					entry.x >= min_corner.x && entry.x <= max_corner.x &&
+					entry.y >= min_corner.y && entry.y <= max_corner.y) {
+					result.push_back(entry.id);
+				}
+			}
+		}
+	}
+}
+
+void SpatialIndex::QueryKNearest(
+	physics::Vector2D center,
+	int64_t k,
+	UNIT_FILTER filter,
+	const std::vector<ActorType>& types,
+	double max_distance,
+	list_act_id_t& result
+) const {
+	result.clear();
+	if (k <= 0) {
+		return;
+	}
+
+	auto max_distance_squared = max_distance * max_distance;
+	auto center_row = CellOf(center.y);
+	auto center_column = CellOf(center.x);
+	auto last_ring = std::max(
+		std::max(center_row, columns - 1 - center_row),
+		std::max(center_column, columns - 1 - center_column)
+	);
+
+	// (squared distance, ID) of every unit found so far
+	std::vector<std::pair<double, act_id_t> > found;
+
+	auto visit = [&](int64_t row, int64_t column) {
+		if (row < 0 || row >= columns || column < 0 || column >= columns) {
+			return;
+		}
+		auto cell = row * columns + column;
+		for (auto i = cell_starts[cell]; i < cell_starts[cell + 1]; ++i) {
+			auto& entry = entries[i];
+			if (!Matches(entry, filter) || (!types.empty() &&
+				std::find(types.begin(), types.end(), entry.actor_type) == types.end())) {
+				continue;
+			}
+			auto dx = entry.x - center.x;
+			auto dy = entry.y - center.y;
+			auto distance_squared = dx * dx + dy * dy;
+			if (distance_squared <= max_distance_squared) {
+				found.emplace_back(distance_squared, entry.id);
+			}
+		}
+	};
+
+	for (int64_t ring = 0; ring <= last_ring; ++ring) {
+		if (ring == 0) {
+			visit(center_row, center_column);
+		}
+		else {
+			for (auto column = center_column - ring; column <= center_column + ring; ++column) {
+				visit(center_row - ring, column);
+				visit(center_row + ring, column);
+			}
+			for (auto row = center_row - ring + 1; row <= center_row + ring - 1; ++row) {
+				visit(row, center_column - ring);
+				visit(row, center_column + ring);
+			}
+		}
+
+		// Every cell not looked at yet is at least this far from the center
+		auto reached = ring * cell_size;
+		if (reached >= max_distance) {
+			break;
+		}
+		if (static_cast<int64_t>(found.size()) >= k) {
+			std::nth_element(found.begin(), found.begin() + (k - 1), found.end());
+			if (found[k - 1].first <= reached * reached) {
+				break;
+			}
+		}
+	}
+
+	auto count = std::min((int64_t) found.size(), k);
+	std::partial_sort(found.begin(), found.begin() + count, found.end());
+	for (int64_t i = 0; i < count; ++i) {
+		result.push_back(found[i].second);
+	}
+}
+
+}
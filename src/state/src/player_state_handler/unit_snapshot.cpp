@@ -0,0 +1,87 @@
+#include "player_state_handler/unit_snapshot.h"
+#include "actor/king.h"
+#include "path_planner/path_planner_helper.h"
+
+namespace state {
+
+UnitSnapshot::UnitSnapshot()
+	: own_count(0),
+	version(-1) {}
+
+void UnitSnapshot::Clear() {
+	own_count = 0;
+	version = -1;
+	ids.clear();
+	actor_types.clear();
+	position_x.clear();
+	position_y.clear();
+	velocity_x.clear();
+	velocity_y.clear();
+	hp.clear();
+	max_hp.clear();
+	size.clear();
+	attack_range.clear();
+	attack_targets.clear();
+	flags.clear();
+	rows.assign(rows.size(), -1);
+}
+
+int64_t UnitSnapshot::Size() const {
+	return ids.size();
+}
+
+void UnitSnapshot::Add(Actor * actor, bool is_enemy) {
+	if (actor->GetId() >= static_cast<int64_t>(rows.size()))
+		rows.resize(actor->GetId() + 1, -1);
+	rows[actor->GetId()] = ids.size();
+
+	ids.push_back(actor->GetId());
+	actor_types.push_back(actor->GetActorType());
+	auto position = actor->GetPosition();
+	position_x.push_back(position.x);
+	position_y.push_back(position.y);
+	hp.push_back(actor->GetHp());
+	size.push_back(actor->GetSize());
+
+	uint8_t unit_flags = 0;
+	if (actor->CanAttack())
+		unit_flags |= UNIT_CAN_ATTACK;
+	if (actor->CanPathPlan())
+		unit_flags |= UNIT_CAN_PATH_PLAN;
+	if (actor->GetActorType() == ActorType::KING &&
+		static_cast<King*>(actor)->HasFlag())
+		unit_flags |= UNIT_HAS_FLAG;
+
+	if (is_enemy) {
+		unit_flags |= UNIT_IS_ENEMY;
+		velocity_x.push_back(0);
+		velocity_y.push_back(0);
+		max_hp.push_back(0);
+		attack_range.push_back(0);
+		attack_targets.push_back(-1);
+		flags.push_back(unit_flags);
+		return;
+	}
+
+	auto velocity = actor->GetVelocity();
+	velocity_x.push_back(velocity.x);
+	velocity_y.push_back(velocity.y);
+	max_hp.push_back(actor->GetMaxHp());
+	attack_range.push_back(actor->GetAttackRange());
+	auto target = actor->GetAttackTarget();
+	attack_targets.push_back(target ? target->GetId() : -1);
+
+	if (actor->IsUnderAttack())
+		unit_flags |= UNIT_UNDER_ATTACK;
+	auto path_planner_helper = actor->GetPathPlannerHelper();
+	if (actor->CanPathPlan() && path_planner_helper &&
+		path_planner_helper->IsPathPlanning())
+		unit_flags |= UNIT_PATH_PLANNING;
+	if (actor->IsDead())
+		unit_flags |= UNIT_DEAD;
+	flags.push_back(unit_flags);
+
+	own_count++;
+}
+
+}
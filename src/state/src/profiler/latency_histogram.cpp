@@ -0,0 +1,133 @@
+#include "profiler/latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace state {
+
+int64_t LatencyHistogram::BucketIndex(int64_t value) {
+	if (value < 2 * SUB_BUCKET_HALF) {
+		return value;
+	}
+	int64_t msb = 63 - __builtin_clzll(value);
+	int64_t shift = msb - SUB_BUCKET_BITS + 1;
+	return shift * SUB_BUCKET_HALF + (value >> shift);
+}
+
+int64_t LatencyHistogram::BucketLowerBound(int64_t index) {
+	if (index < 2 * SUB_BUCKET_HALF) {
+		return index;
+	}
+	int64_t shift = index / SUB_BUCKET_HALF - 1;
+	return (index - shift * SUB_BUCKET_HALF) << shift;
+}
+
+LatencyHistogram::LatencyHistogram() :
+	counts(BucketIndex(INT64_MAX) + 1, 0),
+	total_count(0),
+	total_sum(0),
+	total_sum_squares(0),
+	min_value(0),
+	max_value(0) {}
+
+void LatencyHistogram::Record(int64_t value) {
+	value = std::max((int64_t) 0, value);
+	counts[BucketIndex(value)]++;
+	if (total_count == 0 || value < min_value) {
+		min_value = value;
+	}
+	if (value > max_value) {
+		max_value = value;
+	}
+	total_count++;
+	total_sum += value;
+	total_sum_squares += (double) value * value;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+	if (other.total_count == 0) {
+		return;
+	}
+	for (int64_t i = 0; i < static_cast<int64_t>(counts.size()); ++i) {
+		counts[i] += other.counts[i];
+	}
+	if (total_count == 0 || other.min_value < min_value) {
+		min_value = other.min_value;
+	}
+	max_value = std::max(max_value, other.max_value);
+	total_count += other.total_count;
+	total_sum += other.total_sum;
+	total_sum_squares += other.total_sum_squares;
+}
+
+void LatencyHistogram::Reset() {
+	std::fill(counts.begin(), counts.end(), 0);
+	total_count = 0;
+	total_sum = 0;
+	total_sum_squares = 0;
+	min_value = max_value = 0;
+}
+
+int64_t LatencyHistogram::GetCount() const {
+	return total_count;
+}
+
+int64_t LatencyHistogram::GetMin() const {
+	return min_value;
+}
+
+int64_t LatencyHistogram::GetMax() const {
+	return max_value;
+}
+
+double LatencyHistogram::GetMean() const {
+	if (total_count == 0) {
+		return 0;
+	}
+	return total_sum / total_count;
+}
+
+double LatencyHistogram::GetStdDev() const {
+	if (total_count == 0) {
+		return 0;
+	}
+	double mean = GetMean();
+	return std::sqrt(std::max(0.0, total_sum_squares / total_count - mean * mean));
+}
+
+int64_t LatencyHistogram::GetPercentile(double percentile) const {
+	if (total_count == 0) {
+		return 0;
+	}
+	percentile = std::min(100.0, std::max(0.0, percentile));
+	int64_t rank = std::max((int64_t) 1,
+		(int64_t) (percentile / 100 * total_count + 0.5));
+	int64_t seen = 0;
+	for (int64_t i = 0; i < static_cast<int64_t>(counts.size()); ++i) {
+		seen += counts[i];
+		if (seen >= rank) {
+			// Report the middle of the bucket, clamped to what was seen
+			int64_t low = BucketLowerBound(i);
+			int64_t high = i + 1 < static_cast<int64_t>(counts.size()) ? BucketLowerBound(i + 1)
+				: max_value;
+			int64_t value = low + (high - low) / 2;
+			return std::min(max_value, std::max(min_value, value));
+		}
+	}
+	return max_value;
+}
+
+void LatencyHistogram::Print(std::ostream& out, const std::string& name) const {
+	const double NS_PER_MS = 1e6;
+	std::ios::fmtflags flags(out.flags());
+	out << std::fixed << std::setprecision(3)
+		<< name << ": count=" << total_count
+		<< " mean=" << GetMean() / NS_PER_MS << "ms"
+		<< " stddev=" << GetStdDev() / NS_PER_MS << "ms"
+		<< " p50=" << GetPercentile(50) / NS_PER_MS << "ms"
+		<< " p99=" << GetPercentile(99) / NS_PER_MS << "ms"
+		<< " max=" << max_value / NS_PER_MS << "ms" << std::endl;
+	out.flags(flags);
+}
+
+}
@@ -0,0 +1,58 @@
+#include "profiler/tick_profiler.h"
+
+namespace state {
+
+/**
+ * Names printed for each phase, in TICK_PHASE order
+ */
+static const char * PHASE_NAMES[TICK_PHASE_COUNT] = {
+	"Tick",
+	"MergeWithBuffer",
+	"PathPlanner::Update",
+	"Actor updates",
+	"Terrain::Update",
+	"ProjectileHandler::Update",
+	"Influence maps",
+	"MergeWithMain",
+	"StateTransfer"
+};
+
+TickProfiler::TickProfiler() : dump_requested(false) {}
+
+void TickProfiler::Record(TICK_PHASE phase, int64_t duration) {
+	std::lock_guard<std::mutex> lock(histogram_mutex);
+	histograms[phase].Record(duration);
+}
+
+void TickProfiler::Print(std::ostream& out) {
+	std::lock_guard<std::mutex> lock(histogram_mutex);
+	for (int64_t i = 0; i < TICK_PHASE_COUNT; ++i) {
+		if (histograms[i].GetCount() > 0) {
+			histograms[i].Print(out, PHASE_NAMES[i]);
+		}
+	}
+}
+
+void TickProfiler::Reset() {
+	std::lock_guard<std::mutex> lock(histogram_mutex);
+	for (auto& histogram : histograms) {
+		histogram.Reset();
+	}
+}
+
+void TickProfiler::RequestDump() {
+	dump_requested = true;
+}
+
+void TickProfiler::DumpIfRequested(std::ostream& out) {
+	if (dump_requested.exchange(false)) {
+		Print(out);
+	}
+}
+
+TickProfiler& TickProfiler::Instance() {
+	static TickProfiler profiler;
+	return profiler;
+}
+
+}
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include "state.h"
+#include "profiler/tick_profiler.h"
 
 namespace state {
 
@@ -9,10 +10,68 @@ void SetIfValid(int * a, int value) {
 	}
 }
 
+/**
+ * Copies an Actor as the type it was made as
+ *
+ * @param[in]  actor  The Actor
+ *
+ * @return     The copy
+ */
+static std::shared_ptr<Actor> CopyActor(const std::shared_ptr<Actor>& actor) {
+	switch (actor->GetActorType()) {
+		case ActorType::MAGICIAN:
+			return std::shared_ptr<Actor>(
+				new Magician(*std::static_pointer_cast<Magician>(actor)));
+		case ActorType::FIREBALL:
+			return std::shared_ptr<Actor>(
+				new FireBall(*std::static_pointer_cast<FireBall>(actor)));
+		case ActorType::BASE:
+			return std::shared_ptr<Actor>(
+				new Base(*std::static_pointer_cast<Base>(actor)));
+		case ActorType::FLAG:
+			return std::shared_ptr<Actor>(
+				new Flag(*std::static_pointer_cast<Flag>(actor)));
+		case ActorType::KING:
+			return std::shared_ptr<Actor>(
+				new King(*std::static_pointer_cast<King>(actor)));
+		case ActorType::SCOUT:
+			return std::shared_ptr<Actor>(
+				new Scout(*std::static_pointer_cast<Scout>(actor)));
+		case ActorType::SWORDSMAN:
+			return std::shared_ptr<Actor>(
+				new Swordsman(*std::static_pointer_cast<Swordsman>(actor)));
+		case ActorType::TOWER:
+			return std::shared_ptr<Actor>(
+				new Tower(*std::static_pointer_cast<Tower>(actor)));
+	}
+	return nullptr;
+}
+
+/**
+ * Points a list of Actors at the Actors with the same IDs in another list
+ *
+ * @param      list    The list
+ * @param[in]  actors  The Actors to point at, indexed by Actor ID
+ *
+ * @tparam     T       The type of the Actors in the list
+ */
+template <typename T>
+static void PointAtActors(
+	std::vector<std::shared_ptr<T> >& list,
+	const std::vector<std::shared_ptr<Actor> >& actors
+) {
+	for (auto& actor : list) {
+		actor = std::static_pointer_cast<T>(actors[actor->GetId()]);
+	}
+}
+
 State::State()
 	: projectile_handler(actors.size()),
 	path_planner(1),
-	terrain(1) {}
+	terrain(1),
+	los_update_interval(1),
+	ticks_since_los_update(0),
+	version(0) {}
 
 State::State(
 		Terrain terrain,
@@ -24,7 +83,10 @@ State::State(
 	terrain(terrain),
 	flag_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)),
 	base_poisoning_penalty(std::vector<int64_t>(LAST_PLAYER+1, 0)),
-	tower_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)) {}
+	tower_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)),
+	los_update_interval(1),
+	ticks_since_los_update(0),
+	version(0) {}
 
 State::State(
 		Terrain terrain,
@@ -50,7 +112,10 @@ State::State(
 	terrain(terrain),
 	flag_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)),
 	base_poisoning_penalty(std::vector<int64_t>(LAST_PLAYER+1, 0)),
-	tower_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)) {
+	tower_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)),
+	los_update_interval(1),
+	ticks_since_los_update(0),
+	version(0) {
 		for (int64_t i = 0; i <= LAST_PLAYER; i++) {
 			list_act_id_t l;
 			for (auto actor: sorted_actors[i])
@@ -84,7 +149,42 @@ State::State(
 	terrain(terrain),
 	flag_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)),
 	base_poisoning_penalty(std::vector<int64_t>(LAST_PLAYER+1, 0)),
-	tower_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)) {}
+	tower_capture_score(std::vector<int64_t>(LAST_PLAYER+1, 0)),
+	los_update_interval(1),
+	ticks_since_los_update(0),
+	version(0) {}
+
+std::unique_ptr<State> State::Clone() const {
+	std::unique_ptr<State> clone(new State(*this));
+	for (auto& actor : clone->actors) {
+		actor = CopyActor(actor);
+	}
+
+	PointAtActors(clone->kings, clone->actors);
+	PointAtActors(clone->bases, clone->actors);
+	PointAtActors(clone->flags, clone->actors);
+	for (int64_t i = 0; i < static_cast<int64_t>(sorted_actors.size()); ++i) {
+		PointAtActors(clone->sorted_actors[i], clone->actors);
+	}
+	for (int64_t i = 0; i < static_cast<int64_t>(towers.size()); ++i) {
+		PointAtActors(clone->towers[i], clone->actors);
+	}
+	for (int64_t i = 0; i < static_cast<int64_t>(magicians.size()); ++i) {
+		PointAtActors(clone->magicians[i], clone->actors);
+	}
+	for (int64_t i = 0; i < static_cast<int64_t>(swordsmen.size()); ++i) {
+		PointAtActors(clone->swordsmen[i], clone->actors);
+	}
+	for (int64_t i = 0; i < static_cast<int64_t>(scouts.size()); ++i) {
+		PointAtActors(clone->scouts[i], clone->actors);
+	}
+
+	// The copies still point at this state's Actors, targets, leaders,
+	// formations and projectiles included. Merging points them at the
+	// clone's own
+	clone->MergeWithMain(*this);
+	return clone;
+}
 
 std::shared_ptr<Actor> State::GetActorFromId(
 		PlayerId player_id,
@@ -105,7 +205,7 @@ std::shared_ptr<Actor> State::GetActorFromId(
 	return actors[actor_id];
 }
 
-std::vector<std::shared_ptr<Actor> > State::GetPlayerActors(
+const std::vector<std::shared_ptr<Actor> >& State::GetPlayerActors(
 	PlayerId player_id
 ) {
 	return sorted_actors[player_id];
@@ -256,13 +356,15 @@ list_act_id_t State::GetPlayerUnitIds(PlayerId player_id) {
 	return player_unit_ids[(int)player_id];
 }
 
-std::vector<std::shared_ptr<Magician> > State::GetMagicians(
+const std::vector<std::shared_ptr<Magician> >& State::GetMagicians(
 	PlayerId player_id
 ) {
 	return magicians[player_id];
 }
 
-std::vector<std::shared_ptr<Scout> > State::GetScouts(PlayerId player_id) {
+const std::vector<std::shared_ptr<Scout> >& State::GetScouts(
+	PlayerId player_id
+) {
 	return scouts[player_id];
 }
 
@@ -271,7 +373,7 @@ std::vector<std::shared_ptr<Scout> > State::GetEnemyScouts(
 ) {
 	auto grid_element_size =
 		terrain.CoordinateToTerrainElement(physics::Vector2D(0,0)).GetSize();
-	auto enemy_scouts = scouts[(player_id + 1) % (LAST_PLAYER + 1)];
+	auto& enemy_scouts = scouts[(player_id + 1) % (LAST_PLAYER + 1)];
 	std::vector<std::shared_ptr<Scout> > visible_enemy_scouts;
 	for (auto scout : enemy_scouts) {
 		if (!scout->IsDead() &&
@@ -298,7 +400,7 @@ std::vector<std::shared_ptr<Scout> > State::GetEnemyScouts(
 std::vector<std::shared_ptr<Magician> > State::GetEnemyMagicians(
 	PlayerId player_id
 ) {
-	auto enemy_magicians = magicians[(player_id + 1) % (LAST_PLAYER + 1)];
+	auto& enemy_magicians = magicians[(player_id + 1) % (LAST_PLAYER + 1)];
 	std::vector<std::shared_ptr<Magician> > visible_enemy_magicians;
 	for (auto magician : enemy_magicians) {
 		if (!magician->IsDead() &&
@@ -309,7 +411,7 @@ std::vector<std::shared_ptr<Magician> > State::GetEnemyMagicians(
 	return visible_enemy_magicians;
 }
 
-std::vector<std::shared_ptr<Swordsman> > State::GetSwordsmen(
+const std::vector<std::shared_ptr<Swordsman> >& State::GetSwordsmen(
 	PlayerId player_id
 ) {
 	return swordsmen[player_id];
@@ -318,7 +420,7 @@ std::vector<std::shared_ptr<Swordsman> > State::GetSwordsmen(
 std::vector<std::shared_ptr<Swordsman> > State::GetEnemySwordsmen(
 	PlayerId player_id
 ) {
-	auto enemy_swordsmen = swordsmen[(player_id + 1) % (LAST_PLAYER + 1)];
+	auto& enemy_swordsmen = swordsmen[(player_id + 1) % (LAST_PLAYER + 1)];
 	std::vector<std::shared_ptr<Swordsman> > visible_enemy_swordsmen;
 	for (auto swordsman : enemy_swordsmen) {
 		if (!swordsman->IsDead() &&
@@ -329,7 +431,7 @@ std::vector<std::shared_ptr<Swordsman> > State::GetEnemySwordsmen(
 	return visible_enemy_swordsmen;
 }
 
-std::vector<std::shared_ptr<Tower> > State::GetTowers(
+const std::vector<std::shared_ptr<Tower> >& State::GetTowers(
 	PlayerId player_id
 ) {
 	return towers[player_id];
@@ -338,7 +440,7 @@ std::vector<std::shared_ptr<Tower> > State::GetTowers(
 std::vector<std::shared_ptr<Tower> > State::GetEnemyTowers(
 	PlayerId player_id
 ) {
-	auto enemy_towers = towers[(player_id + 1) % (LAST_PLAYER + 1)];
+	auto& enemy_towers = towers[(player_id + 1) % (LAST_PLAYER + 1)];
 	std::vector<std::shared_ptr<Tower> > visible_enemy_towers;
 	for (auto tower : enemy_towers) {
 		auto los = terrain.CoordinateToTerrainElement(tower->GetPosition()).GetLos(player_id);
@@ -625,7 +727,7 @@ bool CompareActorsByXCoordinate(
 	return (a->GetPosition().x < b->GetPosition().x);
 }
 
-Terrain State::GetTerrain() {
+Terrain& State::GetTerrain() {
 	return terrain;
 }
 
@@ -648,16 +750,29 @@ list_act_id_t State::GetActorEnemies(PlayerId player_id, act_id_t actor_id) {
 	return enemies;
 }
 
-list_act_id_t State::GetPlayerEnemyIds(PlayerId player_id) {
-	list_act_id_t all_enemies;
+void State::UpdateVisibleEnemies(PlayerId player_id) {
+	if (player_visible_enemy_versions.size() <= LAST_PLAYER) {
+		player_visible_enemy_unit_ids.resize(LAST_PLAYER + 1);
+		player_visible_enemy_flags.resize(LAST_PLAYER + 1);
+		player_visible_enemy_versions.resize(LAST_PLAYER + 1, -1);
+	}
+	if (player_visible_enemy_versions[player_id] == version) {
+		return;
+	}
+
+	auto& all_enemies = player_visible_enemy_unit_ids[player_id];
+	auto& is_visible = player_visible_enemy_flags[player_id];
+	all_enemies.clear();
+	is_visible.assign(actors.size(), false);
+
 	for (int pid = 0; pid <= LAST_PLAYER; pid++)
 		if (pid != player_id) {
-			for (auto actor : sorted_actors[pid]) {
-				auto te = terrain.CoordinateToTerrainElement(actor->GetPosition());
+			for (auto& actor : sorted_actors[pid]) {
 				if (!actor->IsDead() &&
-					te.GetLos(player_id) == DIRECT_LOS &&
 					actor->GetActorType() != ActorType::SCOUT &&
-					actor->GetActorType() != ActorType::TOWER)
+					actor->GetActorType() != ActorType::TOWER &&
+					terrain.CoordinateToTerrainElement(actor->GetPosition())
+					       .GetLos(player_id) == DIRECT_LOS)
 						all_enemies.push_back(actor->GetId());
 				}
 			}
@@ -665,7 +780,92 @@ list_act_id_t State::GetPlayerEnemyIds(PlayerId player_id) {
 		all_enemies.push_back(scout->GetId());
 	for (auto tower : GetEnemyTowers(player_id))
 		all_enemies.push_back(tower->GetId());
-	return all_enemies;
+
+	for (auto id : all_enemies)
+		is_visible[id] = true;
+
+	player_visible_enemy_versions[player_id] = version;
+}
+
+const list_act_id_t& State::GetPlayerEnemyIds(PlayerId player_id) {
+	UpdateVisibleEnemies(player_id);
+	return player_visible_enemy_unit_ids[player_id];
+}
+
+bool State::IsVisibleEnemy(PlayerId player_id, act_id_t actor_id) {
+	UpdateVisibleEnemies(player_id);
+	auto& is_visible = player_visible_enemy_flags[player_id];
+	return actor_id >= 0 && actor_id < static_cast<int64_t>(is_visible.size())
+		&& is_visible[actor_id];
+}
+
+const std::vector<bool>& State::GetVisibleEnemyFlags(PlayerId player_id) {
+	UpdateVisibleEnemies(player_id);
+	return player_visible_enemy_flags[player_id];
+}
+
+void State::UpdateInfluenceMaps() {
+	auto rows = terrain.GetRows();
+	auto element_size =
+		terrain.CoordinateToTerrainElement(physics::Vector2D(0, 0)).GetSize();
+	if (influence_maps.empty()) {
+		influence_maps.assign(LAST_PLAYER + 1, std::vector<InfluenceMap>(
+			LAST_INFLUENCE_TYPE + 1, InfluenceMap(rows)));
+	}
+
+	for (auto& actor : actors) {
+		auto id = actor->GetId();
+		auto position = actor->GetPosition();
+		int64_t row = std::min(std::max((int64_t) position.x / element_size,
+			(int64_t) 0), rows - 1);
+		int64_t column = std::min(std::max((int64_t) position.y / element_size,
+			(int64_t) 0), rows - 1);
+		int64_t cell = actor->IsDead() ? -1 : row * rows + column;
+
+		int64_t hp = actor->GetHp();
+		int64_t dps = 0;
+		if (actor->CanAttack() && actor->GetAttackSpeed() > 0) {
+			dps = actor->GetAttack() * 1000 / actor->GetAttackSpeed();
+		}
+
+		for (int64_t i = 0; i <= LAST_PLAYER; ++i) {
+			auto player_id = static_cast<PlayerId>(i);
+			auto& player_maps = influence_maps[i];
+			if (actor->GetPlayerId() == player_id) {
+				player_maps[ALLY_HP].Set(id, cell, hp);
+				player_maps[ENEMY_HP].Set(id, -1, 0);
+				player_maps[ENEMY_DPS].Set(id, -1, 0);
+			}
+			else {
+				auto visible_cell = IsVisibleEnemy(player_id, id) ? cell : -1;
+				player_maps[ALLY_HP].Set(id, -1, 0);
+				player_maps[ENEMY_HP].Set(id, visible_cell, hp);
+				player_maps[ENEMY_DPS].Set(id, visible_cell, dps);
+			}
+		}
+	}
+}
+
+const InfluenceMap& State::GetInfluenceMap(
+	PlayerId player_id,
+	INFLUENCE_TYPE influence_type
+) {
+	if (influence_maps.empty()) {
+		UpdateInfluenceMaps();
+	}
+	return influence_maps[player_id][influence_type];
+}
+
+int64_t State::GetVersion() {
+	return version;
+}
+
+void State::SetWorkerPool(std::shared_ptr<WorkerPool> worker_pool) {
+	this->worker_pool = worker_pool;
+}
+
+void State::SetLosUpdateInterval(int64_t los_update_interval) {
+	this->los_update_interval = std::max((int64_t) 1, los_update_interval);
 }
 
 void State::Update(float delta_time) {
@@ -677,7 +877,10 @@ void State::Update(float delta_time) {
 		);
 	}
 
-	path_planner.Update(sorted_actors);
+	{
+		PROFILE_TICK_PHASE(PATH_PLANNER_UPDATE);
+		path_planner.Update(sorted_actors);
+	}
 
 	for (auto actor: actors) {
 		actor->SetIsUnderAttack(false);
@@ -695,49 +898,80 @@ void State::Update(float delta_time) {
 				target->SetIsUnderAttack(true);
 			}
 		}
+	}
 
-		if (actor->GetActorType() == ActorType::TOWER) {
-			std::shared_ptr<Tower> tower = std::static_pointer_cast<Tower>(actor);
-			if (tower->IsDead()) {
-				auto pid = (int)tower->GetTowerOwner();
-				if (tower->Contend(delta_time, sorted_actors)) {
-					int64_t i;
-					auto prev_pid = (int) tower->GetPrevTowerOwner();
-					for (i = 0; i < towers[prev_pid].size(); ++i) {
-						if (towers[prev_pid][i]->GetId() == tower->GetId()) {
-							break;
+	{
+		PROFILE_TICK_PHASE(ACTOR_UPDATE);
+		// Each Actor only changes itself here, so they can be updated
+		// in any order, on any thread
+		auto decide = [this, delta_time](int64_t begin, int64_t end) {
+			for (int64_t i = begin; i < end; ++i) {
+				actors[i]->Update(delta_time);
+			}
+		};
+		ParallelFor(worker_pool.get(), actors.size(), decide);
+
+		for (auto actor : actors) {
+			actor->Commit(delta_time);
+			actor->CheckBounds(terrain.GetSize());
+
+			if (actor->GetActorType() == ActorType::TOWER) {
+				std::shared_ptr<Tower> tower = std::static_pointer_cast<Tower>(actor);
+				if (tower->IsDead()) {
+					auto pid = (int)tower->GetTowerOwner();
+					if (tower->Contend(delta_time, sorted_actors)) {
+						int64_t i;
+						auto prev_pid = (int) tower->GetPrevTowerOwner();
+						for (i = 0; i < towers[prev_pid].size(); ++i) {
+							if (towers[prev_pid][i]->GetId() == tower->GetId()) {
+								break;
+							}
 						}
-					}
-					towers[prev_pid].erase(towers[prev_pid].begin() + i);
+						towers[prev_pid].erase(towers[prev_pid].begin() + i);
 
-					for (i = 0; i < sorted_actors[prev_pid].size(); ++i) {
-						if (sorted_actors[prev_pid][i]->GetId() == tower->GetId()) {
-							break;
+						for (i = 0; i < sorted_actors[prev_pid].size(); ++i) {
+							if (sorted_actors[prev_pid][i]->GetId() == tower->GetId()) {
+								break;
+							}
 						}
-					}
-					sorted_actors[prev_pid].erase(sorted_actors[prev_pid].begin() + i);
+						sorted_actors[prev_pid].erase(sorted_actors[prev_pid].begin() + i);
 
-					auto id = actor->GetPlayerId();
-					sorted_actors[id].push_back(actor);
-					towers[id].push_back(tower);
+						auto id = actor->GetPlayerId();
+						sorted_actors[id].push_back(actor);
+						towers[id].push_back(tower);
+					}
 				}
 			}
 		}
-		actor->Update(delta_time);
-		actor->CheckBounds(terrain.GetSize());
 	}
 
 	for (int64_t i = 0; i <= LAST_PLAYER; i++) {
 		base_poisoning_penalty[i] += bases[i]->GetBasePoisonPenalty(sorted_actors);
 	}
 
-	terrain.Update(sorted_actors);
+	{
+		PROFILE_TICK_PHASE(TERRAIN_UPDATE);
+		if (++ticks_since_los_update >= los_update_interval) {
+			terrain.Update(sorted_actors, worker_pool.get());
+			ticks_since_los_update = 0;
+		}
+	}
 
-	projectile_handler.Update(delta_time, towers, magicians, &terrain);
+	{
+		PROFILE_TICK_PHASE(PROJECTILE_HANDLER_UPDATE);
+		projectile_handler.Update(delta_time, towers, magicians, &terrain);
+	}
 
 	for (int64_t i = 0; i <= LAST_PLAYER; ++i) {
 		tower_capture_score[i] += towers[i].size();
 	}
+
+	version++;
+
+	{
+		PROFILE_TICK_PHASE(INFLUENCE_UPDATE);
+		UpdateInfluenceMaps();
+	}
 }
 
 void State::MergeWithBuffer(const State& state, PlayerId player_id) {
@@ -762,6 +996,8 @@ void State::MergeWithBuffer(const State& state, PlayerId player_id) {
 	);
 
 	flag_capture_score[player_id] = state.flag_capture_score[player_id];
+
+	version++;
 }
 
 void State::MergeWithMain(const State& state) {
@@ -789,11 +1025,23 @@ void State::MergeWithMain(const State& state) {
 
 	path_planner.MergeWithMain(state.path_planner, actors);
 	terrain.MergeWithMain(state.terrain);
+	if (influence_maps.size() != state.influence_maps.size()) {
+		influence_maps = state.influence_maps;
+	}
+	else {
+		for (int64_t i = 0; i < static_cast<int64_t>(influence_maps.size()); ++i) {
+			for (int64_t j = 0; j <= LAST_INFLUENCE_TYPE; ++j) {
+				influence_maps[i][j].MergeWithMain(state.influence_maps[i][j]);
+			}
+		}
+	}
 	projectile_handler.MergeWithMain(state.projectile_handler, actors);
 
 	flag_capture_score = state.flag_capture_score;
 	base_poisoning_penalty = state.base_poisoning_penalty;
 	tower_capture_score = state.tower_capture_score;
+
+	version++;
 }
 
 }
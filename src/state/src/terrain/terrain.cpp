@@ -1,9 +1,31 @@
 #include <terrain/terrain.h>
+#include <algorithm>
 #include <cmath>
-#include <queue>
 
 namespace state {
 
+/**
+ * Number of grid rows each player's LOS update is split into
+ *
+ * Small maps are updated one player at a time
+ */
+static const int64_t LOS_BAND_ROWS = 64;
+
+/**
+ * Gets the largest LOS multiplier between any two terrain types
+ *
+ * @return     The largest multiplier
+ */
+static float MaxMultiplier() {
+	float max_multiplier = 0;
+	for (auto &row : Multiplier) {
+		for (auto multiplier : row) {
+			max_multiplier = std::max(max_multiplier, multiplier);
+		}
+	}
+	return max_multiplier;
+}
+
 LosListEntry::LosListEntry(physics::Vector2D offset, float score)
 	: offset(offset), score(score) {}
 
@@ -12,7 +34,7 @@ bool LosListEntry::operator<(const LosListEntry& rhs) {
 }
 
 Terrain::Terrain(std::vector<std::vector<TerrainElement> > grid)
-	: row_size(grid.size()), grid(grid) {
+	: row_size(grid.size()), grid(std::move(grid)), los_version(0) {
 	adjacent_neighbours = std::vector<physics::Vector2D>({
 		physics::Vector2D(0,1),
 		physics::Vector2D(1,0),
@@ -27,7 +49,24 @@ Terrain::Terrain(std::vector<std::vector<TerrainElement> > grid)
 	});
 }
 
-Terrain::Terrain(int64_t nrows) {
+Terrain::Terrain(int64_t nrows, const uint8_t* types, int64_t element_size)
+	: Terrain(std::vector<std::vector<TerrainElement> >()) {
+	row_size = nrows;
+	grid.resize(nrows);
+	for (int64_t row = 0; row < nrows; ++row) {
+		grid[row].reserve(nrows);
+		for (int64_t col = 0; col < nrows; ++col) {
+			uint8_t type = types[row * nrows + col];
+			grid[row].emplace_back(
+				type <= MOUNTAIN ? static_cast<TERRAIN_TYPE>(type) : PLAIN,
+				physics::Vector2D(row * element_size, col * element_size),
+				element_size
+			);
+		}
+	}
+}
+
+Terrain::Terrain(int64_t nrows) : los_version(0) {
 	row_size = nrows;
 	grid.resize(nrows);
 	for (auto row:grid)
@@ -64,6 +103,58 @@ int64_t Terrain::GetRows() {
 	return row_size;
 }
 
+int64_t Terrain::GetLosVersion() {
+	return los_version;
+}
+
+void Terrain::CopyGrids(
+	PlayerId player_id,
+	uint8_t * terrain_types,
+	uint8_t * los_types
+) {
+	for (int64_t i = 0; i < row_size; ++i) {
+		for (int64_t j = 0; j < row_size; ++j) {
+			auto& element = grid[i][j];
+			auto los = element.GetLos(player_id);
+			if (terrain_types) {
+				terrain_types[i * row_size + j] =
+					los == UNEXPLORED ? UNDEFINED : element.GetTerrainType();
+			}
+			if (los_types) {
+				los_types[i * row_size + j] = los;
+			}
+		}
+	}
+}
+
+void Terrain::GetLosChanges(
+	PlayerId player_id,
+	int64_t since,
+	std::vector<int64_t>& changes
+) {
+	changes.clear();
+	if (since >= los_version || los_changed_at.empty()) {
+		return;
+	}
+
+	// The bands are in row order, so their lists join up in order
+	if (since == los_version - 1) {
+		int64_t bands = los_band_changes.size() / (LAST_PLAYER + 1);
+		for (int64_t band = 0; band < bands; ++band) {
+			auto& band_changes = los_band_changes[player_id * bands + band];
+			changes.insert(changes.end(), band_changes.begin(), band_changes.end());
+		}
+		return;
+	}
+
+	auto& changed_at = los_changed_at[player_id];
+	for (int64_t cell = 0; cell < static_cast<int64_t>(changed_at.size()); ++cell) {
+		if (changed_at[cell] > since) {
+			changes.push_back(cell);
+		}
+	}
+}
+
 std::vector<physics::Vector2D> Terrain::GetAdjacentNeighbours(physics::Vector2D offset, int64_t width) {
 	std::vector<physics::Vector2D> neighbours;
 	double width_offset = (double)width / grid[0][0].GetSize();
@@ -97,65 +188,147 @@ std::vector<physics::Vector2D> Terrain::GetAllNeighbours(physics::Vector2D offse
 	return neighbours;
 }
 
-void Terrain::UpdateLos(
-	physics::Vector2D offset,
-	int64_t radius,
-	LOS_TYPE los,
-	PlayerId pid
+void Terrain::FloodLos(
+	LosSource& source,
+	std::vector<LosListEntry>& queue,
+	std::vector<bool>& visited
 ) {
-	std::vector<std::vector<bool> >visited(
-		row_size,
-		std::vector<bool>(row_size, false)
-	);
-	std::queue<LosListEntry> q;
-	q.push(LosListEntry(offset, radius - 1));
-	visited[offset.y][offset.y] = true;
-	auto neighbours = adjacent_neighbours;
-	while (!q.empty()) {
-		auto top = q.front();
-		q.pop();
-		auto pos = top.offset;
-		grid[pos.x][pos.y].SetLos(los, pid);
-		auto rad = top.score;
+	// Every step costs at least 1 / MaxMultiplier() of the radius,
+	// which bounds how far the flood can reach
+	int64_t reach = (int64_t) std::ceil(
+		std::max((int64_t) 0, source.radius - 1) * MaxMultiplier()) + 1;
+	int64_t first_x = std::max((int64_t) 0, (int64_t) source.offset.x - reach);
+	int64_t last_x = std::min(row_size - 1, (int64_t) source.offset.x + reach);
+	int64_t first_y = std::max((int64_t) 0, (int64_t) source.offset.y - reach);
+	int64_t last_y = std::min(row_size - 1, (int64_t) source.offset.y + reach);
+	int64_t width = last_y - first_y + 1;
+
+	visited.assign((last_x - first_x + 1) * width, false);
+	queue.clear();
+	source.cells.clear();
+	source.min_row = source.max_row = source.offset.x;
+
+	queue.push_back(LosListEntry(source.offset, source.radius - 1));
+	visited[(source.offset.x - first_x) * width + source.offset.y - first_y] = true;
+	for (int64_t head = 0; head < static_cast<int64_t>(queue.size()); ++head) {
+		auto pos = queue[head].offset;
+		auto rad = queue[head].score;
+		source.cells.push_back(pos.x * row_size + pos.y);
+		source.min_row = std::min(source.min_row, (int64_t) pos.x);
+		source.max_row = std::max(source.max_row, (int64_t) pos.x);
+		if (rad <= 0) {
+			continue;
+		}
 		for (auto i : adjacent_neighbours) {
 			auto v = pos + i;
-			if (v.x >= 0 && v.x < row_size && v.y >= 0 && v.y < row_size)
-				if (!visited[v.x][v.y] && rad > 0) {
-					visited[v.x][v.y] = true;
+			if (v.x >= first_x && v.x <= last_x && v.y >= first_y && v.y <= last_y) {
+				int64_t index = (v.x - first_x) * width + v.y - first_y;
+				if (!visited[index]) {
+					visited[index] = true;
 					auto multiplier =
 						Multiplier[grid[pos.x][pos.y].GetTerrainType()]
 								  [grid[v.x][v.y].GetTerrainType()];
-					q.push(LosListEntry(v, rad - (1 / multiplier)));
+					queue.push_back(LosListEntry(v, rad - (1 / multiplier)));
 				}
+			}
 		}
 	}
 }
 
-void Terrain::Update(
-	std::vector<std::vector<std::shared_ptr<Actor> > > actors
+void Terrain::UpdateLosBand(
+	const std::vector<LosSource>& sources,
+	PlayerId pid,
+	int64_t first_row,
+	int64_t last_row,
+	std::vector<int64_t>& changes
 ) {
-	for(int64_t i = 0; i < row_size; i++)
-		for(int64_t j = 0; j < row_size; j++)
-			for(int64_t pid = 0; pid <= LAST_PLAYER; pid++)
-				if (grid[i][j].GetLos(static_cast<PlayerId>(pid)) == DIRECT_LOS) {
-					grid[i][j].SetLos(EXPLORED, static_cast<PlayerId>(pid));
-				}
+	int64_t first_cell = first_row * row_size;
+	std::vector<bool> in_los((last_row - first_row) * row_size, false);
+	for (auto &source : sources) {
+		if (source.player_id != pid || source.max_row < first_row
+			|| source.min_row >= last_row) {
+			continue;
+		}
+		for (auto cell : source.cells) {
+			int64_t row = cell / row_size;
+			if (row >= first_row && row < last_row) {
+				in_los[cell - first_cell] = true;
+			}
+		}
+	}
+
+	auto& changed_at = los_changed_at[pid];
+	changes.clear();
+	for (int64_t i = first_row; i < last_row; i++) {
+		for (int64_t j = 0; j < row_size; j++) {
+			int64_t cell = i * row_size + j;
+			auto los = grid[i][j].GetLos(pid);
+			auto new_los = los;
+			if (in_los[cell - first_cell]) {
+				new_los = DIRECT_LOS;
+			}
+			else if (los == DIRECT_LOS) {
+				new_los = EXPLORED;
+			}
+			if (new_los != los) {
+				grid[i][j].SetLos(new_los, pid);
+				changed_at[cell] = los_version;
+				changes.push_back(cell);
+			}
+		}
+	}
+}
 
+void Terrain::Update(
+	const std::vector<std::vector<std::shared_ptr<Actor> > >& actors,
+	WorkerPool * worker_pool
+) {
+	std::vector<LosSource> sources;
+	int64_t size = grid[0][0].GetSize();
 	for (int64_t i = 0; i <= LAST_PLAYER; i++) {
 		for (auto &actor: actors[i]) {
 			if (!actor->IsDead()) {
 				auto pos = actor->GetPosition();
-				int64_t size = grid[0][0].GetSize();
-				auto offset = physics::Vector2D((int)pos.x/size, (int)pos.y/size);
-				UpdateLos(
-					offset,
-					actor->GetLosRadius(),
-					DIRECT_LOS,
-					static_cast<PlayerId>(i)
-				);
+				LosSource source;
+				source.player_id = static_cast<PlayerId>(i);
+				source.offset = physics::Vector2D((int)pos.x/size, (int)pos.y/size);
+				source.radius = actor->GetLosRadius();
+				sources.push_back(source);
 			}
 		}
 	}
+
+	ParallelFor(worker_pool, sources.size(), [this, &sources](int64_t begin, int64_t end) {
+		std::vector<LosListEntry> queue;
+		std::vector<bool> visited;
+		for (int64_t i = begin; i < end; ++i) {
+			FloodLos(sources[i], queue, visited);
+		}
+	});
+
+	// Players never write to each other's LOS and bands never share a
+	// row, so every (player, band) pair can be updated on its own
+	int64_t bands = (row_size + LOS_BAND_ROWS - 1) / LOS_BAND_ROWS;
+	if (los_changed_at.empty()) {
+		los_changed_at.assign(LAST_PLAYER + 1,
+			std::vector<int64_t>(row_size * row_size, 0));
+		los_band_changes.resize((LAST_PLAYER + 1) * bands);
+	}
+	los_version++;
+	ParallelFor(worker_pool, (LAST_PLAYER + 1) * bands,
+		[this, &sources, bands](int64_t begin, int64_t end) {
+			for (int64_t i = begin; i < end; ++i) {
+				int64_t band = i % bands;
+				UpdateLosBand(
+					sources,
+					static_cast<PlayerId>(i / bands),
+					band * LOS_BAND_ROWS,
+					std::min(row_size, (band + 1) * LOS_BAND_ROWS),
+					los_band_changes[i]
+				);
+			}
+		}
+	);
 }
 
 void Terrain::MergeWithMain(const Terrain& terrain) {
@@ -164,6 +337,26 @@ void Terrain::MergeWithMain(const Terrain& terrain) {
 			grid[i][j].MergeWithMain(terrain.grid[i][j]);
 		}
 	}
+
+	if (los_version != terrain.los_version) {
+		los_band_changes = terrain.los_band_changes;
+
+		// One update behind, only the cells that changed in that update
+		// need their version brought up to date
+		if (!los_changed_at.empty() && los_version == terrain.los_version - 1) {
+			int64_t bands = los_band_changes.size() / (LAST_PLAYER + 1);
+			for (int64_t i = 0; i < static_cast<int64_t>(los_band_changes.size()); ++i) {
+				auto& changed_at = los_changed_at[i / bands];
+				for (auto cell : los_band_changes[i]) {
+					changed_at[cell] = terrain.los_version;
+				}
+			}
+		}
+		else {
+			los_changed_at = terrain.los_changed_at;
+		}
+		los_version = terrain.los_version;
+	}
 }
 
 }
@@ -6,7 +6,9 @@ TerrainElement::TerrainElement() :
 	position(),
 	size(),
 	terrain_type(),
-	los_type_player(std::vector<LOS_TYPE>(LAST_PLAYER + 1, UNEXPLORED)) {}
+	los_type_player() {
+	los_type_player.fill(UNEXPLORED);
+}
 
 TerrainElement::TerrainElement(TERRAIN_TYPE terrain_type,
                                physics::Vector2D position,
@@ -14,7 +16,9 @@ TerrainElement::TerrainElement(TERRAIN_TYPE terrain_type,
 	position(position),
 	size(size),
 	terrain_type(terrain_type),
-	los_type_player(std::vector<LOS_TYPE>(LAST_PLAYER + 1, UNEXPLORED)) {}
+	los_type_player() {
+	los_type_player.fill(UNEXPLORED);
+}
 
 int64_t TerrainElement::GetSize() {
 	return size;
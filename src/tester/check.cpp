@@ -0,0 +1,179 @@
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "player_state_handler/player_state_handler.h"
+#include "ipc.h"
+#include "initial_state.h"
+#include "main_driver.h"
+#include "player_ai.h"
+#include "player1.h"
+#include "ai.h"
+#include "ai1.h"
+#include "tester.h"
+
+/**
+ * Rows of the terrain the checks are played on when none is given
+ */
+const int64_t CHECK_TERRAIN_ROWS = 32;
+
+/**
+ * Game time each match played by a MainDriver lasts, in milliseconds
+ */
+const int64_t CHECK_MATCH_DURATION = 5 * 1000;
+
+/**
+ * Makes a terrain of plains with forests and mountains scattered over it,
+ * big enough for the units of drivers::MakeState
+ *
+ * @return     The terrain
+ */
+state::Terrain MakeTerrain()
+{
+	std::vector<uint8_t> types(CHECK_TERRAIN_ROWS * CHECK_TERRAIN_ROWS, state::PLAIN);
+	for (int64_t row = 0; row < CHECK_TERRAIN_ROWS; row++) {
+		for (int64_t column = 0; column < CHECK_TERRAIN_ROWS; column++) {
+			if ((row * 7 + column * 3) % 5 == 0) {
+				types[row * CHECK_TERRAIN_ROWS + column] = state::MOUNTAIN;
+			}
+			else if ((row + column) % 11 == 0) {
+				types[row * CHECK_TERRAIN_ROWS + column] = state::FOREST;
+			}
+		}
+	}
+	return state::Terrain(CHECK_TERRAIN_ROWS, types.data(), drivers::ELEMENT_SIZE);
+}
+
+/**
+ * Checks that a replay recorded from a short match decodes to what was
+ * recorded, stepping the match by hand
+ *
+ * @param[in]  terrain      The terrain the match is played on
+ * @param[in]  replay_file  File the match is recorded to
+ *
+ * @return     true if the check passed, false otherwise
+ */
+bool CheckReplay(const state::Terrain& terrain, const std::string& replay_file)
+{
+	auto state = drivers::MakeState(terrain);
+	auto S = std::shared_ptr<state::State>(new state::State(state));
+	auto S1 = std::shared_ptr<state::State>(S->Clone());
+	auto S2 = std::shared_ptr<state::State>(S->Clone());
+	auto PSH1 = std::make_shared<state::PlayerStateHandler>(S1.get(), state::PLAYER1);
+	auto PSH2 = std::make_shared<state::PlayerStateHandler>(S2.get(), state::PLAYER2);
+	player::PlayerAi p1(std::shared_ptr<player::PlayerAiHelper>(new player1::Player1()));
+	player::PlayerAi p2(std::shared_ptr<player::PlayerAiHelper>(new ai1::Ai1()));
+
+	S->Update(1);
+	S1->MergeWithMain(*S);
+	S2->MergeWithMain(*S);
+
+	auto step = [&]() {
+		p1.Update(PSH1);
+		p2.Update(PSH2);
+		S->MergeWithBuffer(*S1, state::PLAYER1);
+		S->MergeWithBuffer(*S2, state::PLAYER2);
+		S->Update(1);
+		S1->MergeWithMain(*S);
+		S2->MergeWithMain(*S);
+	};
+	return tester::CheckReplayRoundTrip(S, step, 90, replay_file, std::cerr);
+}
+
+/**
+ * Plays a headless match against the level 2 AI, which draws from its
+ * random number generator, recording it to a replay
+ *
+ * @param[in]  terrain      The terrain the match is played on
+ * @param[in]  options      The options of the match
+ * @param[in]  replay_file  File the match is recorded to
+ */
+void PlayMatch(const state::Terrain& terrain, drivers::DriverOptions options,
+	const std::string& replay_file)
+{
+	auto state = drivers::MakeState(terrain);
+	auto S = std::shared_ptr<state::State>(new state::State(state));
+	auto S1 = std::shared_ptr<state::State>(S->Clone());
+	auto S2 = std::shared_ptr<state::State>(S->Clone());
+
+	options.replay_file = replay_file;
+	drivers::MainDriver driver(
+		player::PlayerAi(std::shared_ptr<player::PlayerAiHelper>(new player1::Player1())),
+		player::PlayerAi(std::shared_ptr<player::PlayerAiHelper>(new ai::AI(2))),
+		S, S1, S2, CHECK_MATCH_DURATION, true, options);
+	driver.Run();
+	driver.Join();
+}
+
+/**
+ * Checks that two seeded lockstep matches record the same replay
+ *
+ * @param[in]  terrain  The terrain the matches are played on
+ * @param[in]  output   Start of the names of the replay files
+ *
+ * @return     true if the check passed, false otherwise
+ */
+bool CheckLockstep(const state::Terrain& terrain, const std::string& output)
+{
+	drivers::DriverOptions options;
+	options.lockstep = true;
+	options.seed = 5;
+	PlayMatch(terrain, options, output + ".lockstep.1");
+	PlayMatch(terrain, options, output + ".lockstep.2");
+	return tester::CheckSameReplays(output + ".lockstep.1", output + ".lockstep.2", std::cerr);
+}
+
+/**
+ * Checks that lockstep matches split between 1 and 4 worker threads
+ * record the same replay
+ *
+ * @param[in]  terrain  The terrain the matches are played on
+ * @param[in]  output   Start of the names of the replay files
+ *
+ * @return     true if the check passed, false otherwise
+ */
+bool CheckWorkers(const state::Terrain& terrain, const std::string& output)
+{
+	drivers::DriverOptions options;
+	options.lockstep = true;
+	options.worker_threads = 1;
+	PlayMatch(terrain, options, output + ".workers.1");
+	options.worker_threads = 4;
+	PlayMatch(terrain, options, output + ".workers.4");
+	return tester::CheckSameReplays(output + ".workers.1", output + ".workers.4", std::cerr);
+}
+
+/**
+ * Runs every check, printing any failures
+ *
+ * check OUTPUT [TERRAIN] plays its matches on TERRAIN, or on a small
+ * terrain of its own, and writes their replays to files starting with
+ * OUTPUT. It exits non-zero if a check fails
+ */
+int main(int argc, char * argv[])
+{
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " OUTPUT [TERRAIN]" << std::endl;
+		return 2;
+	}
+	std::string output(argv[1]);
+	state::Terrain terrain = argc > 2 ? ipc::LoadTerrain(argv[2]) : MakeTerrain();
+	if (terrain.GetRows() < drivers::MIN_TERRAIN_ROWS) {
+		std::cerr << "Could not load a terrain of at least " << drivers::MIN_TERRAIN_ROWS
+			<< " rows from " << argv[2] << std::endl;
+		return 2;
+	}
+
+	bool is_passed = tester::CheckLOSRoundTrip(std::cerr);
+	is_passed = tester::CheckShmRing(std::cerr) && is_passed;
+	is_passed = tester::CheckLogger(std::cerr) && is_passed;
+	is_passed = tester::CheckSpatialIndex(std::cerr) && is_passed;
+	is_passed = tester::CheckInfluenceMap(std::cerr) && is_passed;
+	is_passed = CheckReplay(terrain, output) && is_passed;
+	is_passed = CheckLockstep(terrain, output) && is_passed;
+	is_passed = CheckWorkers(terrain, output) && is_passed;
+
+	std::cerr << (is_passed ? "All checks passed" : "Checks failed") << std::endl;
+	return is_passed ? 0 : 1;
+}
@@ -1,8 +1,121 @@
+/**
+ * @file tester.h
+ * Declarations for checks that what is sent or recorded comes back unchanged
+ */
 #ifndef TESTER_H
 #define TESTER_H
 
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "state.h"
 #include "tester_export.h"
 
 TESTER_EXPORT void print();
 
+namespace tester {
+
+/**
+ * Checks that LOS grids come back unchanged from every LOS encoding
+ *
+ * Random grids, with cell counts that aren't multiples of 4 or 8, are
+ * packed, run length encoded and written as rows, then decoded again
+ *
+ * @param      out   The stream failures are printed to
+ *
+ * @return     true if every grid came back unchanged, false otherwise
+ */
+TESTER_EXPORT bool CheckLOSRoundTrip(std::ostream& out);
+
+/**
+ * Checks that seeking a replay rebuilds every frame that was recorded
+ *
+ * The match is recorded for a number of ticks, keeping a snapshot of each
+ * one. The replay is then sought to every tick, forwards and backwards,
+ * and each frame is compared with its snapshot
+ *
+ * @param      state     The match's state
+ * @param[in]  step      Plays one tick of the match
+ * @param[in]  ticks     Number of ticks to record
+ * @param[in]  filename  File the replay is written to
+ * @param      out       The stream failures are printed to
+ *
+ * @return     true if every frame was rebuilt, false otherwise
+ */
+TESTER_EXPORT bool CheckReplayRoundTrip(std::shared_ptr<state::State> state,
+	std::function<void()> step, int64_t ticks, const std::string& filename,
+	std::ostream& out);
+
+/**
+ * Checks that two replays are the same byte for byte, as two runs of a
+ * deterministic match must record
+ *
+ * @param[in]  first   File of the first replay
+ * @param[in]  second  File of the second replay
+ * @param      out     The stream failures are printed to, with the first
+ *                     tick at which the replays differ
+ *
+ * @return     true if they are the same, false otherwise
+ */
+TESTER_EXPORT bool CheckSameReplays(const std::string& first,
+	const std::string& second, std::ostream& out);
+
+/**
+ * Checks that frames written to a shared memory ring are read back
+ *
+ * A small ring is written and read on one thread, through many wrap
+ * arounds, a full ring that drops frames and Close, then on two threads
+ * at once
+ *
+ * @param      out   The stream failures are printed to
+ *
+ * @return     true if every frame was read or counted as dropped, false
+ *             otherwise
+ */
+TESTER_EXPORT bool CheckShmRing(std::ostream& out);
+
+/**
+ * Checks that a Logger keeps to its limits and loses no logs unknowingly
+ *
+ * The limits on logs and bytes per frame, a full ring and logs cut short
+ * are checked on one thread, then several threads log while the calling
+ * thread drains
+ *
+ * @param      out   The stream failures are printed to
+ *
+ * @return     true if the check passed, false otherwise
+ */
+TESTER_EXPORT bool CheckLogger(std::ostream& out);
+
+/**
+ * Checks SpatialIndex queries against looking at every unit
+ *
+ * Random radius, box and nearest unit queries are made about random units,
+ * some on the edges of the map or sharing a place, with some centers off
+ * the map
+ *
+ * @param      out   The stream failures are printed to
+ *
+ * @return     true if every query found what it should have, false
+ *             otherwise
+ */
+TESTER_EXPORT bool CheckSpatialIndex(std::ostream& out);
+
+/**
+ * Checks InfluenceMap cells and sums against adding up the cells one by one
+ *
+ * Actors move about, change value and leave a map for a number of rounds,
+ * and after each one every cell and random boxes are checked, on the map
+ * and on one merged from it
+ *
+ * @param      out   The stream failures are printed to
+ *
+ * @return     true if every cell and sum was right, false otherwise
+ */
+TESTER_EXPORT bool CheckInfluenceMap(std::ostream& out);
+
+}
+
 #endif
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "influence/influence_map.h"
+#include "tester.h"
+
+namespace tester {
+
+/**
+ * No of cells per row of the map checked, not a power of 2 so that the
+ * Fenwick tree's last ranges are partial
+ */
+static const int64_t INFLUENCE_CHECK_ROWS = 37;
+
+/**
+ * Number of Actors adding to the map
+ */
+static const int64_t INFLUENCE_CHECK_ACTORS = 120;
+
+/**
+ * Number of rounds of moving the Actors and checking the sums
+ */
+static const int64_t INFLUENCE_CHECK_ROUNDS = 20;
+
+/**
+ * Number of random boxes summed each round
+ */
+static const int64_t INFLUENCE_CHECK_BOXES = 200;
+
+/**
+ * Sums the cells of a box by looking at each one, clipped to the grid
+ *
+ * @param[in]  cells         The value of each cell, as row * rows + column
+ * @param[in]  first_row     The first row
+ * @param[in]  first_column  The first column
+ * @param[in]  last_row      The last row
+ * @param[in]  last_column   The last column
+ *
+ * @return     The sum
+ */
+static int64_t SumCells(const std::vector<int64_t>& cells, int64_t first_row,
+	int64_t first_column, int64_t last_row, int64_t last_column) {
+
+	int64_t sum = 0;
+	for (int64_t row = std::max(first_row, (int64_t) 0);
+		row <= std::min(last_row, INFLUENCE_CHECK_ROWS - 1); ++row) {
+		for (int64_t column = std::max(first_column, (int64_t) 0);
+			column <= std::min(last_column, INFLUENCE_CHECK_ROWS - 1); ++column) {
+			sum += cells[row * INFLUENCE_CHECK_ROWS + column];
+		}
+	}
+	return sum;
+}
+
+/**
+ * Checks every cell and random boxes of a map against the cells it should
+ * have
+ *
+ * @param[in]  name    The map, printed on failure
+ * @param[in]  map     The map
+ * @param[in]  cells   The value each cell should have
+ * @param      random  The random number generator
+ * @param      out     The stream failures are printed to
+ *
+ * @return     true if every cell and sum was right, false otherwise
+ */
+static bool CheckInfluenceSums(const std::string& name, const state::InfluenceMap& map,
+	const std::vector<int64_t>& cells, std::mt19937& random, std::ostream& out) {
+
+	for (int64_t row = 0; row < INFLUENCE_CHECK_ROWS; ++row) {
+		for (int64_t column = 0; column < INFLUENCE_CHECK_ROWS; ++column) {
+			if (map.GetCell(row, column) != cells[row * INFLUENCE_CHECK_ROWS + column]) {
+				out << name << " has " << map.GetCell(row, column) << " in cell (" << row
+					<< ", " << column << "), not " << cells[row * INFLUENCE_CHECK_ROWS + column]
+					<< std::endl;
+				return false;
+			}
+		}
+	}
+
+	// Boxes reach off the grid, and some are empty
+	std::uniform_int_distribution<int64_t> coordinate(-5, INFLUENCE_CHECK_ROWS + 5);
+	for (int64_t box = 0; box < INFLUENCE_CHECK_BOXES; ++box) {
+		int64_t first_row = coordinate(random);
+		int64_t first_column = coordinate(random);
+		int64_t last_row = coordinate(random);
+		int64_t last_column = coordinate(random);
+		int64_t sum = map.GetSum(first_row, first_column, last_row, last_column);
+		int64_t expected = SumCells(cells, first_row, first_column, last_row, last_column);
+		if (sum != expected) {
+			out << name << " summed rows " << first_row << " to " << last_row << " and columns "
+				<< first_column << " to " << last_column << " to " << sum << ", not "
+				<< expected << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CheckInfluenceMap(std::ostream& out) {
+	std::mt19937 random(4);
+	std::uniform_int_distribution<int64_t> cell(-1, INFLUENCE_CHECK_ROWS * INFLUENCE_CHECK_ROWS - 1);
+	std::uniform_int_distribution<int64_t> value(-50, 500);
+	std::uniform_int_distribution<int> moving(0, 3);
+
+	state::InfluenceMap map(INFLUENCE_CHECK_ROWS);
+	state::InfluenceMap player_map(INFLUENCE_CHECK_ROWS);
+	std::vector<state::InfluenceEntry> actors(INFLUENCE_CHECK_ACTORS, {-1, 0});
+
+	bool is_passed = true;
+	for (int64_t round = 0; round < INFLUENCE_CHECK_ROUNDS && is_passed; ++round) {
+		// Some Actors move, some change value, some leave the map or
+		// drop to 0, and the rest stay as they were
+		for (int64_t id = 0; id < INFLUENCE_CHECK_ACTORS; ++id) {
+			auto& actor = actors[id];
+			switch (moving(random)) {
+				case 0 :
+					actor.cell = cell(random);
+					break;
+				case 1 :
+					actor.value = value(random);
+					break;
+				case 2 :
+					actor.cell = cell(random);
+					actor.value = value(random) % 3 == 0 ? 0 : value(random);
+					break;
+			}
+			map.Set(id, actor.cell, actor.value);
+		}
+
+		std::vector<int64_t> cells(INFLUENCE_CHECK_ROWS * INFLUENCE_CHECK_ROWS, 0);
+		for (auto& actor : actors) {
+			if (actor.cell != -1) {
+				cells[actor.cell] += actor.value;
+			}
+		}
+		is_passed = CheckInfluenceSums("InfluenceMap", map, cells, random, out);
+
+		// A player state's map catches up every other round
+		if (round % 2 == 1) {
+			player_map.MergeWithMain(map);
+			is_passed = CheckInfluenceSums("A merged InfluenceMap", player_map, cells,
+				random, out) && is_passed;
+		}
+	}
+	return is_passed;
+}
+
+}
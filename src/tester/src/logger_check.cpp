@@ -0,0 +1,179 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ipc.h"
+#include "state.pb.h"
+#include "tester.h"
+
+namespace tester {
+
+/**
+ * Number of threads logging at once in the threaded check
+ */
+static const int64_t LOGGER_CHECK_THREADS = 4;
+
+/**
+ * Number of logs each of those threads writes
+ */
+static const int64_t LOGGER_CHECK_LOGS = 20000;
+
+/**
+ * Logs a number of copies of a message from the calling thread
+ *
+ * @param      logger  The Logger
+ * @param[in]  log     The message
+ * @param[in]  count   The number of copies
+ */
+static void LogCopies(ipc::Logger& logger, const std::string& log, int64_t count) {
+	for (int64_t i = 0; i < count; ++i) {
+		logger.SetLogs(log);
+	}
+}
+
+/**
+ * Drains a Logger and checks how many logs it had
+ *
+ * @param      logger  The Logger
+ * @param[in]  name    What was checked, printed on failure
+ * @param[in]  count   The number of logs expected
+ * @param      out     The stream failures are printed to
+ *
+ * @return     true if there were that many, false otherwise
+ */
+static bool CheckDrainedCount(ipc::Logger& logger, const std::string& name,
+	int64_t count, std::ostream& out) {
+
+	IPC::State frame;
+	logger.DrainLogs(&frame);
+	if (frame.user_logs_size() != count) {
+		out << name << " let " << frame.user_logs_size() << " logs through, "
+			<< count << " should have been" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Checks the limits on logs per frame, a full ring and logs cut short, on
+ * the calling thread
+ *
+ * @param      logger  A Logger no logs were sent to yet
+ * @param      out     The stream failures are printed to
+ *
+ * @return     true if the check passed, false otherwise
+ */
+static bool CheckLoggerLimits(ipc::Logger& logger, std::ostream& out) {
+	bool is_passed = true;
+
+	logger.SetLimits(10, 0);
+	LogCopies(logger, "abc", 25);
+	is_passed = CheckDrainedCount(logger, "A limit of 10 logs", 10, out) && is_passed;
+
+	// Draining starts the next frame's limits
+	LogCopies(logger, "abc", 5);
+	is_passed = CheckDrainedCount(logger, "A new frame", 5, out) && is_passed;
+
+	logger.SetLimits(0, 100);
+	LogCopies(logger, "0123456789", 30);
+	is_passed = CheckDrainedCount(logger, "A limit of 100 bytes", 10, out) && is_passed;
+
+	logger.SetLimits(0, 0);
+	LogCopies(logger, "abc", ipc::LOG_RING_CAPACITY + 5);
+	is_passed = CheckDrainedCount(logger, "A full ring", ipc::LOG_RING_CAPACITY, out) && is_passed;
+
+	if (logger.GetDroppedLogs(state::PLAYER1) != 15 + 20 + 5
+		|| logger.GetDroppedLogs(state::PLAYER2) != 0) {
+		out << "Logger counted " << logger.GetDroppedLogs(state::PLAYER1) << " and "
+			<< logger.GetDroppedLogs(state::PLAYER2) << " logs dropped, 40 and 0 were"
+			<< std::endl;
+		is_passed = false;
+	}
+
+	logger.SetLogs(std::string(ipc::LOG_RECORD_LENGTH, 'x'));
+	logger.SetLogs(std::string(ipc::LOG_RECORD_LENGTH + 50, 'y'));
+	IPC::State frame;
+	logger.DrainLogs(&frame);
+	if (frame.user_logs_size() != 2
+		|| frame.user_logs(0) != std::string(ipc::LOG_RECORD_LENGTH, 'x')
+		|| frame.user_logs(1) != std::string(ipc::LOG_RECORD_LENGTH, 'y')
+		|| logger.GetTruncatedLogs(state::PLAYER1) != 1) {
+		out << "Logger did not cut a long log short to LOG_RECORD_LENGTH" << std::endl;
+		is_passed = false;
+	}
+	return is_passed;
+}
+
+/**
+ * Checks that logs from several threads are drained in the order each
+ * thread wrote them, while they're being written, and that every log is
+ * either drained or counted as dropped
+ *
+ * @param      logger  A Logger no logs were sent to yet
+ * @param      out     The stream failures are printed to
+ *
+ * @return     true if the check passed, false otherwise
+ */
+static bool CheckLoggerThreads(ipc::Logger& logger, std::ostream& out) {
+	logger.SetLimits(0, 0);
+
+	std::atomic<int64_t> running(LOGGER_CHECK_THREADS);
+	std::vector<std::thread> threads;
+	for (int64_t thread = 0; thread < LOGGER_CHECK_THREADS; ++thread) {
+		threads.emplace_back([&logger, &running, thread] {
+			ipc::Logger::SetThreadLogger(&logger, thread % 2);
+			for (int64_t i = 0; i < LOGGER_CHECK_LOGS; ++i) {
+				logger.SetLogs(std::to_string(thread) + ":" + std::to_string(i));
+			}
+			ipc::Logger::SetThreadLogger(nullptr, ipc::LOG_NO_PLAYER);
+			running--;
+		});
+	}
+
+	std::vector<int64_t> last_logs(LOGGER_CHECK_THREADS, -1);
+	int64_t drained = 0;
+	bool is_ordered = true;
+	bool is_done = false;
+	while (!is_done) {
+		is_done = running == 0;
+		IPC::State frame;
+		logger.DrainLogs(&frame);
+		for (auto& log : frame.user_logs()) {
+			auto separator = log.find(':');
+			int64_t thread = std::stoll(log.substr(0, separator));
+			int64_t i = std::stoll(log.substr(separator + 1));
+			is_ordered = is_ordered && i > last_logs[thread];
+			last_logs[thread] = i;
+			drained++;
+		}
+		std::this_thread::yield();
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	int64_t dropped = logger.GetDroppedLogs(state::PLAYER1) + logger.GetDroppedLogs(state::PLAYER2);
+	if (!is_ordered || drained + dropped != LOGGER_CHECK_THREADS * LOGGER_CHECK_LOGS) {
+		out << "Logger drained " << drained << " logs" << (is_ordered ? "" : " out of order")
+			<< " and dropped " << dropped << ", of " << LOGGER_CHECK_THREADS * LOGGER_CHECK_LOGS
+			<< std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CheckLogger(std::ostream& out) {
+	// Loggers hold a ring for every thread, too much for the stack
+	std::unique_ptr<ipc::Logger> logger(new ipc::Logger);
+	ipc::Logger::SetThreadLogger(logger.get(), state::PLAYER1);
+	bool is_passed = CheckLoggerLimits(*logger, out);
+	// The thread's ring is given back before its Logger goes
+	ipc::Logger::SetThreadLogger(nullptr, ipc::LOG_NO_PLAYER);
+
+	logger.reset(new ipc::Logger);
+	is_passed = CheckLoggerThreads(*logger, out) && is_passed;
+	return is_passed;
+}
+
+}
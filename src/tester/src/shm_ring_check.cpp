@@ -0,0 +1,180 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "shm_ring.h"
+#include "state.pb.h"
+#include "tester.h"
+
+namespace tester {
+
+/**
+ * Bytes in the rings checked, small so that the frames wrap around them
+ * many times
+ */
+static const uint64_t SHM_RING_CHECK_CAPACITY = 1024;
+
+/**
+ * Number of frames written through each ring checked
+ */
+static const int64_t SHM_RING_CHECK_FRAMES = 2000;
+
+/**
+ * Makes a frame numbered by its tick, with a few logs so that frames
+ * differ in size and wrap at different places
+ *
+ * @param[in]  tick   The frame's number
+ * @param      frame  The frame
+ */
+static void MakeRingFrame(int64_t tick, IPC::State* frame) {
+	frame->Clear();
+	frame->set_tick(tick);
+	for (int64_t i = 0; i < tick % 5; ++i) {
+		frame->add_user_logs(std::string(tick % 37, 'x'));
+	}
+}
+
+/**
+ * Checks that the next frame read is a particular one
+ *
+ * @param      reader  The reader
+ * @param[in]  tick    The frame's number
+ * @param      out     The stream failures are printed to
+ *
+ * @return     true if it was read, false otherwise
+ */
+static bool CheckRingFrame(ipc::ShmRingReader& reader, int64_t tick, std::ostream& out) {
+	IPC::State frame;
+	if (!reader.Next(&frame, std::chrono::nanoseconds(0))
+		|| frame.tick() != tick || frame.user_logs_size() != tick % 5) {
+		out << "ShmRingReader did not read frame " << tick << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Checks a writer and a reader on one thread, through wrap around, a full
+ * ring and Close
+ *
+ * @param[in]  name  Name of the ring
+ * @param      out   The stream failures are printed to
+ *
+ * @return     true if the check passed, false otherwise
+ */
+static bool CheckShmRingInOrder(const std::string& name, std::ostream& out) {
+	ipc::ShmRingWriter writer(name, SHM_RING_CHECK_CAPACITY);
+	ipc::ShmRingReader reader(name);
+	if (!writer.IsOpen() || !reader.IsOpen()) {
+		out << "Could not make the shared memory ring " << name << std::endl;
+		return false;
+	}
+	IPC::State frame;
+
+	// Each frame is read as soon as it's written, so the frames wrap
+	// around the ring many times
+	for (int64_t tick = 0; tick < SHM_RING_CHECK_FRAMES; ++tick) {
+		MakeRingFrame(tick, &frame);
+		writer.Write(frame);
+		if (!CheckRingFrame(reader, tick, out)) {
+			return false;
+		}
+	}
+	reader.Release();
+
+	// Unread frames fill the ring, and the ones after are dropped
+	int64_t kept = 0;
+	while (writer.GetDroppedFrames() == 0) {
+		MakeRingFrame(kept, &frame);
+		writer.Write(frame);
+		kept++;
+	}
+	kept--;
+	for (int64_t tick = 0; tick < 9; ++tick) {
+		writer.Write(frame);
+	}
+	if (kept < 2 || writer.GetDroppedFrames() != 10 || reader.GetDroppedFrames() != 10) {
+		out << "ShmRingWriter kept " << kept << " frames and dropped "
+			<< reader.GetDroppedFrames() << " of the rest, 10 were" << std::endl;
+		return false;
+	}
+	for (int64_t tick = 0; tick < kept; ++tick) {
+		if (!CheckRingFrame(reader, tick, out)) {
+			return false;
+		}
+	}
+	if (reader.Next(&frame, std::chrono::nanoseconds(0))) {
+		out << "ShmRingReader read a dropped frame" << std::endl;
+		return false;
+	}
+
+	// Frames written before Close are still read, then the ring is finished
+	MakeRingFrame(kept, &frame);
+	writer.Write(frame);
+	writer.Close();
+	if (!CheckRingFrame(reader, kept, out)) {
+		return false;
+	}
+	if (reader.Next(&frame, std::chrono::seconds(1)) || !reader.IsFinished()) {
+		out << "ShmRingReader did not finish once the ring was closed" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Checks a writer and a reader on threads of their own, each frame read
+ * must be newer than the last and every frame read or dropped
+ *
+ * @param[in]  name  Name of the ring
+ * @param      out   The stream failures are printed to
+ *
+ * @return     true if the check passed, false otherwise
+ */
+static bool CheckShmRingThreaded(const std::string& name, std::ostream& out) {
+	ipc::ShmRingWriter writer(name, SHM_RING_CHECK_CAPACITY);
+	ipc::ShmRingReader reader(name);
+	if (!writer.IsOpen() || !reader.IsOpen()) {
+		out << "Could not make the shared memory ring " << name << std::endl;
+		return false;
+	}
+
+	std::thread writer_thread([&writer] {
+		IPC::State frame;
+		for (int64_t tick = 0; tick < SHM_RING_CHECK_FRAMES; ++tick) {
+			MakeRingFrame(tick, &frame);
+			writer.Write(frame);
+		}
+		writer.Close();
+	});
+
+	IPC::State frame;
+	int64_t read = 0;
+	int64_t last_tick = -1;
+	bool is_ordered = true;
+	while (reader.Next(&frame, std::chrono::seconds(5))) {
+		is_ordered = is_ordered && frame.tick() > last_tick
+			&& frame.user_logs_size() == frame.tick() % 5;
+		last_tick = frame.tick();
+		read++;
+	}
+	writer_thread.join();
+
+	if (!is_ordered || !reader.IsFinished()
+		|| read + reader.GetDroppedFrames() != SHM_RING_CHECK_FRAMES) {
+		out << "ShmRingReader read " << read << " frames" << (is_ordered ? "" : " out of order")
+			<< " and " << reader.GetDroppedFrames() << " were dropped, of "
+			<< SHM_RING_CHECK_FRAMES << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CheckShmRing(std::ostream& out) {
+	std::string name = "/tester_ring_" + std::to_string(getpid());
+	bool is_passed = CheckShmRingInOrder(name, out);
+	is_passed = CheckShmRingThreaded(name, out) && is_passed;
+	return is_passed;
+}
+
+}
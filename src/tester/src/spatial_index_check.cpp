@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "player_state_handler/spatial_index.h"
+#include "tester.h"
+
+namespace tester {
+
+/**
+ * Length of a side of the map the units are put on, as 32 elements of 200
+ */
+static const double SPATIAL_CHECK_MAP_SIZE = 6400;
+
+/**
+ * Length of a side of a cell of the index, as SPATIAL_INDEX_CELL_ELEMENTS
+ * elements of 200
+ */
+static const double SPATIAL_CHECK_CELL_SIZE = 400;
+
+/**
+ * Number of units put in the index
+ */
+static const int64_t SPATIAL_CHECK_UNITS = 300;
+
+/**
+ * Number of random queries of each kind made
+ */
+static const int64_t SPATIAL_CHECK_QUERIES = 300;
+
+/**
+ * Makes units at random places, some on the edges of the map and some on
+ * the same place as another, so that distances tie
+ *
+ * @param      random  The random number generator
+ *
+ * @return     The units
+ */
+static std::vector<state::SpatialEntry> MakeSpatialEntries(std::mt19937& random) {
+	std::uniform_real_distribution<double> coordinate(0, SPATIAL_CHECK_MAP_SIZE);
+	std::uniform_int_distribution<int> actor_type(0, static_cast<int>(state::ActorType::TOWER));
+	std::uniform_int_distribution<int> placing(0, 9);
+
+	std::vector<state::act_id_t> ids(SPATIAL_CHECK_UNITS);
+	for (int64_t i = 0; i < SPATIAL_CHECK_UNITS; ++i) {
+		ids[i] = i * 3 + 1;
+	}
+	std::shuffle(ids.begin(), ids.end(), random);
+
+	std::vector<state::SpatialEntry> entries;
+	for (auto id : ids) {
+		state::SpatialEntry entry;
+		entry.id = id;
+		entry.actor_type = static_cast<state::ActorType>(actor_type(random));
+		entry.is_enemy = placing(random) % 2 == 0;
+		entry.x = coordinate(random);
+		entry.y = coordinate(random);
+		switch (placing(random)) {
+			case 0 :
+				entry.x = 0;
+				break;
+			case 1 :
+				entry.y = SPATIAL_CHECK_MAP_SIZE;
+				break;
+			case 2 :
+				if (!entries.empty()) {
+					entry.x = entries.back().x;
+					entry.y = entries.back().y;
+				}
+				break;
+		}
+		entries.push_back(entry);
+	}
+	return entries;
+}
+
+/**
+ * Checks if a unit passes a filter, as SpatialIndex should
+ *
+ * @param[in]  entry   The unit
+ * @param[in]  filter  The filter
+ *
+ * @return     true if it does, false otherwise
+ */
+static bool IsInFilter(const state::SpatialEntry& entry, state::UNIT_FILTER filter) {
+	return filter == state::ALL_UNITS || (filter == state::ENEMY_UNITS) == entry.is_enemy;
+}
+
+/**
+ * Gets the squared distance of a unit from a point
+ *
+ * @param[in]  entry   The unit
+ * @param[in]  center  The point
+ *
+ * @return     The squared distance
+ */
+static double DistanceSquared(const state::SpatialEntry& entry, physics::Vector2D center) {
+	double dx = entry.x - center.x;
+	double dy = entry.y - center.y;
+	return dx * dx + dy * dy;
+}
+
+/**
+ * Compares the units a query found with those found by looking at every
+ * unit
+ *
+ * @param[in]  name      The query, printed on failure
+ * @param[in]  center    The point queried about, printed on failure
+ * @param[in]  found     The units the query found
+ * @param[in]  expected  The units it should have found
+ * @param      out       The stream failures are printed to
+ *
+ * @return     true if they are the same, false otherwise
+ */
+static bool CheckFoundUnits(const std::string& name, physics::Vector2D center,
+	const state::list_act_id_t& found, const state::list_act_id_t& expected,
+	std::ostream& out) {
+
+	if (found != expected) {
+		out << name << " around (" << center.x << ", " << center.y << ") found "
+			<< found.size() << " units, " << expected.size() << " are there" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CheckSpatialIndex(std::ostream& out) {
+	std::mt19937 random(3);
+	auto entries = MakeSpatialEntries(random);
+
+	state::SpatialIndex index;
+	for (auto& entry : entries) {
+		index.Add(entry);
+	}
+	index.Build(SPATIAL_CHECK_MAP_SIZE, SPATIAL_CHECK_CELL_SIZE, 1);
+
+	// Some centers are off the map, where the index clamps to its edge cells
+	std::uniform_real_distribution<double> coordinate(
+		-SPATIAL_CHECK_MAP_SIZE / 4, SPATIAL_CHECK_MAP_SIZE * 5 / 4);
+	std::uniform_real_distribution<double> length(0, SPATIAL_CHECK_MAP_SIZE / 2);
+	std::uniform_int_distribution<int64_t> nearest_count(1, 8);
+	std::uniform_int_distribution<int> actor_type(0, static_cast<int>(state::ActorType::TOWER));
+
+	std::vector<physics::Vector2D> centers = {
+		physics::Vector2D(-500, -700),
+		physics::Vector2D(SPATIAL_CHECK_MAP_SIZE + 900, SPATIAL_CHECK_MAP_SIZE / 2),
+		physics::Vector2D(SPATIAL_CHECK_MAP_SIZE / 3, -2 * SPATIAL_CHECK_MAP_SIZE)
+	};
+	while (static_cast<int64_t>(centers.size()) < SPATIAL_CHECK_QUERIES) {
+		centers.push_back(physics::Vector2D(coordinate(random), coordinate(random)));
+	}
+
+	bool is_passed = true;
+	for (int64_t query = 0; query < static_cast<int64_t>(centers.size()); ++query) {
+		auto center = centers[query];
+		auto filter = static_cast<state::UNIT_FILTER>(query % 3);
+		state::list_act_id_t found, expected;
+
+		double radius = length(random);
+		index.QueryRadius(center, radius, filter, found);
+		for (auto& entry : entries) {
+			if (IsInFilter(entry, filter) && DistanceSquared(entry, center) <= radius * radius) {
+				expected.push_back(entry.id);
+			}
+		}
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		is_passed = CheckFoundUnits("QueryRadius", center, found, expected, out) && is_passed;
+
+		physics::Vector2D min_corner(center.x - length(random), center.y - length(random));
+		physics::Vector2D max_corner(center.x + length(random), center.y + length(random));
+		index.QueryBox(min_corner, max_corner, filter, found);
+		expected.clear();
+		for (auto& entry : entries) {
+			if (IsInFilter(entry, filter)
+				&& entry.x >= min_corner.x && entry.x <= max_corner.x
+				&& entry.y >= min_corner.y && entry.y <= max_corner.y) {
+				expected.push_back(entry.id);
+			}
+		}
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		is_passed = CheckFoundUnits("QueryBox", center, found, expected, out) && is_passed;
+
+		int64_t k = nearest_count(random);
+		std::vector<state::ActorType> types;
+		if (query % 4 == 1) {
+			types.push_back(static_cast<state::ActorType>(actor_type(random)));
+			types.push_back(static_cast<state::ActorType>(actor_type(random)));
+		}
+		double max_distance = query % 2 == 0 ? radius : std::numeric_limits<double>::max();
+		index.QueryKNearest(center, k, filter, types, max_distance, found);
+		std::vector<std::pair<double, state::act_id_t> > nearest;
+		for (auto& entry : entries) {
+			double distance_squared = DistanceSquared(entry, center);
+			if (IsInFilter(entry, filter) && distance_squared <= max_distance * max_distance
+				&& (types.empty()
+					|| std::find(types.begin(), types.end(), entry.actor_type) != types.end())) {
+				nearest.emplace_back(distance_squared, entry.id);
+			}
+		}
+		std::sort(nearest.begin(), nearest.end());
+		expected.clear();
+		for (int64_t i = 0; i < k && i < static_cast<int64_t>(nearest.size()); ++i) {
+			expected.push_back(nearest[i].second);
+		}
+		is_passed = CheckFoundUnits("QueryKNearest", center, found, expected, out) && is_passed;
+	}
+	return is_passed;
+}
+
+}
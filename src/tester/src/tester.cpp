@@ -1,7 +1,251 @@
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+#include <google/protobuf/util/message_differencer.h>
+#include "ipc.h"
+#include "replay.h"
+#include "state.pb.h"
 #include "tester.h"
 using namespace std;
 
 void print() {
 	cout<<"bye\n";
 }
+
+namespace tester {
+
+/**
+ * Frames per keyframe of the replay checked, small so that seeks both
+ * start from keyframes and apply runs of deltas
+ */
+static const int64_t REPLAY_KEYFRAME_INTERVAL = 7;
+
+/**
+ * Makes a random LOS grid, made of runs of equal cells
+ *
+ * Runs go up to a few hundred cells, so that run lengths take more than
+ * one byte to encode
+ *
+ * @param[in]  cell_count  No of cells
+ * @param      random      The random number generator
+ *
+ * @return     The LOS of each cell
+ */
+static std::vector<uint8_t> MakeLOS(int64_t cell_count, std::mt19937& random) {
+	std::vector<uint8_t> cells;
+	std::uniform_int_distribution<int64_t> run_length(1, 300);
+	std::uniform_int_distribution<int> value(IPC::State::LOS::UNEXPLORED,
+		IPC::State::LOS::DIRECT_LOS);
+
+	while (static_cast<int64_t>(cells.size()) < cell_count) {
+		int64_t run = std::min(run_length(random), cell_count - static_cast<int64_t>(cells.size()));
+		cells.insert(cells.end(), run, value(random));
+	}
+	return cells;
+}
+
+/**
+ * Checks that a decoded LOS is the one that was encoded
+ *
+ * @param[in]  name     Name of the encoding, printed on failure
+ * @param[in]  cells    The LOS encoded
+ * @param[in]  decoded  The LOS decoded
+ * @param      out      The stream failures are printed to
+ *
+ * @return     true if they are the same, false otherwise
+ */
+static bool CheckLOS(const std::string& name, const std::vector<uint8_t>& cells,
+	const std::vector<uint8_t>& decoded, std::ostream& out) {
+
+	if (decoded != cells) {
+		out << name << " changed an LOS of " << cells.size() << " cells" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CheckLOSRoundTrip(std::ostream& out) {
+	std::mt19937 random(1);
+	bool is_passed = true;
+
+	for (int64_t cell_count : {0, 1, 3, 5, 7, 9, 1001, 4097}) {
+		auto cells = MakeLOS(cell_count, random);
+		is_passed = CheckLOS("PackLOS", cells,
+			ipc::UnpackLOS(ipc::PackLOS(cells), cell_count), out) && is_passed;
+		is_passed = CheckLOS("RunLengthEncodeLOS", cells,
+			ipc::RunLengthDecodeLOS(ipc::RunLengthEncodeLOS(cells)), out) && is_passed;
+	}
+
+	for (int64_t rows : {1, 3, 5, 37, 63}) {
+		std::vector<uint8_t> cells[2] = {MakeLOS(rows * rows, random), MakeLOS(rows * rows, random)};
+
+		for (auto format : {ipc::LOS_ROWS, ipc::LOS_PACKED, ipc::LOS_RUN_LENGTH}) {
+			IPC::State state_message;
+			state_message.set_no_of_rows(rows);
+			ipc::PopulateLOS(cells, &state_message, format);
+
+			std::vector<uint8_t> decoded[2];
+			ipc::DecodeLOS(state_message, decoded);
+
+			std::string name = "PopulateLOS in format " + std::to_string(format);
+			is_passed = CheckLOS(name, cells[0], decoded[0], out) && is_passed;
+			is_passed = CheckLOS(name, cells[1], decoded[1], out) && is_passed;
+		}
+	}
+	return is_passed;
+}
+
+/**
+ * Checks that a frame read from a replay is the frame that was recorded
+ *
+ * Actors are matched by ID, since deltas add new Actors at the end
+ *
+ * @param[in]  recorded  The frame recorded
+ * @param[in]  read      The frame read back
+ * @param      out       The stream failures are printed to
+ *
+ * @return     true if they are the same, false otherwise
+ */
+static bool CheckFrame(const ipc::FrameData& recorded, const ipc::FrameData& read,
+	std::ostream& out) {
+
+	const IPC::State& expected = recorded.state;
+	const IPC::State& actual = read.state;
+	int64_t tick = expected.tick();
+
+	std::map<int64_t, const IPC::State::Actor*> actors;
+	for (auto& actor : actual.actors()) {
+		actors[actor.id()] = &actor;
+	}
+	bool is_same = static_cast<int64_t>(actors.size()) == expected.actors_size();
+	for (auto& actor : expected.actors()) {
+		auto found = actors.find(actor.id());
+		is_same = is_same && found != actors.end()
+			&& google::protobuf::util::MessageDifferencer::Equals(*found->second, actor);
+	}
+	if (!is_same) {
+		out << "Replay changed the actors at tick " << tick << std::endl;
+		return false;
+	}
+
+	if (actual.tick() != tick
+		|| actual.game_time_us() != expected.game_time_us()
+		|| actual.no_of_actors() != expected.no_of_actors()
+		|| actual.contention_meter_limit() != expected.contention_meter_limit()
+		|| actual.score_player1() != expected.score_player1()
+		|| actual.score_player2() != expected.score_player2()
+		|| actual.exit_status() != expected.exit_status()
+		|| actual.no_of_rows() != expected.no_of_rows()) {
+		out << "Replay changed the scores, counts or times at tick " << tick << std::endl;
+		return false;
+	}
+	if (read.los[0] != recorded.los[0] || read.los[1] != recorded.los[1]) {
+		out << "Replay changed the LOS at tick " << tick << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Seeks a replay to a tick and checks the frame it rebuilds
+ *
+ * @param      reader    The replay
+ * @param[in]  recorded  The frame recorded at the tick
+ * @param      out       The stream failures are printed to
+ *
+ * @return     true if the frame was rebuilt, false otherwise
+ */
+static bool CheckSeek(ipc::ReplayReader& reader, const ipc::FrameData& recorded,
+	std::ostream& out) {
+
+	if (!reader.Seek(recorded.state.tick())) {
+		out << "Could not seek to tick " << recorded.state.tick() << std::endl;
+		return false;
+	}
+	return CheckFrame(recorded, reader.GetFrame(), out);
+}
+
+bool CheckReplayRoundTrip(std::shared_ptr<state::State> state,
+	std::function<void()> step, int64_t ticks, const std::string& filename,
+	std::ostream& out) {
+
+	std::vector<ipc::FrameData> recorded(ticks);
+	{
+		ipc::ReplayWriter writer(filename, REPLAY_KEYFRAME_INTERVAL);
+		if (!writer.IsOpen()) {
+			out << "Could not make the replay file " << filename << std::endl;
+			return false;
+		}
+		for (int64_t tick = 0; tick < ticks; ++tick) {
+			step();
+			ipc::SnapshotState(state, tick == ticks - 1, &recorded[tick]);
+			recorded[tick].state.set_tick(tick);
+			recorded[tick].state.set_game_time_us(tick * 1000);
+			writer.Record(recorded[tick]);
+		}
+	}
+
+	ipc::ReplayReader reader(filename);
+	if (!reader.IsOpen() || reader.GetFrameCount() != ticks) {
+		out << "Could not read back the " << ticks << " frames of " << filename << std::endl;
+		return false;
+	}
+
+	bool is_passed = true;
+	for (int64_t tick = 0; tick < ticks; ++tick) {
+		is_passed = CheckSeek(reader, recorded[tick], out) && is_passed;
+	}
+	for (int64_t tick = ticks - 1; tick >= 0; --tick) {
+		is_passed = CheckSeek(reader, recorded[tick], out) && is_passed;
+	}
+	return is_passed;
+}
+
+/**
+ * Reads a whole file
+ *
+ * @param[in]  filename  The file
+ *
+ * @return     Its contents, empty if it couldn't be read
+ */
+static std::string ReadFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+bool CheckSameReplays(const std::string& first, const std::string& second,
+	std::ostream& out) {
+
+	auto first_bytes = ReadFile(first);
+	if (first_bytes.empty()) {
+		out << "Could not read the replay " << first << std::endl;
+		return false;
+	}
+	if (first_bytes == ReadFile(second)) {
+		return true;
+	}
+
+	ipc::ReplayReader first_reader(first);
+	ipc::ReplayReader second_reader(second);
+	while (first_reader.Next() && second_reader.Next()) {
+		auto& first_frame = first_reader.GetFrame();
+		auto& second_frame = second_reader.GetFrame();
+		if (!google::protobuf::util::MessageDifferencer::Equals(first_frame.state, second_frame.state)
+			|| first_frame.los[0] != second_frame.los[0]
+			|| first_frame.los[1] != second_frame.los[1]) {
+			out << first << " and " << second << " differ from tick "
+				<< first_frame.state.tick() << std::endl;
+			return false;
+		}
+	}
+	out << first << " and " << second << " differ after "
+		<< std::min(first_reader.GetFrameCount(), second_reader.GetFrameCount())
+		<< " frames" << std::endl;
+	return false;
+}
+
+}